@@ -665,6 +665,9 @@ DEBOUNCE_TYPE ?= sym_defer_g
 ifneq ($(strip $(DEBOUNCE_TYPE)), custom)
     QUANTUM_SRC += $(QUANTUM_DIR)/debounce/$(strip $(DEBOUNCE_TYPE)).c
 endif
+ifeq ($(strip $(DEBOUNCE_TYPE)), sym_eager_pk_adaptive)
+    OPT_DEFS += -DDEBOUNCE_ADAPTIVE
+endif
 
 
 VALID_SERIAL_DRIVER_TYPES := bitbang usart vendor
@@ -33,6 +33,7 @@ GENERIC_FEATURES = \
     DYNAMIC_TAPPING_TERM \
     GRAVE_ESC \
     HAPTIC \
+    KEY_LATENCY \
     KEY_LOCK \
     KEY_OVERRIDE \
     LEADER \
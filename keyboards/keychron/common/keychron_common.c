@@ -30,6 +30,7 @@
 
 #ifdef QMKATA_ENABLE
 #include "qmkata/QMKata.h"
+#include "qmkata/qmkata_pub.h"
 #include "debug_user.h"
 #endif
 
@@ -100,21 +101,13 @@ bool process_record_keychron_common(uint16_t keycode, keyrecord_t *record) {
                 if (keycode == KC_BACKSPACE) {
                     backspace_press_event = record->event;
                 }
-                if (keycode == KC_ESCAPE && backspace_press_event.pressed) {
+                if (keycode == KC_ESCAPE && backspace_press_event.pressed && devel_config.pub_keypress) {
                     devel_config.pub_keypress = 0;
                     devel_config.process_keypress = 1;
 
-                    uint8_t data[16]; // stop publishing keypress events, send the backspace release event as last
-                    data[0] = QMKATA_ID_KEYEVENT;
+                    // stop publishing keypress events, send the backspace release event as last
                     backspace_press_event.pressed = false;
-                    memcpy(&data[1], &backspace_press_event, sizeof(keyevent_t));
-                    qmkata_send_sysex(QMKATA_CMD_PUB, data, sizeof(keyevent_t)+1);
-                }
-                if (devel_config.pub_keypress) {
-                    uint8_t data[16];
-                    data[0] = QMKATA_ID_KEYEVENT;
-                    memcpy(&data[1], &record->event, sizeof(keyevent_t));
-                    qmkata_send_sysex(QMKATA_CMD_PUB, data, sizeof(keyevent_t)+1);
+                    qmkata_pub_keyevent(&backspace_press_event);
                 }
                 if (devel_config.process_keypress == 0) {
                     if (keycode == KC_ENTER) {
@@ -136,6 +129,17 @@ bool process_record_keychron_common(uint16_t keycode, keyrecord_t *record) {
     }
 }
 
+#if defined(QMKATA_ENABLE) && defined(DEVEL_BUILD)
+// queue key events for publishing at matrix scan time, before tapping/combos delay them,
+// qmkata_task sends them batched
+bool pre_process_record_kb(uint16_t keycode, keyrecord_t *record) {
+    if (devel_config.pub_keypress) {
+        qmkata_pub_keyevent(&record->event);
+    }
+    return pre_process_record_user(keycode, record);
+}
+#endif
+
 void keychron_common_task(void) {
     if (is_siri_active && timer_elapsed32(siri_timer) > 500) {
         unregister_code(KC_LCMD);
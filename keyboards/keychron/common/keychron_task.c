@@ -16,6 +16,7 @@
 
 #include <stdlib.h>
 #include "keychron_task.h"
+#include "trace_point.h"
 #include "quantum.h"
 #include "keychron_common.h"
 #ifdef FACTORY_TEST_ENABLE
@@ -81,7 +82,9 @@ __attribute__((weak)) bool keychron_task_kb(void) {
 void keychron_task(void) {
 #ifdef LK_WIRELESS_ENABLE
     extern void wireless_tasks(void);
+    TRACE_BEGIN(TRACE_ID_WIRELESS_TASKS);
     wireless_tasks();
+    TRACE_END(TRACE_ID_WIRELESS_TASKS);
 #endif
 #ifdef FACTORY_TEST_ENABLE
     factory_test_task();
@@ -15,6 +15,9 @@
  */
 
 #include "quantum.h"
+#if defined(QMKATA_ENABLE) && defined(DEVEL_BUILD)
+#    include "qmkata/qmkata_pub.h"
+#endif
 
 #ifndef HC595_STCP
 #    define HC595_STCP B0
@@ -207,6 +210,9 @@ bool matrix_scan_custom(matrix_row_t current_matrix[]) {
     }
 
     bool changed = memcmp(current_matrix, curr_matrix, sizeof(curr_matrix)) != 0;
+#if defined(QMKATA_ENABLE) && defined(DEVEL_BUILD)
+    if (changed) qmkata_pub_matrix(current_matrix, curr_matrix);
+#endif
     if (changed) memcpy(current_matrix, curr_matrix, sizeof(curr_matrix));
 
     return changed;
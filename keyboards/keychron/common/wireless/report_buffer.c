@@ -137,6 +137,9 @@ void report_buffer_task(void) {
             if (kb_rpt.type == REPORT_TYPE_KB && wireless_transport.send_keyboard) wireless_transport.send_keyboard(&kb_rpt.keyboard.mods);
 #endif
             if (kb_rpt.type == REPORT_TYPE_CONSUMER && wireless_transport.send_consumer) wireless_transport.send_consumer(kb_rpt.consumer);
+#ifdef KEY_LATENCY_ENABLE
+            if (kb_rpt.type == REPORT_TYPE_KB || kb_rpt.type == REPORT_TYPE_NKRO) key_latency_report_sent();
+#endif
             report_timer_buffer = timer_read32();
             lpm_timer_reset();
         }
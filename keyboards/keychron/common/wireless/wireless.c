@@ -346,6 +346,9 @@ void wireless_send_keyboard(report_keyboard_t *report) {
             report_buffer_enqueue(&report_buffer);
 #else
             wireless_transport.send_keyboard(&report->mods);
+#    ifdef KEY_LATENCY_ENABLE
+            key_latency_report_sent();
+#    endif
 #endif
         }
     } else if (wireless_state != WT_RESET) {
@@ -370,6 +373,9 @@ void wireless_send_nkro(report_nkro_t *report) {
             wireless_transport.send_nkro(&report->mods);
 #else
             wireless_transport.send_nkro(&report->mods);
+#endif
+#ifdef KEY_LATENCY_ENABLE
+            key_latency_report_sent();
 #endif
         }
     } else if (wireless_state != WT_RESET) {
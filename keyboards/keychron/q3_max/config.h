@@ -85,3 +85,7 @@
 
 #define RGB_MATRIX_DEFAULT_MODE     RGB_MATRIX_SOLID_REACTIVE_SIMPLE
 #define DYNAMIC_KEYMAP_LAYER_COUNT  8
+#define DYNAMIC_KEYMAP_RAM_CACHE // keymap lookups from RAM instead of the wear leveling eeprom
+#define RESOLVED_LAYER_CACHE     // per key topmost non-transparent layer, updated on layer changes
+// learned debounce windows saved to the eeprom, moves the VIA and user areas after the kb datablock
+//#define EECONFIG_KB_DATA_SIZE (MATRIX_ROWS * MATRIX_COLS)
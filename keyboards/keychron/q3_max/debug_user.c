@@ -7,4 +7,7 @@ debug_config_user_t debug_config_user = {
 devel_config_t devel_config = {
     .pub_keypress = 0, // publish keypress events
     .process_keypress = 1,
+    .pub_matrix = 0,
+    .pub_trace = 0,
+    .pub_max_latency = 10,
 };
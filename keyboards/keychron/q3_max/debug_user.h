@@ -29,6 +29,9 @@ typedef union {
     struct {
         bool pub_keypress:1;
         bool process_keypress:1;
+        bool pub_matrix:1;      // publish raw matrix row deltas at scan rate
+        bool pub_trace:1;       // record and publish trace points (TRACE_POINT_ENABLE builds)
+        uint8_t pub_max_latency; // ms, max time key events are batched before publishing
     };
     uint32_t raw;
 } devel_config_t;
@@ -36,7 +39,17 @@ extern devel_config_t devel_config;
 
 STATIC_ASSERT_SIZEOF_STRUCT_RAW(debug_config_user_t, "debug_config_t out of size spec.");
 
-#ifdef CONSOLE_ENABLE
+#if defined(QMKATA_LOG_DEFERRED)
+#include "qmkata/qmkata_log.h"
+#define DBG_USR_PREFIX_qmkata    "QA:"
+#define DBG_USR_PREFIX_stats     "STS:"
+#define DBG_USR_PREFIX_user_anim "UAN:"
+// format string literal first, prefixed at compile time, see qmkata_log.h for argument rules
+#define DBG_USR(m, ...) do { \
+    if (debug_config_user.m) { \
+        QMKATA_LOG(DBG_USR_PREFIX_##m __VA_ARGS__); \
+    } } while (0)
+#elif defined(CONSOLE_ENABLE)
 #define DBG_USR(m, ...) do { \
     if (debug_config_user.m) { \
         debug_config_user_t dcu = {.m = 1}; \
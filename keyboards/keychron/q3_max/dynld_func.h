@@ -2,10 +2,14 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "action.h"
+#include "action_layer.h"
 
 
-// dynamically loaded code must contain only 1 function and can not include other functions at the moment,
+// dynamically loaded code must contain only 1 function and can not include other functions,
 // so only calling inline functions allowed in the dynamic loaded function.
+// relocatable modules (dynld_module.h) do not have these restrictions.
 // some math operations are not supported on arm m0 and software implementation is used.
 // these calls to the software implementations do not work in the dynamically loaded code, these callbacks can be used instead.
 typedef int     (*funptr_div)(int a, int b);
@@ -29,6 +33,10 @@ typedef void (*funptr_rgb_matrix_set_color)(int index, uint8_t red, uint8_t gree
 typedef void (*funptr_rgb_matrix_set_color_hsv)(int index, HSV hsv);
 typedef void (*funptr_rgb_matrix_set_color_all)(uint8_t red, uint8_t green, uint8_t blue);
 typedef int (*funptr_printf)(const char* fmt, ...);
+// span operations, ranges are clamped to the led count
+typedef void (*funptr_rgb_matrix_set_span)(int first, int count, const RGB *rgb);
+typedef void (*funptr_rgb_matrix_fill)(int first, int count, uint8_t red, uint8_t green, uint8_t blue);
+typedef void (*funptr_hsv_to_rgb_n)(const HSV *hsv, RGB *rgb, int count);
 
 typedef struct __attribute__ ((aligned (4))) dynld_custom_animation_env {
     funptr_rgb_matrix_set_color         set_color;
@@ -41,10 +49,40 @@ typedef struct __attribute__ ((aligned (4))) dynld_custom_animation_env {
     rgb_config_t                       *rgb_config;
     uint32_t                            time;
     uint8_t                             buf[64];
+
+    // appended, the offsets above stay the same for already built functions
+    funptr_rgb_matrix_set_span          set_span;
+    funptr_rgb_matrix_fill              fill;
+    funptr_hsv_to_rgb_n                 hsv_to_rgb_n;
+    // rgb frame buffer kept between frames, cleared on effect init.
+    // while frame_dirty is set, leds led_min..led_max of the frame are committed in one pass after each call,
+    // it is cleared when the last led range of the rendered frame was committed.
+    RGB                                *frame;
+    uint16_t                            frame_count;
+    uint8_t                             frame_dirty;
 } dynld_custom_animation_env_t;
 
+// bounds checked frame buffer access, inline so single dynld functions can use it
+static inline void dynld_frame_set(dynld_custom_animation_env_t *anim_env, int index, uint8_t red, uint8_t green, uint8_t blue) {
+    if ((unsigned)index >= anim_env->frame_count) return;
+    RGB *rgb = &anim_env->frame[index];
+    rgb->r = red;
+    rgb->g = green;
+    rgb->b = blue;
+    anim_env->frame_dirty = 1;
+}
+
+static inline RGB dynld_frame_get(const dynld_custom_animation_env_t *anim_env, int index) {
+    if ((unsigned)index >= anim_env->frame_count) return (RGB){0};
+    return anim_env->frame[index];
+}
+
 typedef bool (*funptr_animation_run_t)(dynld_custom_animation_env_t *anim_env, effect_params_t* params);
 
+// DYNLD_FUN_ID_ANIMATION may also be a dynld_vm program (dynld_vm.h), run instead of native code.
+// program NULL unloads, returns 0 or -dynld_vm_error
+int dynld_rgb_animation_vm_load(const void *program, size_t size);
+
 typedef struct __attribute__ ((aligned (4))) dynld_test_env {
     funptr_printf   printf;
 
@@ -52,3 +90,15 @@ typedef struct __attribute__ ((aligned (4))) dynld_test_env {
 } dynld_test_env_t;
 
 typedef int (*funptr_test_t)(dynld_test_env_t *test_env);
+
+// dynld hooks, see dynld_hooks.h
+typedef struct __attribute__ ((aligned (4))) dynld_hook_env {
+    funptr_printf   printf;
+    uint32_t        time;       // timer_read32() at hook call
+
+    uint8_t         buf[32];    // hook state kept between calls
+} dynld_hook_env_t;
+
+typedef void (*funptr_hook_t)(dynld_hook_env_t *env);
+typedef bool (*funptr_hook_process_record_t)(dynld_hook_env_t *env, uint16_t keycode, keyrecord_t *record);
+typedef layer_state_t (*funptr_hook_layer_state_t)(dynld_hook_env_t *env, layer_state_t state);
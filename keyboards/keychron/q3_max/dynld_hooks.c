@@ -0,0 +1,110 @@
+#include <string.h>
+#include <stdarg.h>
+#include "quantum.h"
+#include "debug_user.h"
+
+#include "qmkata/QMKata.h"
+#include "dynld_func.h"
+#include "dynld_hooks.h"
+
+extern dynld_funcs_t g_dynld_funcs;
+
+uint8_t g_dynld_hooks_enabled;
+dynld_hook_stats_t g_dynld_hook_stats[DYNLD_HOOK_MAX];
+
+// console output like DBG_USR(qmkata, ...), returns -1 without console
+static int dynld_env_printf(const char* fmt, ...) {
+#ifdef CONSOLE_ENABLE
+    if (!debug_config_user.qmkata) return 0;
+    va_list args;
+    va_start(args, fmt);
+    int n = vprintf(fmt, args);
+    va_end(args);
+    return n;
+#else
+    return -1;
+#endif
+}
+
+static dynld_hook_env_t s_dynld_hook_env = {
+    .printf = dynld_env_printf,
+};
+
+void dynld_hooks_init(void) {
+    uint32_t budget = qmkata_timestamp_freq() / 1000000 * DYNLD_HOOK_BUDGET_US;
+    if (budget == 0) budget = 1; // ms timestamps without cycle counter
+    for (int i = 0; i < DYNLD_HOOK_MAX; i++) {
+        g_dynld_hook_stats[i].budget = budget;
+    }
+}
+
+static inline void* _hook_fun(uint8_t slot) {
+    if (!(g_dynld_hooks_enabled & (1 << slot))) return NULL;
+    return g_dynld_funcs.func[DYNLD_FUN_ID_HOOK_FIRST + slot];
+}
+
+static inline uint32_t _hook_start(void) {
+    s_dynld_hook_env.time = timer_read32();
+    return qmkata_timestamp();
+}
+
+// pub: id, slot, elapsed ticks (32 bits), budget ticks (32 bits)
+static void _hook_stop(uint8_t slot, uint32_t start) {
+    uint32_t elapsed = qmkata_timestamp() - start;
+    dynld_hook_stats_t *stats = &g_dynld_hook_stats[slot];
+    stats->calls++;
+    if (elapsed > stats->max) stats->max = elapsed;
+    if (elapsed <= stats->budget) return;
+
+    g_dynld_hooks_enabled &= ~(1 << slot);
+    stats->overruns++;
+    DBG_USR(qmkata, "dynld hook %u overrun %lu/%lu\n", slot, (unsigned long)elapsed, (unsigned long)stats->budget);
+    uint8_t data[2 + 2*sizeof(uint32_t)];
+    data[0] = QMKATA_ID_DYNLD_HOOK;
+    data[1] = slot;
+    memcpy(&data[2], &elapsed, sizeof(elapsed));
+    memcpy(&data[2+sizeof(elapsed)], &stats->budget, sizeof(stats->budget));
+    qmkata_send_sysex(QMKATA_CMD_PUB, data, sizeof(data));
+}
+
+bool dynld_hook_process_record(uint16_t keycode, keyrecord_t *record) {
+    funptr_hook_process_record_t fun = (funptr_hook_process_record_t)_hook_fun(DYNLD_HOOK_PROCESS_RECORD);
+    if (!fun) return true;
+    uint32_t start = _hook_start();
+    bool ret = fun(&s_dynld_hook_env, keycode, record);
+    _hook_stop(DYNLD_HOOK_PROCESS_RECORD, start);
+    return ret;
+}
+
+void dynld_hook_matrix_scan(void) {
+    funptr_hook_t fun = (funptr_hook_t)_hook_fun(DYNLD_HOOK_MATRIX_SCAN);
+    if (!fun) return;
+    uint32_t start = _hook_start();
+    fun(&s_dynld_hook_env);
+    _hook_stop(DYNLD_HOOK_MATRIX_SCAN, start);
+}
+
+layer_state_t dynld_hook_layer_state(layer_state_t state) {
+    funptr_hook_layer_state_t fun = (funptr_hook_layer_state_t)_hook_fun(DYNLD_HOOK_LAYER_STATE);
+    if (!fun) return state;
+    uint32_t start = _hook_start();
+    state = fun(&s_dynld_hook_env, state);
+    _hook_stop(DYNLD_HOOK_LAYER_STATE, start);
+    return state;
+}
+
+void dynld_hook_housekeeping(void) {
+    funptr_hook_t fun = (funptr_hook_t)_hook_fun(DYNLD_HOOK_HOUSEKEEPING);
+    if (!fun) return;
+    uint32_t start = _hook_start();
+    fun(&s_dynld_hook_env);
+    _hook_stop(DYNLD_HOOK_HOUSEKEEPING, start);
+}
+
+void dynld_hook_indicators(void) {
+    funptr_hook_t fun = (funptr_hook_t)_hook_fun(DYNLD_HOOK_INDICATORS);
+    if (!fun) return;
+    uint32_t start = _hook_start();
+    fun(&s_dynld_hook_env);
+    _hook_stop(DYNLD_HOOK_INDICATORS, start);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "action.h"
+#include "action_layer.h"
+
+// dynld hook slots, loaded code runs in these keyboard callbacks.
+// hook functions come from relocatable module exports (fun id DYNLD_FUN_ID_HOOK_...),
+// each slot has an enable bit and a cycle budget (qmkata_timestamp ticks, dwt cycles on chibios).
+// a hook running longer than its budget is disabled and the overrun published.
+// the budget is checked after the hook returns, a hook which does not return still hangs the keyboard.
+enum dynld_hook_slot {
+    DYNLD_HOOK_PROCESS_RECORD = 0,
+    DYNLD_HOOK_MATRIX_SCAN,
+    DYNLD_HOOK_LAYER_STATE,
+    DYNLD_HOOK_HOUSEKEEPING,
+    DYNLD_HOOK_INDICATORS,
+    DYNLD_HOOK_MAX
+};
+
+#ifndef DYNLD_HOOK_BUDGET_US
+#define DYNLD_HOOK_BUDGET_US 20 // default budget per hook call
+#endif
+
+typedef struct dynld_hook_stats {
+    uint32_t budget;    // ticks
+    uint32_t max;       // longest call, ticks
+    uint32_t calls;
+    uint16_t overruns;
+} dynld_hook_stats_t;
+
+extern uint8_t g_dynld_hooks_enabled; // bit per dynld_hook_slot
+extern dynld_hook_stats_t g_dynld_hook_stats[DYNLD_HOOK_MAX];
+
+void dynld_hooks_init(void);
+
+bool dynld_hook_process_record(uint16_t keycode, keyrecord_t *record);
+void dynld_hook_matrix_scan(void);
+layer_state_t dynld_hook_layer_state(layer_state_t state);
+void dynld_hook_housekeeping(void);
+void dynld_hook_indicators(void);
@@ -0,0 +1,301 @@
+#include <string.h>
+#include <stddef.h>
+#include "quantum.h"
+#include "rgb_matrix.h"
+#include "debug_user.h"
+
+#include "qmkata/QMKata.h"
+#include "dynld_func.h"
+#include "dynld_module.h"
+#include "crc.h"
+#ifdef DYNLD_MODULE_STORE_ENABLE
+#    include <hal.h>
+#endif
+
+extern dynld_funcs_t g_dynld_funcs;
+extern uint32_t thumb_fun_addr(void* funptr);
+
+// libgcc runtime helpers gcc emits calls to, prototypes do not matter for the symbol table
+extern void __aeabi_idiv(void);
+extern void __aeabi_uidiv(void);
+extern void __aeabi_idivmod(void);
+extern void __aeabi_uidivmod(void);
+extern void __aeabi_ldivmod(void);
+extern void __aeabi_uldivmod(void);
+extern void __aeabi_llsl(void);
+extern void __aeabi_llsr(void);
+extern void __aeabi_lasr(void);
+extern void __aeabi_memcpy(void);
+extern void __aeabi_memset(void);
+
+#define DYNLD_SYMBOL(name)      { #name, (const void*)name }
+#define DYNLD_SYMBOL_DATA(name) { #name, (const void*)&name }
+
+const dynld_symbol_t g_dynld_symbols[] = {
+    DYNLD_SYMBOL(memcpy),
+    DYNLD_SYMBOL(memmove),
+    DYNLD_SYMBOL(memset),
+    DYNLD_SYMBOL(memcmp),
+    DYNLD_SYMBOL(__aeabi_idiv),
+    DYNLD_SYMBOL(__aeabi_uidiv),
+    DYNLD_SYMBOL(__aeabi_idivmod),
+    DYNLD_SYMBOL(__aeabi_uidivmod),
+    DYNLD_SYMBOL(__aeabi_ldivmod),
+    DYNLD_SYMBOL(__aeabi_uldivmod),
+    DYNLD_SYMBOL(__aeabi_llsl),
+    DYNLD_SYMBOL(__aeabi_llsr),
+    DYNLD_SYMBOL(__aeabi_lasr),
+    DYNLD_SYMBOL(__aeabi_memcpy),
+    DYNLD_SYMBOL(__aeabi_memset),
+    DYNLD_SYMBOL(timer_read32),
+    DYNLD_SYMBOL(hsv_to_rgb),
+    DYNLD_SYMBOL(rgb_matrix_set_color),
+    DYNLD_SYMBOL(rgb_matrix_set_color_all),
+    DYNLD_SYMBOL_DATA(g_led_config),
+    DYNLD_SYMBOL_DATA(rgb_matrix_config),
+    { NULL, NULL }
+};
+
+static uint8_t s_module_arena[DYNLD_MODULE_ARENA_SIZE] __attribute__((aligned(8)));
+static uint16_t s_module_size;  // image bytes written
+static bool s_module_linked;
+
+uint32_t dynld_symbol_hash(const char *name) {
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static const void* _symbol_lookup(uint32_t name_hash) {
+    for (const dynld_symbol_t *s = g_dynld_symbols; s->name; s++) {
+        if (dynld_symbol_hash(s->name) == name_hash) return s->addr;
+    }
+    return NULL;
+}
+
+void dynld_module_unload(void) {
+    // drop exports pointing into the module before its memory changes
+    for (int i = 0; i < DYNLD_FUN_ID_MAX; i++) {
+        uintptr_t f = (uintptr_t)g_dynld_funcs.func[i];
+        if (f >= (uintptr_t)s_module_arena && f < (uintptr_t)s_module_arena + sizeof(s_module_arena)) {
+            g_dynld_funcs.func[i] = NULL;
+        }
+    }
+    s_module_linked = false;
+    s_module_size = 0;
+}
+
+bool dynld_module_loaded(void) {
+    return s_module_linked;
+}
+
+int dynld_module_write(uint16_t offset, const uint8_t *data, uint16_t len) {
+    if (offset == 0) dynld_module_unload();
+    if (s_module_linked) return -DYNLD_MODULE_ERR_FORMAT; // upload restarts at offset 0
+    if ((uint32_t)offset + len > sizeof(s_module_arena)) return -DYNLD_MODULE_ERR_SIZE;
+    memcpy(&s_module_arena[offset], data, len);
+    s_module_size = MAX(s_module_size, offset + len);
+    return 0;
+}
+
+static int _relocate(const dynld_module_header_t *hdr, const dynld_module_reloc_t *relocs,
+                     const dynld_module_import_t *imports, uint8_t *text) {
+    uintptr_t base[] = {
+        [DYNLD_RELOC_SYM_TEXT] = (uintptr_t)text,
+        [DYNLD_RELOC_SYM_DATA] = (uintptr_t)text + hdr->text_size,
+        [DYNLD_RELOC_SYM_BSS]  = (uintptr_t)text + hdr->text_size + hdr->data_size,
+    };
+    uint32_t image_size = hdr->text_size + hdr->data_size;
+
+    for (uint16_t i = 0; i < hdr->reloc_count; i++) {
+        dynld_module_reloc_t r;
+        memcpy(&r, &relocs[i], sizeof(r));
+        if (image_size < sizeof(uint32_t) || r.offset > image_size - sizeof(uint32_t)) return -DYNLD_MODULE_ERR_RELOC;
+
+        uintptr_t s;
+        if (r.sym < DYNLD_RELOC_SYM_IMPORT) {
+            if (r.sym > DYNLD_RELOC_SYM_BSS) return -DYNLD_MODULE_ERR_RELOC;
+            s = base[r.sym];
+        } else {
+            uint16_t import = r.sym - DYNLD_RELOC_SYM_IMPORT;
+            if (import >= hdr->import_count) return -DYNLD_MODULE_ERR_RELOC;
+            uint32_t name_hash;
+            memcpy(&name_hash, &imports[import].name_hash, sizeof(name_hash));
+            s = (uintptr_t)_symbol_lookup(name_hash);
+            if (!s) {
+                DBG_USR(qmkata, "dynld: import %08lx unresolved\n", (unsigned long)name_hash);
+                return -DYNLD_MODULE_ERR_IMPORT;
+            }
+        }
+
+        uint8_t *p = &text[r.offset];
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        if (r.type == DYNLD_RELOC_ABS32)      v = s + v;
+        else if (r.type == DYNLD_RELOC_REL32) v = s + v - (uintptr_t)p;
+        else return -DYNLD_MODULE_ERR_RELOC;
+        memcpy(p, &v, sizeof(v));
+    }
+    return 0;
+}
+
+int dynld_module_link(void) {
+    if (s_module_linked) return 0;
+    if (s_module_size < sizeof(dynld_module_header_t)) return -DYNLD_MODULE_ERR_SIZE;
+
+    dynld_module_header_t hdr;
+    memcpy(&hdr, s_module_arena, sizeof(hdr));
+    if (hdr.magic != DYNLD_MODULE_MAGIC || hdr.version != DYNLD_MODULE_VERSION) return -DYNLD_MODULE_ERR_FORMAT;
+
+    uint32_t tables_end = sizeof(hdr)
+                        + hdr.export_count * sizeof(dynld_module_export_t)
+                        + hdr.import_count * sizeof(dynld_module_import_t)
+                        + hdr.reloc_count * sizeof(dynld_module_reloc_t);
+    if (hdr.text_offset < tables_end || (hdr.text_offset & 3)) return -DYNLD_MODULE_ERR_FORMAT;
+    // each section fits the arena on its own, the sums below cannot wrap
+    if (hdr.text_size > sizeof(s_module_arena) || hdr.data_size > sizeof(s_module_arena)
+        || hdr.bss_size > sizeof(s_module_arena)) return -DYNLD_MODULE_ERR_SIZE;
+    uint32_t image_end = (uint32_t)hdr.text_offset + hdr.text_size + hdr.data_size;
+    if (image_end > s_module_size || image_end + hdr.bss_size > sizeof(s_module_arena)) return -DYNLD_MODULE_ERR_SIZE;
+
+    const dynld_module_export_t *exports = (const dynld_module_export_t*)&s_module_arena[sizeof(hdr)];
+    const dynld_module_import_t *imports = (const dynld_module_import_t*)&exports[hdr.export_count];
+    const dynld_module_reloc_t *relocs = (const dynld_module_reloc_t*)&imports[hdr.import_count];
+    uint8_t *text = &s_module_arena[hdr.text_offset];
+
+    for (uint16_t i = 0; i < hdr.export_count; i++) {
+        dynld_module_export_t e;
+        memcpy(&e, &exports[i], sizeof(e));
+        if (e.fun_id >= DYNLD_FUN_ID_MAX || e.offset >= hdr.text_size) return -DYNLD_MODULE_ERR_EXPORT;
+    }
+
+    memset(&text[hdr.text_size + hdr.data_size], 0, hdr.bss_size);
+    int rc = _relocate(&hdr, relocs, imports, text);
+    if (rc < 0) {
+        s_module_size = 0; // partially relocated, image must be uploaded again
+        return rc;
+    }
+
+    for (uint16_t i = 0; i < hdr.export_count; i++) {
+        dynld_module_export_t e;
+        memcpy(&e, &exports[i], sizeof(e));
+        g_dynld_funcs.func[e.fun_id] = (void*)thumb_fun_addr(&text[e.offset]);
+        if (e.fun_id == DYNLD_FUN_ID_ANIMATION) dynld_rgb_animation_vm_load(NULL, 0); // native export replaces a vm program
+        DBG_USR(qmkata, "dynld: fun[%u]:%p\n", e.fun_id, g_dynld_funcs.func[e.fun_id]);
+    }
+    s_module_linked = true;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// flash store
+#ifdef DYNLD_MODULE_STORE_ENABLE
+#ifndef DYNLD_MODULE_STORE_WRITE_SIZE
+#define DYNLD_MODULE_STORE_WRITE_SIZE 4 // flash program unit
+#endif
+
+// chibios linker symbols, firmware flash image ends after initialized data
+extern uint8_t __textdata_base__[], __data_base__[], __data_end__[];
+
+static BaseFlash *s_store_flash;
+static flash_sector_t s_store_sector;
+static flash_offset_t s_store_offset;
+
+static bool _store_init(void) {
+    if (s_store_flash) return true;
+    BaseFlash *flash = (BaseFlash *)&EFLD1;
+    const flash_descriptor_t *desc = flashGetDescriptor(flash);
+#ifdef DYNLD_MODULE_STORE_EFL_SECTOR
+    flash_sector_t sector = DYNLD_MODULE_STORE_EFL_SECTOR;
+#else
+    flash_sector_t sector = desc->sectors_count - 1;
+#endif
+    flash_offset_t offset = flashGetSectorOffset(flash, sector);
+    uintptr_t firmware_end = (uintptr_t)__textdata_base__ + (__data_end__ - __data_base__);
+    if ((uintptr_t)desc->address + offset < firmware_end) {
+        DBG_USR(qmkata, "dynld: store sector %u overlaps firmware\n", (unsigned)sector);
+        return false;
+    }
+    if (flashGetSectorSize(flash, sector) < sizeof(dynld_module_store_header_t) + DYNLD_MODULE_ARENA_SIZE) return false;
+    s_store_sector = sector;
+    s_store_offset = offset;
+    s_store_flash = flash;
+    return true;
+}
+
+static const dynld_module_store_header_t* _store_header(void) {
+    return (const dynld_module_store_header_t*)flashGetOffsetAddress(s_store_flash, s_store_offset);
+}
+
+static bool _store_erase(void) {
+    if (eflStart(&EFLD1, NULL) != HAL_RET_SUCCESS) return false;
+    flash_error_t status = flashStartEraseSector(s_store_flash, s_store_sector);
+    if (status == FLASH_NO_ERROR || status == FLASH_BUSY_ERASING) status = flashWaitErase(s_store_flash);
+    eflStop(&EFLD1);
+    return status == FLASH_NO_ERROR;
+}
+
+int dynld_module_store_erase(void) {
+    if (!_store_init()) return -DYNLD_MODULE_ERR_STORE;
+    if (_store_header()->magic == 0xffffffff) return 0; // already erased
+    return _store_erase() ? 0 : -DYNLD_MODULE_ERR_STORE;
+}
+
+int dynld_module_store(void) {
+    if (!_store_init()) return -DYNLD_MODULE_ERR_STORE;
+    if (s_module_linked || s_module_size < sizeof(dynld_module_header_t)) return -DYNLD_MODULE_ERR_SIZE;
+    if (!_store_erase()) return -DYNLD_MODULE_ERR_STORE;
+
+    dynld_module_store_header_t hdr = {
+        .magic = DYNLD_MODULE_STORE_MAGIC,
+        .version = DYNLD_MODULE_STORE_VERSION,
+        .crc = crc32(s_module_arena, s_module_size),
+        .size = s_module_size,
+    };
+    _Static_assert(sizeof(hdr) % DYNLD_MODULE_STORE_WRITE_SIZE == 0, "store header size");
+    uint16_t size = (s_module_size + DYNLD_MODULE_STORE_WRITE_SIZE - 1) & ~(DYNLD_MODULE_STORE_WRITE_SIZE - 1);
+
+    // image first, header last, an interrupted store leaves no valid header
+    if (eflStart(&EFLD1, NULL) != HAL_RET_SUCCESS) return -DYNLD_MODULE_ERR_STORE;
+    flash_error_t status = flashProgram(s_store_flash, s_store_offset + sizeof(hdr), size, s_module_arena);
+    if (status == FLASH_NO_ERROR) {
+        status = flashProgram(s_store_flash, s_store_offset, sizeof(hdr), (const uint8_t*)&hdr);
+    }
+    eflStop(&EFLD1);
+    DBG_USR(qmkata, "dynld: store size=%u,status=%d\n", s_module_size, (int)status);
+    return status == FLASH_NO_ERROR ? 0 : -DYNLD_MODULE_ERR_STORE;
+}
+
+static bool _store_header_valid(const dynld_module_store_header_t *hdr) {
+    return hdr->magic == DYNLD_MODULE_STORE_MAGIC && hdr->version == DYNLD_MODULE_STORE_VERSION
+        && hdr->size <= sizeof(s_module_arena);
+}
+
+bool dynld_module_store_valid(void) {
+    if (!_store_init()) return false;
+    return _store_header_valid(_store_header());
+}
+
+int dynld_module_store_load(void) {
+    if (!_store_init()) return -DYNLD_MODULE_ERR_STORE;
+    const dynld_module_store_header_t *hdr = _store_header();
+    if (!_store_header_valid(hdr)) return -DYNLD_MODULE_ERR_FORMAT;
+
+    const uint8_t *image = (const uint8_t*)&hdr[1];
+    if (crc32(image, hdr->size) != hdr->crc) return -DYNLD_MODULE_ERR_FORMAT;
+
+    dynld_module_write(0, image, hdr->size);
+    return dynld_module_link();
+}
+
+#else
+
+int dynld_module_store(void) { return -DYNLD_MODULE_ERR_STORE; }
+int dynld_module_store_erase(void) { return -DYNLD_MODULE_ERR_STORE; }
+int dynld_module_store_load(void) { return -DYNLD_MODULE_ERR_STORE; }
+bool dynld_module_store_valid(void) { return false; }
+
+#endif
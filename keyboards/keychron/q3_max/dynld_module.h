@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// relocatable dynld module, replaces the "only 1 function" restriction of single dynld functions.
+// host links the module position independent except for the relocations listed in the image,
+// calls into the firmware go through imports, so compile with -mlong-calls (no BL relocations).
+//
+// image (little endian):
+//   dynld_module_header_t
+//   dynld_module_export_t  x export_count
+//   dynld_module_import_t  x import_count
+//   dynld_module_reloc_t   x reloc_count
+//   ... padding up to text_offset (4 bytes aligned)
+//   text (text_size), data (data_size), bss (bss_size, not in image, zeroed on link)
+//
+// the image is loaded and relocated in place, text is executed from ram.
+
+#define DYNLD_MODULE_MAGIC      0x314d4c44 // "DLM1"
+#define DYNLD_MODULE_VERSION    1
+
+#ifndef DYNLD_MODULE_ARENA_SIZE
+#define DYNLD_MODULE_ARENA_SIZE 4096 // max image + bss size
+#endif
+
+// QMKATA_ID_DYNLD_MODULE upload offsets with special meaning
+#define DYNLD_MODULE_OFFSET_LINK        0xffff
+#define DYNLD_MODULE_OFFSET_LINK_STORE  0xfffe // store unrelocated image in flash, then link
+#define DYNLD_MODULE_OFFSET_ERASE       0xfffd // erase stored module
+
+// module store: one flash sector holding dynld_module_store_header_t followed by the image.
+// the sector must be outside the firmware and the wear leveling area, default last flash sector.
+// store and erase run in the QMKATA_ID_DYNLD_MODULE handler: the sector erase (128 KB on the
+// STM32F401, 1 s typical, 2 s max) stalls code fetches from flash, the keyboard does not scan
+// and the response comes after it. hosts wait accordingly, never store from a keypress.
+#if defined(PROTOCOL_CHIBIOS) && defined(HAL_USE_EFL)
+#define DYNLD_MODULE_STORE_ENABLE
+#endif
+#define DYNLD_MODULE_STORE_MAGIC    0x534d4c44 // "DLMS"
+#define DYNLD_MODULE_STORE_VERSION  2
+
+typedef struct __attribute__((packed)) dynld_module_store_header {
+    uint32_t magic;
+    uint8_t  version;       // store format, image format is in the image header
+    uint8_t  reserved;
+    uint16_t size;          // image size
+    uint32_t crc;           // crc32 of the image
+} dynld_module_store_header_t;
+
+typedef struct __attribute__((packed)) dynld_module_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t text_offset;   // from image start
+    uint32_t text_size;
+    uint32_t data_size;     // data follows text
+    uint32_t bss_size;      // bss follows data
+    uint16_t export_count;
+    uint16_t import_count;
+    uint16_t reloc_count;
+    uint16_t reserved;
+} dynld_module_header_t;
+
+// module function published as dynld function (g_dynld_funcs.func[fun_id])
+typedef struct __attribute__((packed)) dynld_module_export {
+    uint16_t fun_id;        // DYNLD_FUNC_ID
+    uint16_t reserved;
+    uint32_t offset;        // from text start
+} dynld_module_export_t;
+
+// firmware symbol, resolved by name hash against g_dynld_symbols
+typedef struct __attribute__((packed)) dynld_module_import {
+    uint32_t name_hash;     // dynld_symbol_hash(name)
+} dynld_module_import_t;
+
+enum dynld_module_reloc_type {
+    DYNLD_RELOC_ABS32 = 1,  // R_ARM_ABS32:  *P = S + A
+    DYNLD_RELOC_REL32 = 2,  // R_ARM_REL32:  *P = S + A - P
+};
+
+// reloc symbol: section base or import
+enum dynld_module_reloc_sym {
+    DYNLD_RELOC_SYM_TEXT   = 0,
+    DYNLD_RELOC_SYM_DATA   = 1,
+    DYNLD_RELOC_SYM_BSS    = 2,
+    DYNLD_RELOC_SYM_IMPORT = 0x10, // + import index
+};
+
+typedef struct __attribute__((packed)) dynld_module_reloc {
+    uint32_t offset;        // P, from text start, word at P holds the addend A
+    uint8_t  type;          // dynld_module_reloc_type
+    uint8_t  reserved;
+    uint16_t sym;           // dynld_module_reloc_sym
+} dynld_module_reloc_t;
+
+enum dynld_module_error {
+    DYNLD_MODULE_ERR_SIZE = 1,  // image does not fit or incomplete
+    DYNLD_MODULE_ERR_FORMAT,    // bad magic, version or layout
+    DYNLD_MODULE_ERR_RELOC,
+    DYNLD_MODULE_ERR_IMPORT,    // unresolved import
+    DYNLD_MODULE_ERR_EXPORT,
+    DYNLD_MODULE_ERR_STORE,     // flash store not available or write failed
+};
+
+typedef struct dynld_symbol {
+    const char *name;
+    const void *addr;
+} dynld_symbol_t;
+
+// firmware symbols modules can import, terminated by { NULL, NULL }
+extern const dynld_symbol_t g_dynld_symbols[];
+
+uint32_t dynld_symbol_hash(const char *name); // fnv-1a 32 bits
+
+// write image chunk, offset 0 unloads the current module
+int dynld_module_write(uint16_t offset, const uint8_t *data, uint16_t len);
+// relocate, resolve imports and publish exports, returns 0 or -dynld_module_error
+int dynld_module_link(void);
+void dynld_module_unload(void);
+bool dynld_module_loaded(void);
+
+// store current (not yet linked) image in flash
+int dynld_module_store(void);
+int dynld_module_store_erase(void);
+// flash store holds a module header, no crc check
+bool dynld_module_store_valid(void);
+// load and link stored module, called at keyboard_post_init_user unless
+// the DYNLD_MODULE_SKIP_ROW, DYNLD_MODULE_SKIP_COL key is held at boot
+int dynld_module_store_load(void);
@@ -0,0 +1,214 @@
+#include <string.h>
+#include <lib/lib8tion/lib8tion.h>
+
+#include "dynld_vm.h"
+
+// operand checks per op
+#define OPF_A       0x01    // a is a register
+#define OPF_B       0x02    // b is a register
+#define OPF_C       0x04    // c is a register
+#define OPF_B3      0x08    // b, b + 1, b + 2 are registers
+#define OPF_IN      0x10    // b is a dynld_vm_input
+#define OPF_JMP     0x20    // imm16 is a forward jump target
+#define OPF_LOOP    0x40    // c is a backward offset
+
+static const uint8_t s_op_flags[DYNLD_VM_OP_MAX_] = {
+    [DYNLD_VM_OP_HALT]       = 0,
+    [DYNLD_VM_OP_MOV]        = OPF_A | OPF_B,
+    [DYNLD_VM_OP_LDI]        = OPF_A,
+    [DYNLD_VM_OP_LDIH]       = OPF_A,
+    [DYNLD_VM_OP_ENV]        = OPF_A | OPF_IN,
+    [DYNLD_VM_OP_ADD]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_SUB]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_MUL]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_DIV]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_MOD]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_AND]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_OR]         = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_XOR]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_SHL]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_SHR]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_ADDI]       = OPF_A | OPF_B,
+    [DYNLD_VM_OP_MIN]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_MAX]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_SLT]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_SLTU]       = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_SEQ]        = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_ABS]        = OPF_A | OPF_B,
+    [DYNLD_VM_OP_U8]         = OPF_A | OPF_B,
+    [DYNLD_VM_OP_S8]         = OPF_A | OPF_B,
+    [DYNLD_VM_OP_JMP]        = OPF_JMP,
+    [DYNLD_VM_OP_JZ]         = OPF_A | OPF_JMP,
+    [DYNLD_VM_OP_JNZ]        = OPF_A | OPF_JMP,
+    [DYNLD_VM_OP_LOOP]       = OPF_A | OPF_B | OPF_LOOP,
+    [DYNLD_VM_OP_SCALE8]     = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_SCALE16BY8] = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_QADD8]      = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_QSUB8]      = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_SQRT16]     = OPF_A | OPF_B,
+    [DYNLD_VM_OP_ATAN2_8]    = OPF_A | OPF_B | OPF_C,
+    [DYNLD_VM_OP_SIN8]       = OPF_A | OPF_B,
+    [DYNLD_VM_OP_COS8]       = OPF_A | OPF_B,
+    [DYNLD_VM_OP_RAND8]      = OPF_A,
+    [DYNLD_VM_OP_RAND8_MAX]  = OPF_A | OPF_B,
+    [DYNLD_VM_OP_LEDX]       = OPF_A | OPF_B,
+    [DYNLD_VM_OP_LEDY]       = OPF_A | OPF_B,
+    [DYNLD_VM_OP_LEDF]       = OPF_A | OPF_B,
+    [DYNLD_VM_OP_SETHSV]     = OPF_A | OPF_B3,
+    [DYNLD_VM_OP_SETRGB]     = OPF_A | OPF_B3,
+    [DYNLD_VM_OP_LDB]        = OPF_A | OPF_B,
+    [DYNLD_VM_OP_STB]        = OPF_A | OPF_B,
+    [DYNLD_VM_OP_LDW]        = OPF_A | OPF_B,
+    [DYNLD_VM_OP_STW]        = OPF_A | OPF_B,
+};
+
+#define INSN_OP(insn)   ((uint8_t)(insn))
+#define INSN_A(insn)    ((uint8_t)((insn) >> 8))
+#define INSN_B(insn)    ((uint8_t)((insn) >> 16))
+#define INSN_C(insn)    ((uint8_t)((insn) >> 24))
+#define INSN_IMM(insn)  ((uint16_t)((insn) >> 16))
+
+bool dynld_vm_is_program(const void *data, size_t size) {
+    uint32_t magic;
+    if (!data || size < sizeof(dynld_vm_header_t)) return false;
+    memcpy(&magic, data, sizeof(magic));
+    return magic == DYNLD_VM_MAGIC;
+}
+
+static int _dynld_vm_validate(const uint32_t *code, uint16_t count) {
+    for (uint16_t pc = 0; pc < count; pc++) {
+        uint32_t insn = code[pc];
+        uint8_t op = INSN_OP(insn);
+        if (op >= DYNLD_VM_OP_MAX_) return DYNLD_VM_ERR_OP;
+        uint8_t flags = s_op_flags[op];
+        if ((flags & OPF_A) && INSN_A(insn) >= DYNLD_VM_REGS) return DYNLD_VM_ERR_OPERAND;
+        if ((flags & OPF_B) && INSN_B(insn) >= DYNLD_VM_REGS) return DYNLD_VM_ERR_OPERAND;
+        if ((flags & OPF_C) && INSN_C(insn) >= DYNLD_VM_REGS) return DYNLD_VM_ERR_OPERAND;
+        if ((flags & OPF_B3) && INSN_B(insn) + 2 >= DYNLD_VM_REGS) return DYNLD_VM_ERR_OPERAND;
+        if ((flags & OPF_IN) && INSN_B(insn) >= DYNLD_VM_IN_MAX) return DYNLD_VM_ERR_OPERAND;
+        // target == count is a jump to the end, same as HALT
+        if ((flags & OPF_JMP) && (INSN_IMM(insn) <= pc || INSN_IMM(insn) > count)) return DYNLD_VM_ERR_JUMP;
+        if ((flags & OPF_LOOP) && (INSN_C(insn) == 0 || INSN_C(insn) > pc)) return DYNLD_VM_ERR_JUMP;
+    }
+    return DYNLD_VM_OK;
+}
+
+int dynld_vm_check(const void *data, size_t size) {
+    if (!dynld_vm_is_program(data, size) || ((uintptr_t)data & 3)) return -DYNLD_VM_ERR_HEADER;
+    dynld_vm_header_t header;
+    memcpy(&header, data, sizeof(header));
+    if (header.insn_count == 0 || sizeof(header) + header.insn_count * sizeof(uint32_t) > size) return -DYNLD_VM_ERR_HEADER;
+    return -_dynld_vm_validate((const uint32_t *)((const uint8_t *)data + sizeof(header)), header.insn_count);
+}
+
+int dynld_vm_load(dynld_vm_t *vm, const void *data, size_t size) {
+    dynld_vm_unload(vm);
+    int rc = dynld_vm_check(data, size);
+    vm->error = -rc;
+    if (rc < 0) return rc;
+
+    dynld_vm_header_t header;
+    memcpy(&header, data, sizeof(header));
+    memset(vm->mem, 0, sizeof(vm->mem));
+    vm->count = header.insn_count;
+    vm->budget = header.budget ? header.budget : DYNLD_VM_BUDGET_DEFAULT;
+    vm->steps = 0;
+    vm->steps_max = 0;
+    vm->code = (const uint32_t *)((const uint8_t *)data + sizeof(header));
+    return 0;
+}
+
+void dynld_vm_unload(dynld_vm_t *vm) {
+    vm->code = NULL;
+    vm->count = 0;
+}
+
+int dynld_vm_run(dynld_vm_t *vm) {
+    const uint32_t *code = vm->code;
+    if (!code) return -DYNLD_VM_ERR_NOPROG;
+    const dynld_vm_env_t *env = vm->env;
+    const uint16_t count = vm->count;
+    uint32_t budget = vm->budget;
+    int32_t r[DYNLD_VM_REGS] = { 0 };
+    uint16_t pc = 0;
+
+    // operands were validated on load, the masks only keep a corrupted program inside the vm state
+#define RA r[a & (DYNLD_VM_REGS - 1)]
+#define RB r[b & (DYNLD_VM_REGS - 1)]
+#define RC r[c & (DYNLD_VM_REGS - 1)]
+    while (pc < count) {
+        if (budget-- == 0) {
+            vm->steps = vm->budget;
+            vm->error = DYNLD_VM_ERR_BUDGET;
+            dynld_vm_unload(vm);
+            return -DYNLD_VM_ERR_BUDGET;
+        }
+        uint32_t insn = code[pc++];
+        uint8_t a = INSN_A(insn);
+        uint8_t b = INSN_B(insn);
+        uint8_t c = INSN_C(insn);
+        switch (INSN_OP(insn)) {
+            case DYNLD_VM_OP_HALT:       pc = count; break;
+            case DYNLD_VM_OP_MOV:        RA = RB; break;
+            case DYNLD_VM_OP_LDI:        RA = (int16_t)INSN_IMM(insn); break;
+            case DYNLD_VM_OP_LDIH:       RA = (int32_t)(((uint32_t)RA & 0xffff) | (uint32_t)INSN_IMM(insn) << 16); break;
+            case DYNLD_VM_OP_ENV:        RA = b < DYNLD_VM_IN_MAX ? vm->in[b] : 0; break;
+            case DYNLD_VM_OP_ADD:        RA = (int32_t)((uint32_t)RB + (uint32_t)RC); break;
+            case DYNLD_VM_OP_SUB:        RA = (int32_t)((uint32_t)RB - (uint32_t)RC); break;
+            case DYNLD_VM_OP_MUL:        RA = (int32_t)((uint32_t)RB * (uint32_t)RC); break;
+            case DYNLD_VM_OP_DIV:        RA = (RC == 0 || (RB == INT32_MIN && RC == -1)) ? 0 : RB / RC; break;
+            case DYNLD_VM_OP_MOD:        RA = (RC == 0 || (RB == INT32_MIN && RC == -1)) ? 0 : RB % RC; break;
+            case DYNLD_VM_OP_AND:        RA = RB & RC; break;
+            case DYNLD_VM_OP_OR:         RA = RB | RC; break;
+            case DYNLD_VM_OP_XOR:        RA = RB ^ RC; break;
+            case DYNLD_VM_OP_SHL:        RA = (int32_t)((uint32_t)RB << (RC & 31)); break;
+            case DYNLD_VM_OP_SHR:        RA = RB >> (RC & 31); break;
+            case DYNLD_VM_OP_ADDI:       RA = (int32_t)((uint32_t)RB + (uint32_t)(int8_t)c); break;
+            case DYNLD_VM_OP_MIN:        RA = RB < RC ? RB : RC; break;
+            case DYNLD_VM_OP_MAX:        RA = RB > RC ? RB : RC; break;
+            case DYNLD_VM_OP_SLT:        RA = RB < RC; break;
+            case DYNLD_VM_OP_SLTU:       RA = (uint32_t)RB < (uint32_t)RC; break;
+            case DYNLD_VM_OP_SEQ:        RA = RB == RC; break;
+            case DYNLD_VM_OP_ABS:        RA = RB < 0 ? (int32_t)(0u - (uint32_t)RB) : RB; break;
+            case DYNLD_VM_OP_U8:         RA = (uint8_t)RB; break;
+            case DYNLD_VM_OP_S8:         RA = (int8_t)RB; break;
+            case DYNLD_VM_OP_JMP:        pc = INSN_IMM(insn); break;
+            case DYNLD_VM_OP_JZ:         if (RA == 0) pc = INSN_IMM(insn); break;
+            case DYNLD_VM_OP_JNZ:        if (RA != 0) pc = INSN_IMM(insn); break;
+            case DYNLD_VM_OP_LOOP:       if (++RA < RB) pc -= c + 1; break;
+            case DYNLD_VM_OP_SCALE8:     RA = scale8(RB, RC); break;
+            case DYNLD_VM_OP_SCALE16BY8: RA = scale16by8(RB, RC); break;
+            case DYNLD_VM_OP_QADD8:      RA = qadd8(RB, RC); break;
+            case DYNLD_VM_OP_QSUB8:      RA = qsub8(RB, RC); break;
+            case DYNLD_VM_OP_SQRT16:     RA = sqrt16(RB); break;
+            case DYNLD_VM_OP_ATAN2_8:    RA = atan2_8(RB, RC); break;
+            case DYNLD_VM_OP_SIN8:       RA = sin8(RB); break;
+            case DYNLD_VM_OP_COS8:       RA = cos8(RB); break;
+            case DYNLD_VM_OP_RAND8:      RA = random8(); break;
+            case DYNLD_VM_OP_RAND8_MAX:  RA = random8_max(RB); break;
+            case DYNLD_VM_OP_LEDX:       RA = (uint32_t)RB < env->led_count ? env->led_point[RB * 2] : 0; break;
+            case DYNLD_VM_OP_LEDY:       RA = (uint32_t)RB < env->led_count ? env->led_point[RB * 2 + 1] : 0; break;
+            case DYNLD_VM_OP_LEDF:       RA = (uint32_t)RB < env->led_count ? env->led_flags[RB] : 0; break;
+            case DYNLD_VM_OP_SETHSV:
+                if ((uint32_t)RA < env->led_count && b + 2 < DYNLD_VM_REGS) env->set_hsv(RA, r[b], r[b + 1], r[b + 2]);
+                break;
+            case DYNLD_VM_OP_SETRGB:
+                if ((uint32_t)RA < env->led_count && b + 2 < DYNLD_VM_REGS) env->set_rgb(RA, r[b], r[b + 1], r[b + 2]);
+                break;
+            case DYNLD_VM_OP_LDB:        RA = vm->mem[(RB + (int8_t)c) & (DYNLD_VM_MEM_SIZE - 1)]; break;
+            case DYNLD_VM_OP_STB:        vm->mem[(RB + (int8_t)c) & (DYNLD_VM_MEM_SIZE - 1)] = RA; break;
+            case DYNLD_VM_OP_LDW:        RA = ((int32_t *)vm->mem)[(RB + (int8_t)c) & (DYNLD_VM_MEM_SIZE / 4 - 1)]; break;
+            case DYNLD_VM_OP_STW:        ((int32_t *)vm->mem)[(RB + (int8_t)c) & (DYNLD_VM_MEM_SIZE / 4 - 1)] = RA; break;
+            default:
+                vm->error = DYNLD_VM_ERR_OP;
+                dynld_vm_unload(vm);
+                return -DYNLD_VM_ERR_OP;
+        }
+    }
+#undef RA
+#undef RB
+#undef RC
+    vm->steps = vm->budget - budget;
+    if (vm->steps > vm->steps_max) vm->steps_max = vm->steps;
+    return 0;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// dynld bytecode vm, portable alternative to native dynld animations.
+// a program is uploaded like a native function (same fun id, same upload path),
+// the loader tells them apart by the program magic.
+//
+// program (little endian, 4 bytes aligned):
+//   dynld_vm_header_t
+//   uint32_t insn[insn_count]
+//
+// instruction: op | a << 8 | b << 16 | c << 24, a b c are registers or immediates depending on op.
+// 16 int32 registers, cleared at the start of each frame, state between frames is kept in mem.
+// the program is validated on load (ops, registers, jump targets), at run time:
+//  - jumps only go forward, the only backward branch is LOOP (counter register against limit register)
+//  - each frame runs at most budget instructions, a program exceeding it is unloaded
+//  - led index, mem address and divisor are range checked, out of range access is ignored or reads 0
+
+#define DYNLD_VM_MAGIC          0x314d5644 // "DVM1"
+#define DYNLD_VM_REGS           16
+#define DYNLD_VM_MEM_SIZE       256 // bytes, power of 2
+
+#ifndef DYNLD_VM_BUDGET_DEFAULT
+#define DYNLD_VM_BUDGET_DEFAULT 8192 // instructions per frame when the header budget is 0
+#endif
+
+typedef struct __attribute__((packed)) dynld_vm_header {
+    uint32_t magic;
+    uint16_t insn_count;
+    uint16_t budget;        // instructions per frame, 0 default
+} dynld_vm_header_t;
+
+enum dynld_vm_op {
+    DYNLD_VM_OP_HALT = 0,   // end of frame
+    DYNLD_VM_OP_MOV,        // a = b
+    DYNLD_VM_OP_LDI,        // a = signed imm16
+    DYNLD_VM_OP_LDIH,       // a = a & 0xffff | imm16 << 16
+    DYNLD_VM_OP_ENV,        // a = in[b], dynld_vm_input
+    DYNLD_VM_OP_ADD,        // a = b + c
+    DYNLD_VM_OP_SUB,        // a = b - c
+    DYNLD_VM_OP_MUL,        // a = b * c
+    DYNLD_VM_OP_DIV,        // a = b / c, 0 if c is 0
+    DYNLD_VM_OP_MOD,        // a = b % c, 0 if c is 0
+    DYNLD_VM_OP_AND,        // a = b & c
+    DYNLD_VM_OP_OR,         // a = b | c
+    DYNLD_VM_OP_XOR,        // a = b ^ c
+    DYNLD_VM_OP_SHL,        // a = b << (c & 31)
+    DYNLD_VM_OP_SHR,        // a = b >> (c & 31), arithmetic
+    DYNLD_VM_OP_ADDI,       // a = b + signed imm8 c
+    DYNLD_VM_OP_MIN,        // a = min(b, c)
+    DYNLD_VM_OP_MAX,        // a = max(b, c)
+    DYNLD_VM_OP_SLT,        // a = b < c, signed
+    DYNLD_VM_OP_SLTU,       // a = b < c, unsigned
+    DYNLD_VM_OP_SEQ,        // a = b == c
+    DYNLD_VM_OP_ABS,        // a = |b|
+    DYNLD_VM_OP_U8,         // a = (uint8_t)b
+    DYNLD_VM_OP_S8,         // a = (int8_t)b
+    DYNLD_VM_OP_JMP,        // pc = imm16, forward only
+    DYNLD_VM_OP_JZ,         // if a == 0 pc = imm16, forward only
+    DYNLD_VM_OP_JNZ,        // if a != 0 pc = imm16, forward only
+    DYNLD_VM_OP_LOOP,       // if ++a < b jump back c instructions from the LOOP, c >= 1
+    // lib8tion intrinsics, operands are cast to the lib8tion parameter types
+    DYNLD_VM_OP_SCALE8,     // a = scale8(b, c)
+    DYNLD_VM_OP_SCALE16BY8, // a = scale16by8(b, c)
+    DYNLD_VM_OP_QADD8,      // a = qadd8(b, c)
+    DYNLD_VM_OP_QSUB8,      // a = qsub8(b, c)
+    DYNLD_VM_OP_SQRT16,     // a = sqrt16(b)
+    DYNLD_VM_OP_ATAN2_8,    // a = atan2_8(b dy, c dx)
+    DYNLD_VM_OP_SIN8,       // a = sin8(b)
+    DYNLD_VM_OP_COS8,       // a = cos8(b)
+    DYNLD_VM_OP_RAND8,      // a = random8()
+    DYNLD_VM_OP_RAND8_MAX,  // a = random8_max(b)
+    // leds
+    DYNLD_VM_OP_LEDX,       // a = point[b].x
+    DYNLD_VM_OP_LEDY,       // a = point[b].y
+    DYNLD_VM_OP_LEDF,       // a = flags[b]
+    DYNLD_VM_OP_SETHSV,     // led a = hsv b, b + 1, b + 2
+    DYNLD_VM_OP_SETRGB,     // led a = rgb b, b + 1, b + 2
+    // mem, persistent between frames, cleared on load
+    DYNLD_VM_OP_LDB,        // a = mem[b + imm8 c], uint8_t
+    DYNLD_VM_OP_STB,        // mem[b + imm8 c] = a
+    DYNLD_VM_OP_LDW,        // a = mem32[b + imm8 c], word index
+    DYNLD_VM_OP_STW,        // mem32[b + imm8 c] = a, word index
+    DYNLD_VM_OP_MAX_
+};
+
+// frame inputs, read with DYNLD_VM_OP_ENV
+enum dynld_vm_input {
+    DYNLD_VM_IN_TIME = 0,   // g_rgb_timer
+    DYNLD_VM_IN_LED_MIN,    // led range of this frame iteration
+    DYNLD_VM_IN_LED_MAX,
+    DYNLD_VM_IN_INIT,       // first frame of the effect
+    DYNLD_VM_IN_FLAGS,      // led flags to render
+    DYNLD_VM_IN_HUE,        // rgb_matrix_config
+    DYNLD_VM_IN_SAT,
+    DYNLD_VM_IN_VAL,
+    DYNLD_VM_IN_SPEED,
+    DYNLD_VM_IN_LED_COUNT,
+    DYNLD_VM_IN_CENTER_X,
+    DYNLD_VM_IN_CENTER_Y,
+    DYNLD_VM_IN_MAX
+};
+
+enum dynld_vm_error {
+    DYNLD_VM_OK = 0,
+    DYNLD_VM_ERR_HEADER,    // bad magic or size
+    DYNLD_VM_ERR_OP,        // unknown op
+    DYNLD_VM_ERR_OPERAND,   // register or input out of range
+    DYNLD_VM_ERR_JUMP,      // backward or out of program jump
+    DYNLD_VM_ERR_BUDGET,    // frame exceeded the instruction budget
+    DYNLD_VM_ERR_NOPROG,
+};
+
+#define DYNLD_VM_INSN(op, a, b, c)  ((uint32_t)(op) | (uint32_t)(uint8_t)(a) << 8 | (uint32_t)(uint8_t)(b) << 16 | (uint32_t)(uint8_t)(c) << 24)
+#define DYNLD_VM_INSN_IMM(op, a, imm) ((uint32_t)(op) | (uint32_t)(uint8_t)(a) << 8 | (uint32_t)(uint16_t)(imm) << 16)
+
+typedef struct dynld_vm_env {
+    void (*set_hsv)(int index, uint8_t h, uint8_t s, uint8_t v);
+    void (*set_rgb)(int index, uint8_t r, uint8_t g, uint8_t b);
+    const uint8_t *led_point;   // x, y per led (led_point_t layout)
+    const uint8_t *led_flags;
+    uint8_t        led_count;
+} dynld_vm_env_t;
+
+typedef struct dynld_vm {
+    const dynld_vm_env_t *env;
+    const uint32_t       *code;     // NULL when no program is loaded
+    uint16_t              count;
+    uint16_t              budget;
+    uint8_t               error;    // dynld_vm_error of the last load or run
+    uint32_t              steps;    // instructions run in the last frame
+    uint32_t              steps_max;
+    int32_t               in[DYNLD_VM_IN_MAX];
+    uint8_t               mem[DYNLD_VM_MEM_SIZE] __attribute__((aligned(4)));
+} dynld_vm_t;
+
+bool dynld_vm_is_program(const void *data, size_t size);
+// validates the program without loading it, returns 0 or -dynld_vm_error
+int  dynld_vm_check(const void *data, size_t size);
+// validates and loads the program, the program is run in place and must stay valid while loaded
+int  dynld_vm_load(dynld_vm_t *vm, const void *data, size_t size);
+void dynld_vm_unload(dynld_vm_t *vm);
+static inline bool dynld_vm_loaded(const dynld_vm_t *vm) {
+    return vm->code != NULL;
+}
+// runs one frame with the inputs in vm->in, returns 0 or -dynld_vm_error
+int  dynld_vm_run(dynld_vm_t *vm);
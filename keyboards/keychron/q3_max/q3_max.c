@@ -31,6 +31,36 @@
 #define POWER_ON_LED_DURATION 3000
 static uint32_t power_on_indicator_timer;
 
+#if defined(DEBOUNCE_ADAPTIVE) && (EECONFIG_KB_DATA_SIZE) > 0
+#    include "debounce_adaptive.h"
+
+_Static_assert((EECONFIG_KB_DATA_SIZE) == sizeof(debounce_adaptive_windows), "kb datablock holds the debounce windows");
+
+#    ifndef DEBOUNCE_ADAPTIVE_SAVE_INTERVAL
+#        define DEBOUNCE_ADAPTIVE_SAVE_INTERVAL 600000 // ms, only the changed windows are written
+#    endif
+static uint32_t debounce_adaptive_save_timer;
+
+// windows learned in the previous sessions, 0: not learned yet, clamped as the bounds may differ
+static void debounce_adaptive_load(void) {
+    uint8_t windows[MATRIX_ROWS][MATRIX_COLS];
+    eeconfig_read_kb_datablock(windows);
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (windows[row][col]) debounce_adaptive_windows[row][col] = debounce_adaptive_clamp(windows[row][col]);
+        }
+    }
+    debounce_adaptive_save_timer = timer_read32();
+}
+
+static void debounce_adaptive_save_task(void) {
+    if (timer_elapsed32(debounce_adaptive_save_timer) > DEBOUNCE_ADAPTIVE_SAVE_INTERVAL) {
+        debounce_adaptive_save_timer = timer_read32();
+        eeconfig_update_kb_datablock(debounce_adaptive_windows);
+    }
+}
+#endif
+
 #ifdef DIP_SWITCH_ENABLE
 bool dip_switch_update_kb(uint8_t index, bool active) {
     if (dip_switch_update_user(index, active)) return true;
@@ -52,6 +82,9 @@ void keyboard_post_init_kb(void) {
 #endif
 
     power_on_indicator_timer = timer_read32();
+#if defined(DEBOUNCE_ADAPTIVE) && (EECONFIG_KB_DATA_SIZE) > 0
+    debounce_adaptive_load();
+#endif
 #ifdef ENCODER_ENABLE
     encoder_cb_init();
 #endif
@@ -77,6 +110,10 @@ bool keychron_task_kb(void) {
         }
     }
 
+#if defined(DEBOUNCE_ADAPTIVE) && (EECONFIG_KB_DATA_SIZE) > 0
+    debounce_adaptive_save_task();
+#endif
+
     keychron_task_user();
     return true;
 }
@@ -18,9 +18,33 @@
 #include "keychron_task.h"
 #ifdef QMKATA_ENABLE
 #include "qmkata/QMKata.h"
+#include "dynld_module.h"
+#include "dynld_hooks.h"
 #include "debug_user.h"
 #endif
 
+#ifdef QMKATA_ENABLE
+// key held at boot skips the stored module, a module crashing the keyboard can be erased then
+#ifndef DYNLD_MODULE_SKIP_ROW
+#define DYNLD_MODULE_SKIP_ROW 0
+#endif
+#ifndef DYNLD_MODULE_SKIP_COL
+#define DYNLD_MODULE_SKIP_COL 1 // F1, next to the bootmagic key
+#endif
+
+static bool _dynld_module_skip_key_held(void) {
+    // same scan as bootmagic, matrix state is not debounced yet at keyboard_post_init
+    matrix_scan();
+#if defined(DEBOUNCE) && DEBOUNCE > 0
+    wait_ms(DEBOUNCE * 2);
+#else
+    wait_ms(30);
+#endif
+    matrix_scan();
+    return matrix_get_row(DYNLD_MODULE_SKIP_ROW) & ((matrix_row_t)1 << DYNLD_MODULE_SKIP_COL);
+}
+#endif
+
 void keyboard_post_init_user(void) {
 #ifdef QMKATA_ENABLE
 #ifdef DEVEL_BUILD
@@ -28,6 +52,16 @@ void keyboard_post_init_user(void) {
     //debug_config_user.qmkata = 1;
 #endif
     qmkata_init("Keychron QMKata");
+    dynld_hooks_init();
+    // custom effects from a stored module are available without host,
+    // the skip key is only scanned when there is a module to skip
+    if (dynld_module_store_valid()) {
+        if (_dynld_module_skip_key_held()) {
+            DBG_USR(qmkata, "dynld: stored module skipped\n");
+        } else {
+            dynld_module_store_load();
+        }
+    }
 #endif
 }
 
@@ -85,8 +119,18 @@ static inline void _stats_stop(stats_time_t *stats, const char *name) {
 extern rgb_matrix_host_buffer_t g_rgb_matrix_host_buf;
 
 // render rgb matrix "host buffer" set by user from host
+// timed host frames are swapped here, indicators are called once per rendered frame right before flush
 void rgb_matrix_host_buf_render(void)
 {
+    rgb_matrix_host_buffer_t *front = rgb_matrix_host_frame_present(g_rgb_timer);
+    if (front) {
+        for (uint8_t li = 0; li < RGB_MATRIX_LED_COUNT; li++) {
+            if (front->led[li].duration > 0) {
+                rgb_matrix_set_color(li, front->led[li].r, front->led[li].g, front->led[li].b);
+            }
+        }
+    }
+    dynld_hook_indicators();
     if (!g_rgb_matrix_host_buf.written) return;
     STATS_START(&stats_rgb_render, 1000);
     bool matrix_set = 0;
@@ -100,6 +144,21 @@ void rgb_matrix_host_buf_render(void)
     if (!matrix_set) g_rgb_matrix_host_buf.written = 0;
     STATS_STOP(&stats_rgb_render, "rgb buf render");
 }
+
+// dynld hook points
+bool process_record_keychron_kb(uint16_t keycode, keyrecord_t *record) {
+    return dynld_hook_process_record(keycode, record);
+}
+
+void matrix_scan_kb(void) {
+    dynld_hook_matrix_scan();
+    matrix_scan_user();
+}
+
+layer_state_t layer_state_set_kb(layer_state_t state) {
+    state = dynld_hook_layer_state(state);
+    return layer_state_set_user(state);
+}
 #endif
 
 // user override of mac/win mode and keyboard mac/win switch state
@@ -143,5 +202,6 @@ void keychron_task_user(void) {
     STATS_START(&stats_qmkata_task, 10000);
     qmkata_task();
     STATS_STOP(&stats_qmkata_task, "qmkata task");
+    dynld_hook_housekeeping();
 #endif
 }
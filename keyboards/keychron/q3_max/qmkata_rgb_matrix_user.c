@@ -5,8 +5,11 @@
 
 #include "qmkata/QMKata.h"
 #include "dynld_func.h"
+#include "dynld_vm.h"
 
 extern dynld_funcs_t g_dynld_funcs;
+extern const led_point_t k_rgb_matrix_center;
+RGB rgb_matrix_hsv_to_rgb(HSV hsv);
 
 static int dynld_env_printf(const char* fmt, ...) {
 /*
@@ -60,6 +63,37 @@ static void _rgb_matrix_set_color_hsv(int index, HSV hsv)
     rgb_matrix_set_color(index, rgb.r, rgb.g, rgb.b);
 }
 
+static void _clamp_span(int *first, int *count) {
+    if (*first < 0) {
+        *count += *first;
+        *first = 0;
+    }
+    if (*count > RGB_MATRIX_LED_COUNT - *first) *count = RGB_MATRIX_LED_COUNT - *first;
+}
+
+static void _rgb_matrix_set_span(int first, int count, const RGB *rgb) {
+    int skip = first < 0 ? -first : 0;
+    _clamp_span(&first, &count);
+    for (int i = 0; i < count; i++) {
+        rgb_matrix_set_color(first + i, rgb[skip + i].r, rgb[skip + i].g, rgb[skip + i].b);
+    }
+}
+
+static void _rgb_matrix_fill(int first, int count, uint8_t red, uint8_t green, uint8_t blue) {
+    _clamp_span(&first, &count);
+    for (int i = 0; i < count; i++) {
+        rgb_matrix_set_color(first + i, red, green, blue);
+    }
+}
+
+static void _hsv_to_rgb_n(const HSV *hsv, RGB *rgb, int count) {
+    for (int i = 0; i < count; i++) {
+        rgb[i] = rgb_matrix_hsv_to_rgb(hsv[i]);
+    }
+}
+
+static RGB s_anim_frame[RGB_MATRIX_LED_COUNT];
+
 static dynld_custom_animation_env_t s_custom_animation_env = {
     .set_color = rgb_matrix_set_color,
     .set_color_hsv = _rgb_matrix_set_color_hsv,
@@ -68,19 +102,87 @@ static dynld_custom_animation_env_t s_custom_animation_env = {
 
     .led_config = &g_led_config,
     .rgb_config = &rgb_matrix_config,
-    .printf = dynld_env_printf
+    .printf = dynld_env_printf,
+
+    .set_span = _rgb_matrix_set_span,
+    .fill = _rgb_matrix_fill,
+    .hsv_to_rgb_n = _hsv_to_rgb_n,
+    .frame = s_anim_frame,
+    .frame_count = RGB_MATRIX_LED_COUNT,
+};
+
+// direct calls in one loop instead of one indirect call from the loaded code per led
+static void _anim_frame_commit(uint8_t led_min, uint8_t led_max) {
+    for (uint8_t i = led_min; i < led_max; i++) {
+        rgb_matrix_set_color(i, s_anim_frame[i].r, s_anim_frame[i].g, s_anim_frame[i].b);
+    }
+}
+
+static void _dynld_vm_set_hsv(int index, uint8_t h, uint8_t s, uint8_t v) {
+    RGB rgb = rgb_matrix_hsv_to_rgb((HSV){h, s, v});
+    rgb_matrix_set_color(index, rgb.r, rgb.g, rgb.b);
+}
+
+_Static_assert(sizeof(led_point_t) == 2, "dynld vm expects x, y byte pairs");
+static const dynld_vm_env_t s_anim_vm_env = {
+    .set_hsv = _dynld_vm_set_hsv,
+    .set_rgb = rgb_matrix_set_color,
+    .led_point = (const uint8_t *)g_led_config.point,
+    .led_flags = g_led_config.flags,
+    .led_count = RGB_MATRIX_LED_COUNT,
 };
 
+static dynld_vm_t s_anim_vm = { .env = &s_anim_vm_env };
+
+int dynld_rgb_animation_vm_load(const void *program, size_t size) {
+    if (!program) {
+        dynld_vm_unload(&s_anim_vm);
+        return 0;
+    }
+    return dynld_vm_load(&s_anim_vm, program, size);
+}
+
+static bool dynld_rgb_animation_vm_run(effect_params_t* params) {
+    RGB_MATRIX_USE_LIMITS(led_min, led_max);
+    int32_t *in = s_anim_vm.in;
+    in[DYNLD_VM_IN_TIME]      = g_rgb_timer;
+    in[DYNLD_VM_IN_LED_MIN]   = led_min;
+    in[DYNLD_VM_IN_LED_MAX]   = led_max;
+    in[DYNLD_VM_IN_INIT]      = params->init;
+    in[DYNLD_VM_IN_FLAGS]     = params->flags;
+    in[DYNLD_VM_IN_HUE]       = rgb_matrix_config.hsv.h;
+    in[DYNLD_VM_IN_SAT]       = rgb_matrix_config.hsv.s;
+    in[DYNLD_VM_IN_VAL]       = rgb_matrix_config.hsv.v;
+    in[DYNLD_VM_IN_SPEED]     = rgb_matrix_config.speed;
+    in[DYNLD_VM_IN_LED_COUNT] = RGB_MATRIX_LED_COUNT;
+    in[DYNLD_VM_IN_CENTER_X]  = k_rgb_matrix_center.x;
+    in[DYNLD_VM_IN_CENTER_Y]  = k_rgb_matrix_center.y;
+    if (dynld_vm_run(&s_anim_vm) < 0) {
+        DBG_USR(user_anim, "vm error:%d steps:%lu\n", s_anim_vm.error, (unsigned long)s_anim_vm.steps);
+    }
+    return rgb_matrix_check_finished_leds(led_max);
+}
+
 uint8_t some_global_state;
 void dynld_rgb_animation_init(effect_params_t* params) {
     some_global_state = 1;
+    memset(s_anim_frame, 0, sizeof(s_anim_frame));
+    s_custom_animation_env.frame_dirty = 0;
 }
 
 bool dynld_rgb_animation_run(effect_params_t* params) {
+    if (dynld_vm_loaded(&s_anim_vm)) {
+        return dynld_rgb_animation_vm_run(params);
+    }
     funptr_animation_run_t func_animation = (funptr_animation_run_t)g_dynld_funcs.func[DYNLD_FUN_ID_ANIMATION];
     if (func_animation) {
         s_custom_animation_env.time = g_rgb_timer;
         bool ret = func_animation(&s_custom_animation_env, params);
+        if (s_custom_animation_env.frame_dirty) {
+            RGB_MATRIX_USE_LIMITS(led_min, led_max);
+            _anim_frame_commit(led_min, led_max);
+            if (!rgb_matrix_check_finished_leds(led_max)) s_custom_animation_env.frame_dirty = 0;
+        }
         DBG_USR(user_anim, "iter=%d,time=%ld,envbuf:%d %d %d %d\n", params->iter, s_custom_animation_env.time,
                             s_custom_animation_env.buf[0], s_custom_animation_env.buf[1],
                             s_custom_animation_env.buf[2], s_custom_animation_env.buf[3]);
@@ -24,12 +24,21 @@
 #include "dynamic_keymap.h"
 #include "dip_switch.h"
 #include "battery.h"
+#ifdef DEBOUNCE_ADAPTIVE
+#include "debounce_adaptive.h"
+#endif
 
 #include "debug.h"
 #include "debug_user.h"
 
 #include "qmkata/QMKata.h"
+#include "qmkata/qmkata_dispatch.h"
+#include "qmkata/qmkata_latency.h"
 #include "dynld_func.h"
+#include "dynld_module.h"
+#include "dynld_hooks.h"
+#include "dynld_vm.h"
+#include "crc.h"
 
 //------------------------------------------------------------------------------
 // adjusting the function pointer for thumb mode
@@ -116,37 +125,207 @@ static void xprintf_buf(uint8_t *buf, uint8_t len) {
 //------------------------------------------------------------------------------
 rgb_matrix_host_buffer_t g_rgb_matrix_host_buf;
 
-void qmkata_sysex_handler(uint8_t cmd, uint8_t len, uint8_t *buf) {
-    if (len < 2) return;
+//------------------------------------------------------------------------------
+static inline void _rgb_host_buf_set(rgb_matrix_host_buffer_t *hb, uint8_t li, uint8_t duration, uint8_t r, uint8_t g, uint8_t b) {
+    hb->led[li].duration = duration;
+    hb->led[li].r = r;
+    hb->led[li].g = g;
+    hb->led[li].b = b;
+}
 
-    uint8_t off = 0;
-    uint8_t seqnum = buf[off];
-    off++; len--;
-    uint8_t id = buf[off];
-    off++; len--;
-    buf += off;
-    DBG_USR(qmkata, "cmd:%d,len:%u,seqnum=%u\n", cmd, len, seqnum);
-    if (cmd == QMKATA_CMD_SET) {
-        if (id == QMKATA_ID_CLI)              _QMKATA_HANDLE_CMD_SET_FN(cli)            (cmd, seqnum, len, buf);
-        if (id == QMKATA_ID_RGB_MATRIX_BUF)   _QMKATA_HANDLE_CMD_SET_FN(rgb_matrix_buf) (cmd, seqnum, len, buf);
-        if (id == QMKATA_ID_DEFAULT_LAYER)    _QMKATA_HANDLE_CMD_SET_FN(default_layer)  (cmd, seqnum, len, buf);
-        if (id == QMKATA_ID_MACWIN_MODE)      _QMKATA_HANDLE_CMD_SET_FN(macwin_mode)    (cmd, seqnum, len, buf);
-        if (id == QMKATA_ID_DYNLD_FUNCTION)   _QMKATA_HANDLE_CMD_SET_FN(dynld_function) (cmd, seqnum, len, buf);
-        if (id == QMKATA_ID_DYNLD_FUNEXEC)    _QMKATA_HANDLE_CMD_SET_FN(dynld_funexec)  (cmd, seqnum, len, buf);
-        if (id == QMKATA_ID_CONFIG)           _QMKATA_HANDLE_CMD_SET_FN(config)         (cmd, seqnum, len, buf);
-    }
-    if (cmd == QMKATA_CMD_GET) {
-        if (id == QMKATA_ID_DEFAULT_LAYER)    _QMKATA_HANDLE_CMD_GET_FN(default_layer)  (cmd, seqnum, len, buf);
-        if (id == QMKATA_ID_MACWIN_MODE)      _QMKATA_HANDLE_CMD_GET_FN(macwin_mode)    (cmd, seqnum, len, buf);
-        if (id == QMKATA_ID_STATUS)           _QMKATA_HANDLE_CMD_GET_FN(status)         (cmd, seqnum, len, buf);
-        if (id == QMKATA_ID_STRUCT_LAYOUT)    _QMKATA_HANDLE_CMD_GET_FN(struct_layout)  (cmd, seqnum, len, buf);
-        if (id == QMKATA_ID_CONFIG)           _QMKATA_HANDLE_CMD_GET_FN(config)         (cmd, seqnum, len, buf);
+// returns number of leds written
+static uint16_t _rgb_host_buf_decode(rgb_matrix_host_buffer_t *hb, uint8_t fmt, uint16_t len, uint8_t *buf) {
+    uint16_t n = 0;
+    uint16_t i = 0;
+    if (len < 1) return 0;
+    uint8_t duration = buf[i++];
+
+    switch (fmt) {
+        case RGB_BUF_FMT_RGB888:
+        case RGB_BUF_FMT_RGB565: {
+            if (len < 3) return 0;
+            uint8_t li = buf[i++];
+            uint8_t count = buf[i++];
+            uint8_t pixel_size = fmt == RGB_BUF_FMT_RGB888 ? 3 : 2;
+            if (count > (len - i) / pixel_size) count = (len - i) / pixel_size;
+            if (count > RGB_MATRIX_LED_COUNT - li || li >= RGB_MATRIX_LED_COUNT) return 0;
+            for (uint8_t end = li + count; li < end; li++, n++) {
+                if (fmt == RGB_BUF_FMT_RGB888) {
+                    _rgb_host_buf_set(hb, li, duration, buf[i], buf[i+1], buf[i+2]);
+                    i += 3;
+                } else {
+                    uint16_t c = buf[i] | buf[i+1] << 8;
+                    i += 2;
+                    uint8_t r = (c >> 11) & 0x1f, g = (c >> 5) & 0x3f, b = c & 0x1f;
+                    _rgb_host_buf_set(hb, li, duration, (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+                }
+            }
+            break;
+        }
+        case RGB_BUF_FMT_RLE: {
+            if (len < 2) return 0;
+            uint8_t li = buf[i++];
+            while (i + 4 <= len && li < RGB_MATRIX_LED_COUNT) {
+                uint8_t run = buf[i];
+                uint8_t r = buf[i+1], g = buf[i+2], b = buf[i+3];
+                i += 4;
+                if (run > RGB_MATRIX_LED_COUNT - li) run = RGB_MATRIX_LED_COUNT - li;
+                for (uint8_t end = li + run; li < end; li++, n++) {
+                    _rgb_host_buf_set(hb, li, duration, r, g, b);
+                }
+            }
+            break;
+        }
+        case RGB_BUF_FMT_PALETTE: {
+            if (len < 4) return 0;
+            uint8_t li = buf[i++];
+            uint8_t count = buf[i++];
+            uint8_t palette_size = buf[i++];
+            uint8_t *palette = &buf[i];
+            if (palette_size == 0 || i + palette_size*3 > len) return 0;
+            i += palette_size*3;
+            bool nibbles = palette_size <= 16;
+            uint16_t max_count = nibbles ? (len - i)*2 : (len - i);
+            if (count > max_count) count = max_count;
+            if (count > RGB_MATRIX_LED_COUNT - li || li >= RGB_MATRIX_LED_COUNT) return 0;
+            for (uint8_t k = 0; k < count; k++, li++, n++) {
+                uint8_t pi = nibbles ? (buf[i + k/2] >> ((k & 1) * 4)) & 0x0f : buf[i + k];
+                if (pi >= palette_size) pi = 0;
+                _rgb_host_buf_set(hb, li, duration, palette[pi*3], palette[pi*3+1], palette[pi*3+2]);
+            }
+            break;
+        }
+        case RGB_BUF_FMT_DELTA: {
+            uint8_t li = 0;
+            while (i + 2 <= len) {
+                uint8_t skip = buf[i];
+                uint8_t count = buf[i+1];
+                i += 2;
+                for (uint8_t end = MIN(li + skip, RGB_MATRIX_LED_COUNT); li < end; li++) {
+                    hb->led[li].duration = duration;
+                }
+                if (count > (len - i) / 3) count = (len - i) / 3;
+                if (count > RGB_MATRIX_LED_COUNT - li) count = RGB_MATRIX_LED_COUNT - li;
+                for (uint8_t end = li + count; li < end; li++, n++) {
+                    _rgb_host_buf_set(hb, li, duration, buf[i], buf[i+1], buf[i+2]);
+                    i += 3;
+                }
+            }
+            // leds after last delta keep previous color too
+            for (; li < RGB_MATRIX_LED_COUNT; li++) {
+                hb->led[li].duration = duration;
+            }
+            n = RGB_MATRIX_LED_COUNT;
+            break;
+        }
+        default:
+            break;
     }
+    return n;
 }
 
 //------------------------------------------------------------------------------
+rgb_matrix_host_frames_t g_rgb_matrix_host_frames = { .front = -1 };
+rgb_matrix_host_frame_status_t g_rgb_matrix_host_frame_status;
+
+_Static_assert(RGB_HOST_FRAME_QUEUE_SIZE+2 <= 16, "RGB_HOST_FRAME_QUEUE_SIZE too large");
+
+static int8_t _rgb_host_frame_free(void) {
+    uint16_t used = 0;
+    if (g_rgb_matrix_host_frames.front >= 0) used |= 1 << g_rgb_matrix_host_frames.front;
+    for (uint8_t i = 0; i < g_rgb_matrix_host_frames.queued; i++) used |= 1 << g_rgb_matrix_host_frames.queue[i];
+    for (uint8_t i = 0; i < RGB_HOST_FRAME_QUEUE_SIZE+2; i++) {
+        if (!(used & (1 << i))) return i;
+    }
+    return -1;
+}
+
+static void _rgb_host_frame_dequeue(void) {
+    g_rgb_matrix_host_frames.queued--;
+    memmove(&g_rgb_matrix_host_frames.queue[0], &g_rgb_matrix_host_frames.queue[1], g_rgb_matrix_host_frames.queued);
+}
+
+static void _rgb_host_frame_receive(uint16_t len, uint8_t *buf) {
+    rgb_matrix_host_frames_t *hf = &g_rgb_matrix_host_frames;
+    rgb_matrix_host_frame_status_t *st = &g_rgb_matrix_host_frame_status;
+    if (len < 7 || buf[6] < RGB_BUF_FMT_BASE || buf[6] == RGB_BUF_FMT_FRAME) return;
+    uint16_t seq = buf[0] | buf[1] << 8;
+    uint32_t pts = buf[2] | buf[3] << 8 | (uint32_t)buf[4] << 16 | (uint32_t)buf[5] << 24;
+
+    if (hf->seq_valid) {
+        uint16_t gap = seq - hf->seq_last;
+        if (gap == 0 || gap >= 0x8000) { // duplicate or older than last queued
+            st->dropped++;
+            return;
+        }
+        st->lost += gap - 1;
+    }
+    hf->seq_valid = 1;
+    hf->seq_last = seq;
+
+    if (hf->queued == RGB_HOST_FRAME_QUEUE_SIZE) {
+        _rgb_host_frame_dequeue();
+        st->dropped++;
+    }
+    int8_t fi = _rgb_host_frame_free();
+    if (fi < 0) return;
+
+    // delta frames are relative to the newest queued or presented frame
+    rgb_matrix_host_buffer_t *hb = &hf->frame[fi];
+    int8_t prev = hf->queued ? hf->queue[hf->queued-1] : hf->front;
+    if (prev >= 0) memcpy(hb, &hf->frame[prev], sizeof(*hb));
+    else memset(hb, 0, sizeof(*hb));
+
+    if (!_rgb_host_buf_decode(hb, buf[6], len-7, &buf[7])) return;
+    hb->seq = seq;
+    hb->pts = pts;
+    hb->written = 1;
+    hf->queue[hf->queued++] = fi;
+}
+
+rgb_matrix_host_buffer_t* rgb_matrix_host_frame_present(uint32_t now) {
+    rgb_matrix_host_frames_t *hf = &g_rgb_matrix_host_frames;
+    rgb_matrix_host_frame_status_t *st = &g_rgb_matrix_host_frame_status;
+    st->timer = now;
+
+    // latest due frame wins, older due frames are skipped
+    int8_t due = -1;
+    while (hf->queued) {
+        rgb_matrix_host_buffer_t *hb = &hf->frame[hf->queue[0]];
+        if (hb->pts != 0 && (int32_t)(hb->pts - now) > 0) break;
+        if (due >= 0) st->dropped++;
+        due = hf->queue[0];
+        _rgb_host_frame_dequeue();
+    }
+    st->queued = hf->queued;
+    if (due >= 0) {
+        rgb_matrix_host_buffer_t *hb = &hf->frame[due];
+        if (hb->pts == 0) hb->pts = now;
+        if ((int32_t)(now - hb->pts) > RGB_HOST_FRAME_LATE_MS) st->late++;
+        st->seq = hb->seq;
+        st->presented++;
+        hf->front = due;
+    }
+    if (hf->front < 0) return NULL;
+    if ((int32_t)(now - hf->frame[hf->front].pts) > RGB_HOST_FRAME_HOLD_MS && !hf->queued) {
+        hf->front = -1;
+        return NULL;
+    }
+    return &hf->frame[hf->front];
+}
+
 _QMKATA_HANDLE_CMD_SET(rgb_matrix_buf) {
-    for (int i = 0; i < len;) {
+    if (len > 0 && buf[0] == RGB_BUF_FMT_FRAME) {
+        _rgb_host_frame_receive(len-1, &buf[1]);
+        return;
+    }
+    if (len > 0 && buf[0] >= RGB_BUF_FMT_BASE) {
+        if (_rgb_host_buf_decode(&g_rgb_matrix_host_buf, buf[0], len-1, &buf[1])) {
+            g_rgb_matrix_host_buf.written = 1;
+        }
+        return;
+    }
+    for (int i = 0; i + 5 <= len;) {
         //DBG_USR(qmkata, "%d(%d):%d,%d,%d\n", (int)buf[i], (int)buf[i+1], (int)buf[i+2], (int)buf[i+3], (int)buf[i+4]);
         uint8_t li = buf[i++];
         if (li < RGB_MATRIX_LED_COUNT) {
@@ -189,6 +368,13 @@ enum eeprom_layout_id {
     EEPROM_LAYOUT_EECONFIG_USER,
 };
 
+#ifdef DEVEL_BUILD
+#define CLI_MAX_READ_LEN 64
+#define CLI_RESP_SIZE (3 + CLI_MAX_READ_LEN) // seqnum, id, cli seq, data read
+#else
+#define CLI_RESP_SIZE 0
+#endif
+
 #ifdef DEVEL_BUILD
 static void _return_cli_error(uint8_t seqnum, uint8_t cli_seq, uint8_t err) {
     uint8_t resp[4];
@@ -202,7 +388,6 @@ static void _return_cli_error(uint8_t seqnum, uint8_t cli_seq, uint8_t err) {
 
 _QMKATA_HANDLE_CMD_SET(cli) {
 #ifdef DEVEL_BUILD
-#define MAX_READ_LEN 64
     int off = 0;
     uint8_t cli_seq = buf[off]; off++;
     uint8_t cli_cmd = buf[off]; off++;
@@ -224,7 +409,7 @@ _QMKATA_HANDLE_CMD_SET(cli) {
         memcpy(&addr, &buf[off], sizeof(addr)); off += sizeof(addr);
         memcpy(&len, &buf[off], sizeof(len)); off += sizeof(len);
         if (!wr) {
-            if (len > MAX_READ_LEN) {
+            if (len > CLI_MAX_READ_LEN) {
                 if (debug_config_user.qmkata) xprintf("len too large\n");
                 _return_cli_error(seqnum, cli_seq, 'i');
                 return;
@@ -285,7 +470,7 @@ _QMKATA_HANDLE_CMD_SET(cli) {
                 uint32_t addr;
                 uint32_t size;
             } eeprom_layout[] = {
-                {(uint32_t)dynamic_keymap_key_to_eeprom_address(0,0,0), DYNAMIC_KEYMAP_LAYER_COUNT*MATRIX_ROWS*MATRIX_COLS*2},
+                {(uint32_t)(uintptr_t)dynamic_keymap_key_to_eeprom_address(0,0,0), DYNAMIC_KEYMAP_LAYER_COUNT*MATRIX_ROWS*MATRIX_COLS*2},
                 {(uint32_t)EECONFIG_USER, EECONFIG_USER_DATA_SIZE},
             }; (void) eeprom_layout;
 
@@ -312,7 +497,7 @@ _QMKATA_HANDLE_CMD_SET(cli) {
         memcpy(&len, &buf[off], sizeof(len)); off += sizeof(len);
         if (!wr) {
             if (debug_config_user.qmkata) xprintf("e[0x%lx:%d]=", addr, len);
-            if (len > MAX_READ_LEN) {
+            if (len > CLI_MAX_READ_LEN) {
                 if (debug_config_user.qmkata) xprintf("len too large\n");
                 _return_cli_error(seqnum, cli_seq, 'i');
                 return;
@@ -381,6 +566,12 @@ _QMKATA_HANDLE_CMD_SET(cli) {
                     break;
                 }
             }
+#ifdef DYNAMIC_KEYMAP_RAM_CACHE
+            dynamic_keymap_cache_invalidate(); // may have written the keymap behind dynamic_keymap
+#endif
+#ifdef RESOLVED_LAYER_CACHE
+            resolved_layer_cache_invalidate();
+#endif
             _return_cli_error(seqnum, cli_seq, 0); // no error
         }
         return;
@@ -426,9 +617,28 @@ enum status_id {
     STATUS_ID_BATTERY = 1,
     STATUS_ID_DIP_SWITCH,
     STATUS_ID_MATRIX,
+    STATUS_ID_RGB_HOST_FRAME,
+    STATUS_ID_LATENCY_LOOP,         // qmkata_latency_status_t, QMKATA_LATENCY builds only
+    STATUS_ID_LATENCY_MATRIX_SCAN,
+    STATUS_ID_LATENCY_RGB_RENDER,
+    STATUS_ID_LATENCY_RGB_FLUSH,
+    STATUS_ID_LATENCY_USB_SEND,
+    STATUS_ID_LATENCY_KEY_DEBOUNCE, // key_latency.h stages, QMKATA_LATENCY builds only
+    STATUS_ID_LATENCY_KEY_HOLD,
+    STATUS_ID_LATENCY_KEY_REPORT,
+    STATUS_ID_LATENCY_KEY_TOTAL,
     STATUS_ID_MAX
 };
 
+#define STATUS_ID_LATENCY_FIRST STATUS_ID_LATENCY_LOOP
+#define STATUS_ID_LATENCY_LAST  STATUS_ID_LATENCY_KEY_TOTAL
+_Static_assert(STATUS_ID_LATENCY_LAST - STATUS_ID_LATENCY_FIRST == QMKATA_LATENCY_MAX - 1, "latency status ids out of order");
+
+#ifdef QMKATA_LATENCY_ENABLE
+// refreshed from the histograms when read
+static qmkata_latency_status_t s_status_latency[QMKATA_LATENCY_MAX];
+#endif
+
 struct battery_status {
     uint8_t level;
     uint16_t voltage;
@@ -446,31 +656,103 @@ static const struct {
     [STATUS_ID_BATTERY] = { (uint8_t*)&g_status_battery, sizeof(g_status_battery) },
     [STATUS_ID_DIP_SWITCH] = { (uint8_t*)dip_switch_state, NUMBER_OF_DIP_SWITCHES },
     [STATUS_ID_MATRIX] = { (uint8_t*)raw_matrix, sizeof(raw_matrix)},
+    [STATUS_ID_RGB_HOST_FRAME] = { (uint8_t*)&g_rgb_matrix_host_frame_status, sizeof(g_rgb_matrix_host_frame_status) },
+#ifdef QMKATA_LATENCY_ENABLE
+    [STATUS_ID_LATENCY_LOOP] = { (uint8_t*)&s_status_latency[QMKATA_LATENCY_LOOP], sizeof(qmkata_latency_status_t) },
+    [STATUS_ID_LATENCY_MATRIX_SCAN] = { (uint8_t*)&s_status_latency[QMKATA_LATENCY_MATRIX_SCAN], sizeof(qmkata_latency_status_t) },
+    [STATUS_ID_LATENCY_RGB_RENDER] = { (uint8_t*)&s_status_latency[QMKATA_LATENCY_RGB_RENDER], sizeof(qmkata_latency_status_t) },
+    [STATUS_ID_LATENCY_RGB_FLUSH] = { (uint8_t*)&s_status_latency[QMKATA_LATENCY_RGB_FLUSH], sizeof(qmkata_latency_status_t) },
+    [STATUS_ID_LATENCY_USB_SEND] = { (uint8_t*)&s_status_latency[QMKATA_LATENCY_USB_SEND], sizeof(qmkata_latency_status_t) },
+    [STATUS_ID_LATENCY_KEY_DEBOUNCE] = { (uint8_t*)&s_status_latency[QMKATA_LATENCY_KEY_DEBOUNCE], sizeof(qmkata_latency_status_t) },
+    [STATUS_ID_LATENCY_KEY_HOLD] = { (uint8_t*)&s_status_latency[QMKATA_LATENCY_KEY_HOLD], sizeof(qmkata_latency_status_t) },
+    [STATUS_ID_LATENCY_KEY_REPORT] = { (uint8_t*)&s_status_latency[QMKATA_LATENCY_KEY_REPORT], sizeof(qmkata_latency_status_t) },
+    [STATUS_ID_LATENCY_KEY_TOTAL] = { (uint8_t*)&s_status_latency[QMKATA_LATENCY_KEY_TOTAL], sizeof(qmkata_latency_status_t) },
+#endif
 };
 
-static void _qmkata_send_struct_layout_status(uint8_t seqnum) {
-    uint8_t resp[60];
+// largest status entry, sizes the status get response
+typedef union {
+    struct battery_status           battery;
+    bool                            dip_switch[NUMBER_OF_DIP_SWITCHES];
+    matrix_row_t                    matrix[MATRIX_ROWS];
+    rgb_matrix_host_frame_status_t  rgb_host_frame;
+#ifdef QMKATA_LATENCY_ENABLE
+    qmkata_latency_status_t         latency;
+#endif
+} status_entry_t;
+#define STATUS_RESP_SIZE (3 + sizeof(status_entry_t)) // seqnum, id, status id, entry
+
+// struct layout message of step into resp, returns its length, 0 after the last one
+static int _qmkata_struct_layout_status(uint8_t step, uint8_t seqnum, uint8_t *resp) {
     int n = 0;
-    //--------------------------------
     resp[0] = seqnum; n = 1;
-    STRUCT_LAYOUT(QMKATA_ID_STATUS, STATUS_ID_BATTERY, sizeof(struct battery_status), STRUCT_FLAG_READ_ONLY)
-    BYTEFIELD(1, offsetof(struct battery_status, level));
-    U16FIELD(2, offsetof(struct battery_status, voltage));
-    BYTEFIELD(3, offsetof(struct battery_status, charging));
-    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+    switch (step) {
     //--------------------------------
-    resp[0] = seqnum; n = 1;
-    STRUCT_LAYOUT(QMKATA_ID_STATUS, STATUS_ID_DIP_SWITCH, NUMBER_OF_DIP_SWITCHES, STRUCT_FLAG_READ_ONLY)
-    BYTEFIELD(1, 0);
-    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+    case 0:
+        STRUCT_LAYOUT(QMKATA_ID_STATUS, STATUS_ID_BATTERY, sizeof(struct battery_status), STRUCT_FLAG_READ_ONLY)
+        BYTEFIELD(1, offsetof(struct battery_status, level));
+        U16FIELD(2, offsetof(struct battery_status, voltage));
+        BYTEFIELD(3, offsetof(struct battery_status, charging));
+        break;
     //--------------------------------
-    resp[0] = seqnum; n = 1;
-    STRUCT_LAYOUT(QMKATA_ID_STATUS, STATUS_ID_MATRIX, sizeof(raw_matrix), STRUCT_FLAG_READ_ONLY)
-    uint8_t matrix_row_type = STRUCT_FIELD_TYPE_UINT8;
-    if (sizeof(matrix_row_t) == 2) matrix_row_type = STRUCT_FIELD_TYPE_UINT16;
-    if (sizeof(matrix_row_t) == 4) matrix_row_type = STRUCT_FIELD_TYPE_UINT32;
-    ARRAYFIELD(1, matrix_row_type, 0, sizeof(raw_matrix)/sizeof(matrix_row_t));
-    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+    case 1:
+        STRUCT_LAYOUT(QMKATA_ID_STATUS, STATUS_ID_DIP_SWITCH, NUMBER_OF_DIP_SWITCHES, STRUCT_FLAG_READ_ONLY)
+        BYTEFIELD(1, 0);
+        break;
+    //--------------------------------
+    case 2: {
+        STRUCT_LAYOUT(QMKATA_ID_STATUS, STATUS_ID_MATRIX, sizeof(raw_matrix), STRUCT_FLAG_READ_ONLY)
+        uint8_t matrix_row_type = STRUCT_FIELD_TYPE_UINT8;
+        if (sizeof(matrix_row_t) == 2) matrix_row_type = STRUCT_FIELD_TYPE_UINT16;
+        if (sizeof(matrix_row_t) == 4) matrix_row_type = STRUCT_FIELD_TYPE_UINT32;
+        ARRAYFIELD(1, matrix_row_type, 0, sizeof(raw_matrix)/sizeof(matrix_row_t));
+        break;
+    }
+    //--------------------------------
+    case 3:
+        STRUCT_LAYOUT(QMKATA_ID_STATUS, STATUS_ID_RGB_HOST_FRAME, sizeof(rgb_matrix_host_frame_status_t), STRUCT_FLAG_READ_ONLY)
+        U32FIELD(1, offsetof(rgb_matrix_host_frame_status_t, timer));
+        U16FIELD(2, offsetof(rgb_matrix_host_frame_status_t, seq));
+        U16FIELD(3, offsetof(rgb_matrix_host_frame_status_t, presented));
+        U16FIELD(4, offsetof(rgb_matrix_host_frame_status_t, dropped));
+        U16FIELD(5, offsetof(rgb_matrix_host_frame_status_t, late));
+        U16FIELD(6, offsetof(rgb_matrix_host_frame_status_t, lost));
+        BYTEFIELD(7, offsetof(rgb_matrix_host_frame_status_t, queued));
+        break;
+    default: {
+#ifdef QMKATA_LATENCY_ENABLE
+        //--------------------------------
+        if (step - 4 > STATUS_ID_LATENCY_LAST - STATUS_ID_LATENCY_FIRST) return 0;
+        uint8_t status_id = STATUS_ID_LATENCY_FIRST + step - 4;
+        STRUCT_LAYOUT(QMKATA_ID_STATUS, status_id, sizeof(qmkata_latency_status_t), STRUCT_FLAG_READ_ONLY)
+        U32FIELD(1, offsetof(qmkata_latency_status_t, count));
+        U32FIELD(2, offsetof(qmkata_latency_status_t, min));
+        U32FIELD(3, offsetof(qmkata_latency_status_t, max));
+        U32FIELD(4, offsetof(qmkata_latency_status_t, p50));
+        U32FIELD(5, offsetof(qmkata_latency_status_t, p90));
+        U32FIELD(6, offsetof(qmkata_latency_status_t, p99));
+        U32FIELD(7, offsetof(qmkata_latency_status_t, p999));
+        break;
+#else
+        return 0;
+#endif
+    }
+    }
+    return n;
+}
+
+// refresh status which is not updated by its owner
+static void _qmkata_status_update(uint8_t status_id) {
+    if (status_id == STATUS_ID_BATTERY) {
+        g_status_battery.level = battery_get_percentage();
+        g_status_battery.voltage = battery_get_voltage();
+        g_status_battery.charging = 1; // qmkata only over usb so charging or full
+    }
+#ifdef QMKATA_LATENCY_ENABLE
+    if (status_id >= STATUS_ID_LATENCY_FIRST && status_id <= STATUS_ID_LATENCY_LAST) {
+        qmkata_latency_get(status_id - STATUS_ID_LATENCY_FIRST, &s_status_latency[status_id - STATUS_ID_LATENCY_FIRST]);
+    }
+#endif
 }
 
 _QMKATA_HANDLE_CMD_GET(status) {
@@ -480,11 +762,7 @@ _QMKATA_HANDLE_CMD_GET(status) {
     if (status_id >= STATUS_ID_MAX) return;
     if (s_status_table[status_id].ptr == NULL) return;
 
-    if (status_id == STATUS_ID_BATTERY) {
-        g_status_battery.level = battery_get_percentage();
-        g_status_battery.voltage = battery_get_voltage();
-        g_status_battery.charging = 1; // qmkata only over usb so charging or full
-    }
+    _qmkata_status_update(status_id);
 
     uint8_t resp[3+s_status_table[status_id].size];
     uint8_t off = 0;
@@ -494,6 +772,12 @@ _QMKATA_HANDLE_CMD_GET(status) {
     DBG_USR(qmkata, "status[%d]:%lx\n", status_id, (uint32_t)s_status_table[status_id].ptr);
     memcpy(&resp[off], s_status_table[status_id].ptr, s_status_table[status_id].size);
     qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, off+s_status_table[status_id].size);
+#ifdef QMKATA_LATENCY_ENABLE
+    // optional second byte: restart the histogram after this read
+    if (len > 1 && buf[1] && status_id >= STATUS_ID_LATENCY_FIRST && status_id <= STATUS_ID_LATENCY_LAST) {
+        qmkata_latency_reset(status_id - STATUS_ID_LATENCY_FIRST);
+    }
+#endif
 }
 
 //------------------------------------------------------------------------------
@@ -509,11 +793,18 @@ enum config_id {
     //CONFIG_ID_KEYCHRON_INDICATOR // indicator_config_t
     CONFIG_ID_DEBOUNCE, // uint8_t
     CONFIG_ID_DEVEL, // devel_config_t
+    CONFIG_ID_DEBOUNCE_ADAPTIVE, // debounce_adaptive_config_t, DEBOUNCE_ADAPTIVE builds only
+    CONFIG_ID_DEBOUNCE_WINDOWS,  // uint8_t per key, learned windows
     CONFIG_ID_MAX
 };
 
 extern uint8_t g_debounce;
-extern uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS]; // todo bb: replace with "eeprom cache"
+#ifdef DYNAMIC_KEYMAP_RAM_CACHE
+#define KEYMAP_LAYOUT dynamic_keymap_cache // the dynamic keymap as changed by VIA
+#else
+extern uint16_t PROGMEM keymaps[][MATRIX_ROWS][MATRIX_COLS];
+#define KEYMAP_LAYOUT keymaps // the compiled in keymap
+#endif
 
 static const struct {
     uint8_t* ptr;
@@ -523,18 +814,65 @@ static const struct {
     [CONFIG_ID_DEBUG_USER] =    { (uint8_t*)&debug_config_user, sizeof(debug_config_user) },
     [CONFIG_ID_RGB_MATRIX] =    { (uint8_t*)&rgb_matrix_config, sizeof(rgb_matrix_config) },
     [CONFIG_ID_KEYMAP] =        { (uint8_t*)&keymap_config,     sizeof(keymap_config) },
-    [CONFIG_ID_KEYMAP_LAYOUT] = { (uint8_t*)keymaps,            sizeof(keymaps[0][0][0])*MATRIX_ROWS*MATRIX_COLS },
+    [CONFIG_ID_KEYMAP_LAYOUT] = { (uint8_t*)KEYMAP_LAYOUT,      sizeof(KEYMAP_LAYOUT[0][0][0])*MATRIX_ROWS*MATRIX_COLS },
     [CONFIG_ID_DEBOUNCE] =      { (uint8_t*)&g_debounce,        sizeof(g_debounce) },
     [CONFIG_ID_DEVEL] =         { (uint8_t*)&devel_config,      sizeof(devel_config) },
+#ifdef DEBOUNCE_ADAPTIVE
+    [CONFIG_ID_DEBOUNCE_ADAPTIVE] = { (uint8_t*)&g_debounce_adaptive, sizeof(g_debounce_adaptive) },
+    [CONFIG_ID_DEBOUNCE_WINDOWS] =  { (uint8_t*)debounce_adaptive_windows, sizeof(debounce_adaptive_windows) },
+#endif
 };
 
+// largest config entry, sizes the config get response
+typedef union {
+    debug_config_t              debug;
+    debug_config_user_t         debug_user;
+    rgb_config_t                rgb_matrix;
+    keymap_config_t             keymap;
+    uint16_t                    keymap_layout[MATRIX_ROWS][MATRIX_COLS];
+    uint8_t                     debounce;
+    devel_config_t              devel;
+#ifdef DEBOUNCE_ADAPTIVE
+    debounce_adaptive_config_t  debounce_adaptive;
+    uint8_t                     debounce_windows[MATRIX_ROWS][MATRIX_COLS];
+#endif
+} config_entry_t;
+#define CONFIG_RESP_SIZE (3 + sizeof(config_entry_t)) // seqnum, id, config id, entry
+
+// entry data for reading, the dynamic keymap cache is loaded first when not valid
+static uint8_t* _config_read_ptr(uint8_t config_id) {
+#ifdef DYNAMIC_KEYMAP_RAM_CACHE
+    if (config_id == CONFIG_ID_KEYMAP_LAYOUT) dynamic_keymap_cache_check();
+#endif
+    return s_config_table[config_id].ptr;
+}
+
 _QMKATA_HANDLE_CMD_SET(config) {
     uint8_t config_id = buf[0];
     DBG_USR(qmkata, "config:set:%u\n", config_id);
     if (config_id == 0) return; // no extended config id
     if (config_id >= CONFIG_ID_MAX) return;
     if (s_config_table[config_id].ptr == NULL) return;
+    if (config_id == CONFIG_ID_KEYMAP_LAYOUT) return; // read only, in flash or mirror of the eeprom
+    if (len < 1 + s_config_table[config_id].size) {
+        DBG_USR(qmkata, "config:set:%u short %u\n", config_id, len);
+        return;
+    }
+#ifdef DEBOUNCE_ADAPTIVE
+    if (config_id == CONFIG_ID_DEBOUNCE_ADAPTIVE) {
+        debounce_adaptive_config_t config;
+        memcpy(&config, &buf[1], sizeof(config));
+        if (config.min > config.max) {
+            DBG_USR(qmkata, "config:set:%u min %u > max %u\n", config_id, config.min, config.max);
+            return;
+        }
+    }
+#endif
     memcpy(s_config_table[config_id].ptr, &buf[1], s_config_table[config_id].size);
+#ifdef DEBOUNCE_ADAPTIVE
+    if (config_id == CONFIG_ID_DEBOUNCE) debounce_adaptive_reset(); // learn again from the new window
+    if (config_id == CONFIG_ID_DEBOUNCE_ADAPTIVE || config_id == CONFIG_ID_DEBOUNCE_WINDOWS) debounce_adaptive_clamp_windows();
+#endif
 }
 
 _QMKATA_HANDLE_CMD_GET(config) {
@@ -550,13 +888,188 @@ _QMKATA_HANDLE_CMD_GET(config) {
     resp[off] = QMKATA_ID_CONFIG; off++;
     resp[off] = config_id; off++;
     DBG_USR(qmkata, "config[%d]:%lx\n", config_id, (uint32_t)s_config_table[config_id].ptr);
-    memcpy(&resp[off], s_config_table[config_id].ptr, s_config_table[config_id].size);
+    memcpy(&resp[off], _config_read_ptr(config_id), s_config_table[config_id].size);
     qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, off+s_config_table[config_id].size);
 }
 
+//------------------------------------------------------------------------------
+// config/status change notifications
+// subscribed entries are compared against a shadow copy every min interval,
+// changed byte spans are published and the shadow updated once sent.
+// pub: id, sub id, [offset, length, data...]...
+#ifndef QMKATA_SUB_MAX
+#define QMKATA_SUB_MAX 8
+#endif
+#ifndef QMKATA_SUB_SHADOW_SIZE
+#define QMKATA_SUB_SHADOW_SIZE 512 // shadow copies of all subscribed entries
+#endif
+#define QMKATA_SUB_SPAN_GAP 4 // unchanged bytes merged into a span instead of starting a new one
+#define QMKATA_SUB_PUB_SIZE 60
+
+typedef struct qmkata_sub {
+    uint8_t  id;            // QMKATA_ID_CONFIG or QMKATA_ID_STATUS, 0: free
+    uint8_t  sub_id;        // config or status id
+    uint16_t min_interval;  // ms
+    uint16_t last_check;
+    uint16_t shadow_off;
+} qmkata_sub_t;
+
+static qmkata_sub_t s_subs[QMKATA_SUB_MAX];
+static uint8_t s_sub_shadow[QMKATA_SUB_SHADOW_SIZE];
+static uint16_t s_sub_shadow_used;
+
+static bool _qmkata_sub_entry(uint8_t id, uint8_t sub_id, uint8_t **ptr, uint8_t *size) {
+    if (sub_id == 0) return false;
+    if (id == QMKATA_ID_CONFIG && sub_id < CONFIG_ID_MAX && s_config_table[sub_id].ptr) {
+        *ptr = _config_read_ptr(sub_id);
+        *size = s_config_table[sub_id].size;
+        return true;
+    }
+    if (id == QMKATA_ID_STATUS && sub_id < STATUS_ID_MAX && s_status_table[sub_id].ptr) {
+        *ptr = s_status_table[sub_id].ptr;
+        *size = s_status_table[sub_id].size;
+        return true;
+    }
+    return false;
+}
+
+static qmkata_sub_t* _qmkata_sub_find(uint8_t id, uint8_t sub_id) {
+    for (int i = 0; i < QMKATA_SUB_MAX; i++) {
+        if (s_subs[i].id == id && s_subs[i].sub_id == sub_id) return &s_subs[i];
+    }
+    return NULL;
+}
+
+// publish changed spans of one subscription, returns false if tx ring is full
+// shadow is only updated once all spans are sent, on failure they are published again
+static bool _qmkata_sub_publish(qmkata_sub_t *sub, uint8_t *ptr, uint8_t size) {
+    uint8_t *shadow = &s_sub_shadow[sub->shadow_off];
+    uint8_t pub[QMKATA_SUB_PUB_SIZE];
+    uint8_t n = 0;
+    uint8_t i = 0;
+    while (i < size) {
+        if (ptr[i] == shadow[i]) { i++; continue; }
+
+        // span ends after QMKATA_SUB_SPAN_GAP unchanged bytes
+        uint8_t start = i, end = i + 1, same = 0;
+        for (i++; i < size && same < QMKATA_SUB_SPAN_GAP; i++) {
+            if (ptr[i] == shadow[i]) same++;
+            else { same = 0; end = i + 1; }
+        }
+        i = end;
+
+        while (start < end) {
+            if (n + 2 + 1 > sizeof(pub)) {
+                if (qmkata_send_sysex(QMKATA_CMD_PUB, pub, n) < 0) return false;
+                n = 0;
+            }
+            if (n == 0) {
+                pub[n++] = sub->id;
+                pub[n++] = sub->sub_id;
+            }
+            uint8_t len = MIN(end - start, sizeof(pub) - n - 2);
+            pub[n++] = start;
+            pub[n++] = len;
+            memcpy(&pub[n], &ptr[start], len);
+            n += len;
+            start += len;
+        }
+    }
+    if (n && qmkata_send_sysex(QMKATA_CMD_PUB, pub, n) < 0) return false;
+    memcpy(shadow, ptr, size);
+    return true;
+}
+
+static int _qmkata_sub_add(uint8_t id, uint8_t sub_id, uint16_t min_interval) {
+    uint8_t *ptr;
+    uint8_t size;
+    if (!_qmkata_sub_entry(id, sub_id, &ptr, &size)) return -1;
+
+    qmkata_sub_t *sub = _qmkata_sub_find(id, sub_id);
+    if (!sub) {
+        if (s_sub_shadow_used + size > sizeof(s_sub_shadow)) return -2;
+        sub = _qmkata_sub_find(0, 0);
+        if (!sub) return -2;
+        sub->id = id;
+        sub->sub_id = sub_id;
+        sub->shadow_off = s_sub_shadow_used;
+        s_sub_shadow_used += size;
+    }
+    sub->min_interval = min_interval;
+    // due now, the sub task publishes the current value as initial notification after the response
+    sub->last_check = timer_read() - min_interval;
+    for (uint8_t i = 0; i < size; i++) s_sub_shadow[sub->shadow_off + i] = ~ptr[i];
+    return 0;
+}
+
+static int _qmkata_sub_del(uint8_t id, uint8_t sub_id) {
+    qmkata_sub_t *sub = _qmkata_sub_find(id, sub_id);
+    if (!sub || id == 0) return -1;
+    uint8_t *ptr;
+    uint8_t size;
+    _qmkata_sub_entry(id, sub_id, &ptr, &size);
+
+    // compact shadow memory
+    uint16_t off = sub->shadow_off;
+    memmove(&s_sub_shadow[off], &s_sub_shadow[off + size], s_sub_shadow_used - off - size);
+    s_sub_shadow_used -= size;
+    for (int i = 0; i < QMKATA_SUB_MAX; i++) {
+        if (s_subs[i].id && s_subs[i].shadow_off > off) s_subs[i].shadow_off -= size;
+    }
+    memset(sub, 0, sizeof(*sub));
+    return 0;
+}
+
+// sub: config/status id, min interval (16 bits, ms), min interval 0 unsubscribes
+static void _qmkata_sub(uint8_t id, uint8_t seqnum, uint16_t len, uint8_t *buf) {
+    if (len < 2) return;
+    uint8_t sub_id = buf[0];
+    uint16_t min_interval = buf[1] | (len > 2 ? buf[2] << 8 : 0);
+    DBG_USR(qmkata, "sub:%u:%u,%u\n", id, sub_id, min_interval);
+
+    int rc;
+    if (min_interval == 0) rc = _qmkata_sub_del(id, sub_id);
+    else rc = _qmkata_sub_add(id, sub_id, min_interval);
+
+    uint8_t resp[4];
+    resp[0] = seqnum;
+    resp[1] = id;
+    resp[2] = sub_id;
+    resp[3] = rc;
+    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, sizeof(resp));
+}
+
+_QMKATA_HANDLE_CMD_SUB(status) {
+    _qmkata_sub(QMKATA_ID_STATUS, seqnum, len, buf);
+}
+
+_QMKATA_HANDLE_CMD_SUB(config) {
+    _qmkata_sub(QMKATA_ID_CONFIG, seqnum, len, buf);
+}
+
+static void _qmkata_sub_task(void) {
+    for (int i = 0; i < QMKATA_SUB_MAX; i++) {
+        qmkata_sub_t *sub = &s_subs[i];
+        if (sub->id == 0) continue;
+        if (timer_elapsed(sub->last_check) < sub->min_interval) continue;
+
+        uint8_t *ptr;
+        uint8_t size;
+        if (!_qmkata_sub_entry(sub->id, sub->sub_id, &ptr, &size)) continue;
+        if (sub->id == QMKATA_ID_STATUS) _qmkata_status_update(sub->sub_id);
+        if (memcmp(ptr, &s_sub_shadow[sub->shadow_off], size) != 0) {
+            if (!_qmkata_sub_publish(sub, ptr, size)) return; // retry when tx ring has space
+        }
+        sub->last_check = timer_read();
+    }
+}
+
+void qmkata_sysex_task(void) {
+    _qmkata_sub_task();
+}
+
 //------------------------------------------------------------------------------
 // todo bb:
-// - config changes monitoring
 // - mechanism to hook enable/disable dynamic loaded functions
 // ...
 
@@ -608,121 +1121,347 @@ enum config_debounce_field {
     CONFIG_FIELD_DEBOUNCE = 1
 };
 
+enum config_debounce_adaptive_field {
+    CONFIG_FIELD_DEBOUNCE_ADAPTIVE_MIN = 1,
+    CONFIG_FIELD_DEBOUNCE_ADAPTIVE_MAX,
+    CONFIG_FIELD_DEBOUNCE_ADAPTIVE_MARGIN,
+    CONFIG_FIELD_DEBOUNCE_ADAPTIVE_LEARN,
+};
+
+enum config_debounce_windows_field {
+    CONFIG_FIELD_DEBOUNCE_WINDOWS = 1
+};
+
 enum config_devel_field {
     CONFIG_FIELD_DEVEL_PUB_KEYPRESS = 1,
     CONFIG_FIELD_DEVEL_PROCESS_KEYPRESS,
+    CONFIG_FIELD_DEVEL_PUB_MAX_LATENCY,
+    CONFIG_FIELD_DEVEL_PUB_MATRIX,
+    CONFIG_FIELD_DEVEL_PUB_TRACE,
 };
 
 //<config id>:<size>:<field id>:<type>:<offset>:<size> // offset: byte or bit offset
 //_QMKATA_HANDLE_CMD_GET(config_layout) {
-static void _qmkata_send_struct_layout_config(uint8_t seqnum) {
-    uint8_t resp[60];
+// struct layout message of step into resp, returns its length, 0 after the last one
+static int _qmkata_struct_layout_config(uint8_t step, uint8_t seqnum, uint8_t *resp) {
     int n = 0;
-    //--------------------------------
     resp[0] = seqnum; n = 1;
-    STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_DEBUG, sizeof(debug_config_t), 0)
-    BITFIELD(CONFIG_FIELD_DEBUG_ENABLE,     0, 1, 8);
-    BITFIELD(CONFIG_FIELD_DEBUG_MATRIX,     1, 1, 8);
-    BITFIELD(CONFIG_FIELD_DEBUG_KEYBOARD,   2, 1, 8);
-    BITFIELD(CONFIG_FIELD_DEBUG_MOUSE,      3, 1, 8);
-    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+    switch (step) {
     //--------------------------------
-    resp[0] = seqnum; n = 1;
-    STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_DEBUG_USER, sizeof(debug_config_user_t), 0 )
-    BITFIELD(CONFIG_FIELD_DEBUG_USER_QMKATA,   0, 1, 8);
-    BITFIELD(CONFIG_FIELD_DEBUG_USER_STATS,     1, 1, 8);
-    BITFIELD(CONFIG_FIELD_DEBUG_USER_USER_ANIM, 2, 1, 8);
-    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+    case 0:
+        STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_DEBUG, sizeof(debug_config_t), 0)
+        BITFIELD(CONFIG_FIELD_DEBUG_ENABLE,     0, 1, 8);
+        BITFIELD(CONFIG_FIELD_DEBUG_MATRIX,     1, 1, 8);
+        BITFIELD(CONFIG_FIELD_DEBUG_KEYBOARD,   2, 1, 8);
+        BITFIELD(CONFIG_FIELD_DEBUG_MOUSE,      3, 1, 8);
+        break;
     //--------------------------------
-    resp[0] = seqnum; n = 1;
-    STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_RGB_MATRIX, sizeof(rgb_config_t), 0);
-    BITFIELD(CONFIG_FIELD_RGB_ENABLE,   0, 2, 8);
-    BITFIELD(CONFIG_FIELD_RGB_MODE,     2, 6, 8);
-    BYTEFIELD(CONFIG_FIELD_RGB_HSV_H,   offsetof(rgb_config_t, hsv) + offsetof(HSV, h));
-    BYTEFIELD(CONFIG_FIELD_RGB_HSV_S,   offsetof(rgb_config_t, hsv) + offsetof(HSV, s));
-    BYTEFIELD(CONFIG_FIELD_RGB_HSV_V,   offsetof(rgb_config_t, hsv) + offsetof(HSV, v));
-    BYTEFIELD(CONFIG_FIELD_RGB_SPEED,   offsetof(rgb_config_t, speed));
-    BYTEFIELD(CONFIG_FIELD_RGB_FLAGS,   offsetof(rgb_config_t, flags));
-    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+    case 1:
+        STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_DEBUG_USER, sizeof(debug_config_user_t), 0 )
+        BITFIELD(CONFIG_FIELD_DEBUG_USER_QMKATA,   0, 1, 8);
+        BITFIELD(CONFIG_FIELD_DEBUG_USER_STATS,     1, 1, 8);
+        BITFIELD(CONFIG_FIELD_DEBUG_USER_USER_ANIM, 2, 1, 8);
+        break;
     //--------------------------------
-    int bp = 0;
-    resp[0] = seqnum; n = 1;
-    STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_KEYMAP, sizeof(keymap_config_t), 0);
-    BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_CONTROL_CAPSLOCK,     bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_CAPSLOCK_TO_CONTROL,       bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_LALT_LGUI,            bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_RALT_RGUI,            bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_NO_GUI,                    bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_GRAVE_ESC,            bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_BACKSLASH_BACKSPACE,  bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_NKRO,                      bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_LCTL_LGUI,            bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_RCTL_RGUI,            bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_ONESHOT_ENABLE,            bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_ESCAPE_CAPSLOCK,      bp, 1, 16); bp++;
-    BITFIELD(CONFIG_FIELD_KEYMAP_AUTOCORRECT_ENABLE,        bp, 1, 16); bp++;
-    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+    case 2:
+        STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_RGB_MATRIX, sizeof(rgb_config_t), 0);
+        BITFIELD(CONFIG_FIELD_RGB_ENABLE,   0, 2, 8);
+        BITFIELD(CONFIG_FIELD_RGB_MODE,     2, 6, 8);
+        BYTEFIELD(CONFIG_FIELD_RGB_HSV_H,   offsetof(rgb_config_t, hsv) + offsetof(HSV, h));
+        BYTEFIELD(CONFIG_FIELD_RGB_HSV_S,   offsetof(rgb_config_t, hsv) + offsetof(HSV, s));
+        BYTEFIELD(CONFIG_FIELD_RGB_HSV_V,   offsetof(rgb_config_t, hsv) + offsetof(HSV, v));
+        BYTEFIELD(CONFIG_FIELD_RGB_SPEED,   offsetof(rgb_config_t, speed));
+        BYTEFIELD(CONFIG_FIELD_RGB_FLAGS,   offsetof(rgb_config_t, flags));
+        break;
     //--------------------------------
-    int keymap_size = sizeof(keymaps[0][0][0])*MATRIX_ROWS*MATRIX_COLS; // only layer 0
-    resp[0] = seqnum; n = 1;
-    STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_KEYMAP_LAYOUT, keymap_size, STRUCT_FLAG_READ_ONLY);
-    ARRAYFIELD(CONFIG_FIELD_KEYMAP_LAYOUT, STRUCT_FIELD_TYPE_UINT16, 0, MATRIX_ROWS*MATRIX_COLS);
-    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+    case 3: {
+        int bp = 0;
+        STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_KEYMAP, sizeof(keymap_config_t), 0);
+        BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_CONTROL_CAPSLOCK,     bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_CAPSLOCK_TO_CONTROL,       bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_LALT_LGUI,            bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_RALT_RGUI,            bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_NO_GUI,                    bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_GRAVE_ESC,            bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_BACKSLASH_BACKSPACE,  bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_NKRO,                      bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_LCTL_LGUI,            bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_RCTL_RGUI,            bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_ONESHOT_ENABLE,            bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_SWAP_ESCAPE_CAPSLOCK,      bp, 1, 16); bp++;
+        BITFIELD(CONFIG_FIELD_KEYMAP_AUTOCORRECT_ENABLE,        bp, 1, 16); bp++;
+        break;
+    }
     //--------------------------------
-    resp[0] = seqnum; n = 1;
-    STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_DEBOUNCE, sizeof(uint8_t), 0);
-    BYTEFIELD(CONFIG_FIELD_DEBOUNCE, 0);
-    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+    case 4: {
+        int keymap_size = sizeof(KEYMAP_LAYOUT[0][0][0])*MATRIX_ROWS*MATRIX_COLS; // only layer 0
+        STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_KEYMAP_LAYOUT, keymap_size, STRUCT_FLAG_READ_ONLY);
+        ARRAYFIELD(CONFIG_FIELD_KEYMAP_LAYOUT, STRUCT_FIELD_TYPE_UINT16, 0, MATRIX_ROWS*MATRIX_COLS);
+        break;
+    }
     //--------------------------------
-    resp[0] = seqnum; n = 1;
-    STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_DEVEL, sizeof(devel_config_t), 0);
-    BITFIELD(CONFIG_FIELD_DEVEL_PUB_KEYPRESS,       0, 1, 8);
-    BITFIELD(CONFIG_FIELD_DEVEL_PROCESS_KEYPRESS,   1, 1, 8);
-    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+    case 5:
+        STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_DEBOUNCE, sizeof(uint8_t), 0);
+        BYTEFIELD(CONFIG_FIELD_DEBOUNCE, 0);
+        break;
+    //--------------------------------
+    case 6:
+        STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_DEVEL, sizeof(devel_config_t), 0);
+        BITFIELD(CONFIG_FIELD_DEVEL_PUB_KEYPRESS,       0, 1, 8);
+        BITFIELD(CONFIG_FIELD_DEVEL_PROCESS_KEYPRESS,   1, 1, 8);
+        BYTEFIELD(CONFIG_FIELD_DEVEL_PUB_MAX_LATENCY,   offsetof(devel_config_t, pub_max_latency));
+        BITFIELD(CONFIG_FIELD_DEVEL_PUB_MATRIX,         2, 1, 8);
+        BITFIELD(CONFIG_FIELD_DEVEL_PUB_TRACE,          3, 1, 8);
+        break;
+#ifdef DEBOUNCE_ADAPTIVE
+    //--------------------------------
+    case 7:
+        STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_DEBOUNCE_ADAPTIVE, sizeof(debounce_adaptive_config_t), 0);
+        BYTEFIELD(CONFIG_FIELD_DEBOUNCE_ADAPTIVE_MIN,       offsetof(debounce_adaptive_config_t, min));
+        BYTEFIELD(CONFIG_FIELD_DEBOUNCE_ADAPTIVE_MAX,       offsetof(debounce_adaptive_config_t, max));
+        BYTEFIELD(CONFIG_FIELD_DEBOUNCE_ADAPTIVE_MARGIN,    offsetof(debounce_adaptive_config_t, margin));
+        BYTEFIELD(CONFIG_FIELD_DEBOUNCE_ADAPTIVE_LEARN,     offsetof(debounce_adaptive_config_t, learn));
+        break;
+    //--------------------------------
+    case 8:
+        STRUCT_LAYOUT(QMKATA_ID_CONFIG, CONFIG_ID_DEBOUNCE_WINDOWS, sizeof(debounce_adaptive_windows), 0);
+        ARRAYFIELD(CONFIG_FIELD_DEBOUNCE_WINDOWS, STRUCT_FIELD_TYPE_UINT8, 0, MATRIX_ROWS*MATRIX_COLS);
+        break;
+#endif
+    default:
+        return 0;
+    }
+    return n;
 }
 
 //------------------------------------------------------------------------------
 
 #define DYNLD_FUNC_SIZE 1024 // dynld function max size
-static uint8_t dynld_func_buf[DYNLD_FUN_ID_MAX][DYNLD_FUNC_SIZE] __attribute__((aligned(4)));
+#define DYNLD_FUNC_BUF_COUNT DYNLD_FUN_ID_HOOK_FIRST // hooks are only loaded as module exports
+// one buffer per function plus the windowed upload staging buffer, swapped in on commit
+static uint8_t dynld_func_buf[DYNLD_FUNC_BUF_COUNT+1][DYNLD_FUNC_SIZE] __attribute__((aligned(4)));
+static uint8_t *dynld_func_mem[DYNLD_FUNC_BUF_COUNT];
+static uint8_t *dynld_func_staging;
 dynld_funcs_t g_dynld_funcs = { 0 };
 
+// the animation fun id takes native code or a dynld_vm program, returns the native function or NULL
+static void *_dynld_func_activate(uint16_t fun_id, uint8_t *mem) {
+    if (fun_id == DYNLD_FUN_ID_ANIMATION) {
+        if (dynld_vm_is_program(mem, DYNLD_FUNC_SIZE)) {
+            int rc = dynld_rgb_animation_vm_load(mem, DYNLD_FUNC_SIZE);
+            DBG_USR(qmkata, " vm program:%d\n", rc);
+            return NULL;
+        }
+        dynld_rgb_animation_vm_load(NULL, 0);
+    }
+    return (void*)thumb_fun_addr(mem);
+}
+
+static void _dynld_func_deactivate(uint16_t fun_id) {
+    g_dynld_funcs.func[fun_id] = NULL;
+    if (fun_id == DYNLD_FUN_ID_ANIMATION) {
+        dynld_rgb_animation_vm_load(NULL, 0);
+    }
+}
+
+static void _dynld_func_mem_init(void) {
+    if (dynld_func_staging) return;
+    for (int i = 0; i < DYNLD_FUNC_BUF_COUNT; i++) {
+        dynld_func_mem[i] = dynld_func_buf[i];
+    }
+    dynld_func_staging = dynld_func_buf[DYNLD_FUNC_BUF_COUNT];
+}
+
 int load_function(const uint16_t fun_id, const uint8_t* data, size_t offset, size_t len) {
+    if (fun_id >= DYNLD_FUNC_BUF_COUNT) {
+        DBG_USR(qmkata, " fun id too large\n");
+        return -1;
+    }
+    _dynld_func_mem_init();
+    uint8_t *mem = dynld_func_mem[fun_id];
     // set function pointer after fully loaded
     if (offset == 0xffff) {
-        if (memcmp(dynld_func_buf[fun_id], "\0\0", 2) != 0) {
-            g_dynld_funcs.func[fun_id] = (void*)thumb_fun_addr((uint8_t*)dynld_func_buf[fun_id]);
+        if (memcmp(mem, "\0\0", 2) != 0) {
+            g_dynld_funcs.func[fun_id] = _dynld_func_activate(fun_id, mem);
             DBG_USR(qmkata, " fun[%d]:%p\n", (int)fun_id, g_dynld_funcs.func[fun_id]);
             if (debug_config_user.qmkata) {
-                xprintf_buf(&dynld_func_buf[fun_id][0], 16);
-                xprintf_buf(&dynld_func_buf[fun_id][50], 16);
-                xprintf_buf(&dynld_func_buf[fun_id][100], 16);
+                xprintf_buf(&mem[0], 16);
+                xprintf_buf(&mem[50], 16);
+                xprintf_buf(&mem[100], 16);
             }
         }
         return 0;
     }
     if (offset + len > DYNLD_FUNC_SIZE) {
-        memset((void*)&dynld_func_buf[fun_id][0], 0, DYNLD_FUNC_SIZE);
-        g_dynld_funcs.func[fun_id] = NULL;
+        _dynld_func_deactivate(fun_id);
+        memset((void*)mem, 0, DYNLD_FUNC_SIZE);
         DBG_USR(qmkata, " fun too large\n");
         return -1;
     }
-    if (fun_id >= DYNLD_FUN_ID_MAX) {
-        DBG_USR(qmkata, " fun id too large\n");
-        return -1;
-    }
     if (offset == 0) {
-        g_dynld_funcs.func[fun_id] = NULL;
-        memset((void*)dynld_func_buf[fun_id], 0, DYNLD_FUNC_SIZE);
+        _dynld_func_deactivate(fun_id);
+        memset((void*)mem, 0, DYNLD_FUNC_SIZE);
         if (len >= 2 && memcmp(data, "\0\0", 2) == 0) {
             DBG_USR(qmkata, " fun[%d]:0\n", (int)fun_id);
             return 0;
         }
     }
-    memcpy((void*)&dynld_func_buf[fun_id][offset], data, len);
+    memcpy((void*)&mem[offset], data, len);
     return 0;
 }
 
+//------------------------------------------------------------------------------
+// windowed upload: host streams chunks into the staging buffer without per chunk ack,
+// asks for the received bitmap to retransmit missing chunks, and commits with crc32.
+// the function pointer is only swapped to the staging buffer when all chunks are there
+// and the crc matches, the previous function keeps running until then.
+#define DYNLD_UPLOAD_CHUNK_MIN  16
+#define DYNLD_UPLOAD_CHUNKS_MAX (DYNLD_FUNC_SIZE / DYNLD_UPLOAD_CHUNK_MIN)
+#define DYNLD_UPLOAD_WINDOW     32 // chunks per status bitmap
+
+enum dynld_upload_op {
+    DYNLD_UPLOAD_OP_BEGIN  = 1, // fun id (16 bits), size (16 bits), chunk size
+    DYNLD_UPLOAD_OP_DATA   = 2, // chunk index (16 bits), data, no response
+    DYNLD_UPLOAD_OP_STATUS = 3, // response: 0, first missing chunk (16 bits), received bitmap from there (32 bits)
+    DYNLD_UPLOAD_OP_COMMIT = 4, // crc32 of the function (32 bits)
+};
+
+enum dynld_upload_error {
+    DYNLD_UPLOAD_ERR_PARAM = 1,
+    DYNLD_UPLOAD_ERR_STATE,
+    DYNLD_UPLOAD_ERR_MISSING,   // chunks missing on commit
+    DYNLD_UPLOAD_ERR_CRC,
+    DYNLD_UPLOAD_ERR_PROGRAM,   // invalid dynld_vm program
+};
+
+static struct {
+    uint16_t fun_id;
+    uint16_t size;
+    uint8_t  chunk_size;
+    uint8_t  chunk_count;
+    bool     active;
+    uint32_t received[(DYNLD_UPLOAD_CHUNKS_MAX + 31) / 32];
+} s_dynld_upload;
+
+static inline bool _dynld_upload_received(uint8_t chunk) {
+    return s_dynld_upload.received[chunk / 32] & (1UL << (chunk % 32));
+}
+
+static uint8_t _dynld_upload_first_missing(void) {
+    uint8_t chunk = 0;
+    while (chunk < s_dynld_upload.chunk_count && _dynld_upload_received(chunk)) chunk++;
+    return chunk;
+}
+
+static int _dynld_upload_begin(uint16_t len, uint8_t *buf) {
+    if (len < 5) return -DYNLD_UPLOAD_ERR_PARAM;
+    uint16_t fun_id = buf[0] | buf[1] << 8;
+    uint16_t size = buf[2] | buf[3] << 8;
+    uint8_t chunk_size = buf[4];
+    if (fun_id >= DYNLD_FUNC_BUF_COUNT || size == 0 || size > DYNLD_FUNC_SIZE || chunk_size < DYNLD_UPLOAD_CHUNK_MIN) {
+        return -DYNLD_UPLOAD_ERR_PARAM;
+    }
+    _dynld_func_mem_init();
+    memset(&s_dynld_upload, 0, sizeof(s_dynld_upload));
+    memset(dynld_func_staging, 0, DYNLD_FUNC_SIZE);
+    s_dynld_upload.fun_id = fun_id;
+    s_dynld_upload.size = size;
+    s_dynld_upload.chunk_size = chunk_size;
+    s_dynld_upload.chunk_count = (size + chunk_size - 1) / chunk_size;
+    s_dynld_upload.active = true;
+    return 0;
+}
+
+static int _dynld_upload_data(uint16_t len, uint8_t *buf) {
+    if (!s_dynld_upload.active) return -DYNLD_UPLOAD_ERR_STATE;
+    if (len < 2) return -DYNLD_UPLOAD_ERR_PARAM;
+    uint16_t chunk = buf[0] | buf[1] << 8;
+    len -= 2;
+    if (chunk >= s_dynld_upload.chunk_count) return -DYNLD_UPLOAD_ERR_PARAM;
+    uint16_t offset = chunk * s_dynld_upload.chunk_size;
+    uint16_t expected = MIN(s_dynld_upload.chunk_size, s_dynld_upload.size - offset);
+    if (len != expected) return -DYNLD_UPLOAD_ERR_PARAM;
+
+    memcpy(&dynld_func_staging[offset], &buf[2], len);
+    s_dynld_upload.received[chunk / 32] |= 1UL << (chunk % 32);
+    return 0;
+}
+
+static int _dynld_upload_commit(uint16_t len, uint8_t *buf) {
+    if (!s_dynld_upload.active) return -DYNLD_UPLOAD_ERR_STATE;
+    if (len < 4) return -DYNLD_UPLOAD_ERR_PARAM;
+    if (_dynld_upload_first_missing() < s_dynld_upload.chunk_count) return -DYNLD_UPLOAD_ERR_MISSING;
+    uint32_t crc;
+    memcpy(&crc, buf, sizeof(crc));
+    if (crc32(dynld_func_staging, s_dynld_upload.size) != crc) {
+        s_dynld_upload.active = false;
+        return -DYNLD_UPLOAD_ERR_CRC;
+    }
+
+    uint16_t fun_id = s_dynld_upload.fun_id;
+    if (fun_id == DYNLD_FUN_ID_ANIMATION && dynld_vm_is_program(dynld_func_staging, DYNLD_FUNC_SIZE)
+        && dynld_vm_check(dynld_func_staging, DYNLD_FUNC_SIZE) < 0) {
+        s_dynld_upload.active = false;
+        return -DYNLD_UPLOAD_ERR_PROGRAM;
+    }
+
+    // swap in staging buffer, single pointer store so the function is either old or new
+    uint8_t *mem = dynld_func_staging;
+    dynld_func_staging = dynld_func_mem[fun_id];
+    dynld_func_mem[fun_id] = mem;
+    g_dynld_funcs.func[fun_id] = _dynld_func_activate(fun_id, mem);
+    s_dynld_upload.active = false;
+    DBG_USR(qmkata, "dynld upload fun[%d]:%p\n", (int)fun_id, g_dynld_funcs.func[fun_id]);
+    return 0;
+}
+
+// set: op, op params
+_QMKATA_HANDLE_CMD_SET(dynld_upload) {
+    uint8_t op = buf[0];
+    buf++; len--;
+
+    uint8_t resp[10];
+    uint8_t n = 0;
+    resp[n++] = seqnum;
+    resp[n++] = QMKATA_ID_DYNLD_UPLOAD;
+    resp[n++] = op;
+
+    int rc = -DYNLD_UPLOAD_ERR_PARAM;
+    switch (op) {
+        case DYNLD_UPLOAD_OP_BEGIN:
+            rc = _dynld_upload_begin(len, buf);
+            break;
+        case DYNLD_UPLOAD_OP_DATA:
+            rc = _dynld_upload_data(len, buf);
+            if (rc == 0) return; // chunks are acked with status
+            break;
+        case DYNLD_UPLOAD_OP_STATUS: {
+            if (!s_dynld_upload.active) {
+                rc = -DYNLD_UPLOAD_ERR_STATE;
+                break;
+            }
+            uint8_t base = _dynld_upload_first_missing();
+            uint32_t bitmap = 0;
+            for (uint8_t i = 0; i < DYNLD_UPLOAD_WINDOW && base + i < s_dynld_upload.chunk_count; i++) {
+                if (_dynld_upload_received(base + i)) bitmap |= 1UL << i;
+            }
+            resp[n++] = 0; // rc
+            resp[n++] = base;
+            resp[n++] = 0;
+            memcpy(&resp[n], &bitmap, sizeof(bitmap));
+            n += sizeof(bitmap);
+            qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+            return;
+        }
+        case DYNLD_UPLOAD_OP_COMMIT:
+            rc = _dynld_upload_commit(len, buf);
+            break;
+    }
+    DBG_USR(qmkata, "dynld upload op=%d,rc=%d\n", (int)op, rc);
+    resp[n++] = -rc;
+    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+}
+
 static int dynld_env_printf(const char* fmt, ...) {
     //xprintf(fmt, ...);
     return -1;
@@ -781,23 +1520,110 @@ _QMKATA_HANDLE_CMD_SET(dynld_funexec) {
     qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, sizeof(resp));
 }
 
+// set: offset (16 bits), image chunk; offset 0 unloads the current module,
+// DYNLD_MODULE_OFFSET_... link, store or erase stored module.
+// store and erase block for the flash sector erase, up to 2 s without matrix scan
+_QMKATA_HANDLE_CMD_SET(dynld_module) {
+    uint16_t offset = buf[0] | buf[1] << 8;
+    len -= 2;
+    int rc;
+    if (offset == DYNLD_MODULE_OFFSET_LINK) {
+        rc = dynld_module_link();
+    } else if (offset == DYNLD_MODULE_OFFSET_LINK_STORE) {
+        rc = dynld_module_store();
+        if (rc == 0) rc = dynld_module_link();
+    } else if (offset == DYNLD_MODULE_OFFSET_ERASE) {
+        rc = dynld_module_store_erase();
+    } else {
+        rc = dynld_module_write(offset, &buf[2], len);
+    }
+    DBG_USR(qmkata, "dynld module off=%d,len=%d,rc=%d\n", (int)offset, (int)len, rc);
+
+    uint8_t resp[3];
+    resp[0] = seqnum;
+    resp[1] = QMKATA_ID_DYNLD_MODULE;
+    resp[2] = -rc;
+    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, sizeof(resp));
+}
+
+// set: slot, enable, budget (32 bits, qmkata_timestamp ticks, 0 keeps current)
+_QMKATA_HANDLE_CMD_SET(dynld_hook) {
+    uint8_t slot = buf[0];
+    if (slot >= DYNLD_HOOK_MAX) return;
+    uint32_t budget = 0;
+    if (len >= 6) memcpy(&budget, &buf[2], sizeof(budget));
+    if (budget) g_dynld_hook_stats[slot].budget = budget;
+    if (buf[1]) g_dynld_hooks_enabled |= 1 << slot;
+    else g_dynld_hooks_enabled &= ~(1 << slot);
+    DBG_USR(qmkata, "dynld hook %u:%u,%lu\n", slot, buf[1], (unsigned long)g_dynld_hook_stats[slot].budget);
+}
+
+// get: slot, response: slot, enabled, dynld_hook_stats_t
+_QMKATA_HANDLE_CMD_GET(dynld_hook) {
+    uint8_t slot = buf[0];
+    if (slot >= DYNLD_HOOK_MAX) return;
+    uint8_t resp[4 + sizeof(dynld_hook_stats_t)];
+    resp[0] = seqnum;
+    resp[1] = QMKATA_ID_DYNLD_HOOK;
+    resp[2] = slot;
+    resp[3] = (g_dynld_hooks_enabled >> slot) & 1;
+    memcpy(&resp[4], &g_dynld_hook_stats[slot], sizeof(dynld_hook_stats_t));
+    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, sizeof(resp));
+}
+
 //------------------------------------------------------------------------------
 
+#define STRUCT_LAYOUT_RESP_SIZE 60 // largest struct layout message
+
+// one message per struct, sent while they fit into the tx ring, the rest from the next qmkata_task
 _QMKATA_HANDLE_CMD_GET(struct_layout) {
     uint8_t struct_layout_id = buf[0];
-    DBG_USR(qmkata, "struct_layout:get:%u\n", struct_layout_id);
+    DBG_USR(qmkata, "struct_layout:get:%u,%u\n", struct_layout_id, qmkata_dispatch_step());
 
+    int (*layout)(uint8_t step, uint8_t seqnum, uint8_t *resp) = NULL;
     if (struct_layout_id == QMKATA_ID_STATUS) {
-        _qmkata_send_struct_layout_status(seqnum);
-        return;
+        layout = _qmkata_struct_layout_status;
     }
     if (struct_layout_id == QMKATA_ID_CONTROL) {
         //todo bb:
-        //_qmkata_send_struct_layout_control();
+        //layout = _qmkata_struct_layout_control;
         return;
     }
     if (struct_layout_id == QMKATA_ID_CONFIG) {
-        _qmkata_send_struct_layout_config(seqnum);
-        return;
+        layout = _qmkata_struct_layout_config;
+    }
+    if (!layout) return;
+
+    uint8_t resp[STRUCT_LAYOUT_RESP_SIZE];
+    uint8_t step = qmkata_dispatch_step();
+    int n;
+    while ((n = layout(step, seqnum, resp)) > 0) {
+        if (qmkata_tx_available() < n) {
+            qmkata_dispatch_resume(step);
+            return;
+        }
+        qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, n);
+        step++;
     }
 }
+
+//------------------------------------------------------------------------------
+// cmd, id, min len, response size, handler
+QMKATA_HANDLER(QMKATA_CMD_SET, QMKATA_ID_CLI,             0, CLI_RESP_SIZE, _QMKATA_HANDLE_CMD_SET_FN(cli))
+QMKATA_HANDLER(QMKATA_CMD_SET, QMKATA_ID_RGB_MATRIX_BUF,  0, 0, _QMKATA_HANDLE_CMD_SET_FN(rgb_matrix_buf))
+QMKATA_HANDLER(QMKATA_CMD_SET, QMKATA_ID_DEFAULT_LAYER,   1, 0, _QMKATA_HANDLE_CMD_SET_FN(default_layer))
+QMKATA_HANDLER(QMKATA_CMD_SET, QMKATA_ID_MACWIN_MODE,     1, 0, _QMKATA_HANDLE_CMD_SET_FN(macwin_mode))
+QMKATA_HANDLER(QMKATA_CMD_SET, QMKATA_ID_DYNLD_FUNCTION,  4, 3, _QMKATA_HANDLE_CMD_SET_FN(dynld_function))
+QMKATA_HANDLER(QMKATA_CMD_SET, QMKATA_ID_DYNLD_FUNEXEC,   2, 6, _QMKATA_HANDLE_CMD_SET_FN(dynld_funexec))
+QMKATA_HANDLER(QMKATA_CMD_SET, QMKATA_ID_DYNLD_MODULE,    2, 3, _QMKATA_HANDLE_CMD_SET_FN(dynld_module))
+QMKATA_HANDLER(QMKATA_CMD_SET, QMKATA_ID_DYNLD_UPLOAD,    1, 10, _QMKATA_HANDLE_CMD_SET_FN(dynld_upload))
+QMKATA_HANDLER(QMKATA_CMD_SET, QMKATA_ID_DYNLD_HOOK,      2, 0, _QMKATA_HANDLE_CMD_SET_FN(dynld_hook))
+QMKATA_HANDLER(QMKATA_CMD_GET, QMKATA_ID_DYNLD_HOOK,      1, 4 + sizeof(dynld_hook_stats_t), _QMKATA_HANDLE_CMD_GET_FN(dynld_hook))
+QMKATA_HANDLER(QMKATA_CMD_SET, QMKATA_ID_CONFIG,          1, 0, _QMKATA_HANDLE_CMD_SET_FN(config))
+QMKATA_HANDLER(QMKATA_CMD_GET, QMKATA_ID_DEFAULT_LAYER,   0, 0, _QMKATA_HANDLE_CMD_GET_FN(default_layer))
+QMKATA_HANDLER(QMKATA_CMD_GET, QMKATA_ID_MACWIN_MODE,     0, 3, _QMKATA_HANDLE_CMD_GET_FN(macwin_mode))
+QMKATA_HANDLER(QMKATA_CMD_GET, QMKATA_ID_STATUS,          1, STATUS_RESP_SIZE, _QMKATA_HANDLE_CMD_GET_FN(status))
+QMKATA_HANDLER(QMKATA_CMD_GET, QMKATA_ID_STRUCT_LAYOUT,   1, STRUCT_LAYOUT_RESP_SIZE, _QMKATA_HANDLE_CMD_GET_FN(struct_layout))
+QMKATA_HANDLER(QMKATA_CMD_GET, QMKATA_ID_CONFIG,          1, CONFIG_RESP_SIZE, _QMKATA_HANDLE_CMD_GET_FN(config))
+QMKATA_HANDLER(QMKATA_CMD_SUB, QMKATA_ID_STATUS,          2, 4, _QMKATA_HANDLE_CMD_SUB_FN(status))
+QMKATA_HANDLER(QMKATA_CMD_SUB, QMKATA_ID_CONFIG,          2, 4, _QMKATA_HANDLE_CMD_SUB_FN(config))
@@ -0,0 +1,447 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include <lib/lib8tion/lib8tion.h>
+#include "dynld_vm.h"
+#include "rgb_matrix_native.h"
+}
+
+// the bundled rgb_matrix effects re-expressed in bytecode, compared against the
+// quantum/rgb_matrix/animations effects built for the host, and timed against them in the benchmark.
+
+#define LED_COUNT 87
+#define CENTER_X 112
+#define CENTER_Y 32
+#define FLAG_MODIFIER 0x01
+#define FLAG_KEYLIGHT 0x04
+
+#define OP(op, a, b, c) DYNLD_VM_INSN(DYNLD_VM_OP_##op, a, b, c)
+#define OPI(op, a, imm) DYNLD_VM_INSN_IMM(DYNLD_VM_OP_##op, a, imm)
+#define ENV(a, in) OP(ENV, a, DYNLD_VM_IN_##in, 0)
+
+// register use of the effect programs, H S V are consecutive for SETHSV
+enum { I = 0, MAX, TIME, H, S, V, T0, T1, FLAGS, HUE, DX, DY, DIST, SIN, COS, VAL };
+
+typedef std::vector<uint32_t> code_t;
+
+static uint8_t s_led_point[LED_COUNT][2];
+static uint8_t s_led_flags[LED_COUNT];
+static hsv_t   s_out[LED_COUNT];
+static bool    s_out_set[LED_COUNT];
+
+static void set_hsv(int index, uint8_t h, uint8_t s, uint8_t v) {
+    s_out[index]     = {h, s, v};
+    s_out_set[index] = true;
+}
+
+static void set_rgb(int index, uint8_t r, uint8_t g, uint8_t b) {
+    set_hsv(index, r, g, b);
+}
+
+extern "C" void rgb_matrix_native_set_color(int index, uint8_t h, uint8_t s, uint8_t v) {
+    set_hsv(index, h, s, v);
+}
+
+static const dynld_vm_env_t s_env = {
+    .set_hsv   = set_hsv,
+    .set_rgb   = set_rgb,
+    .led_point = &s_led_point[0][0],
+    .led_flags = s_led_flags,
+    .led_count = LED_COUNT,
+};
+
+static void clear_out(void) {
+    memset(s_out, 0, sizeof(s_out));
+    memset(s_out_set, 0, sizeof(s_out_set));
+}
+
+//------------------------------------------------------------------------------
+// bytecode
+
+static code_t image(const code_t &code, uint16_t budget = 0) {
+    code_t img = {DYNLD_VM_MAGIC, (uint32_t)code.size() | (uint32_t)budget << 16};
+    img.insert(img.end(), code.begin(), code.end());
+    return img;
+}
+
+static void append(code_t &code, const code_t &part) {
+    code.insert(code.end(), part.begin(), part.end());
+}
+
+// rgb_matrix runner: for led_min..led_max with led flags, math sets H S V from HUE S VAL
+static code_t runner(const code_t &time, const code_t &per_led, const code_t &math) {
+    code_t code = {ENV(I, LED_MIN), ENV(MAX, LED_MAX), ENV(FLAGS, FLAGS), ENV(HUE, HUE), ENV(S, SAT), ENV(VAL, VAL), OP(MOV, H, HUE, 0), OP(MOV, V, VAL, 0)};
+    append(code, time);
+    code.push_back(OP(SLT, T0, I, MAX));
+    size_t guard = code.size();
+    code.push_back(0);
+    size_t loop = code.size();
+    code.push_back(OP(LEDF, T0, I, 0));
+    code.push_back(OP(AND, T0, T0, FLAGS));
+    size_t skip = code.size();
+    code.push_back(0);
+    append(code, per_led);
+    append(code, math);
+    code.push_back(OP(SETHSV, I, H, 0));
+    size_t next = code.size();
+    code[skip] = OPI(JZ, T0, next);
+    code.push_back(OP(LOOP, I, MAX, next - loop));
+    code.push_back(OP(HALT, 0, 0, 0));
+    code[guard] = OPI(JZ, T0, code.size());
+    return code;
+}
+
+// effect_runner_i time
+static const code_t time_i = {ENV(T0, SPEED), OPI(LDI, T1, 2), OP(SHR, T0, T0, T1), OPI(LDI, T1, 1), OP(QADD8, T0, T0, T1), ENV(TIME, TIME), OP(SCALE16BY8, TIME, TIME, T0), OP(U8, TIME, TIME, 0)};
+// effect_runner_dx_dy(_dist) time
+static const code_t time_dx_dy = {ENV(T0, SPEED), OPI(LDI, T1, 1), OP(SHR, T0, T0, T1), ENV(TIME, TIME), OP(SCALE16BY8, TIME, TIME, T0), OP(U8, TIME, TIME, 0)};
+// effect_runner_sin_cos_i time, SIN COS are sin_value cos_value
+static const code_t time_sin_cos = {ENV(T0, SPEED), OPI(LDI, T1, 2), OP(SHR, T0, T0, T1), ENV(TIME, TIME), OP(SCALE16BY8, TIME, TIME, T0), OP(COS8, COS, TIME, 0), OP(ADDI, COS, COS, -128), OP(SIN8, SIN, TIME, 0), OP(ADDI, SIN, SIN, -128)};
+
+static const code_t dx_dy = {OP(LEDX, DX, I, 0), ENV(T0, CENTER_X), OP(SUB, DX, DX, T0), OP(LEDY, DY, I, 0), ENV(T0, CENTER_Y), OP(SUB, DY, DY, T0)};
+static const code_t dx_dy_dist = {OP(LEDX, DX, I, 0), ENV(T0, CENTER_X), OP(SUB, DX, DX, T0), OP(LEDY, DY, I, 0), ENV(T0, CENTER_Y), OP(SUB, DY, DY, T0), OP(MUL, T0, DX, DX), OP(MUL, T1, DY, DY), OP(ADD, T0, T0, T1), OP(SQRT16, DIST, T0, 0)};
+
+static code_t vm_solid_color(void) {
+    return runner({}, {}, {});
+}
+
+static code_t vm_breathing(void) {
+    return runner({ENV(T0, SPEED), OPI(LDI, T1, 3), OP(SHR, T0, T0, T1), ENV(TIME, TIME), OP(SCALE16BY8, TIME, TIME, T0), OP(SIN8, T0, TIME, 0), OP(ADDI, T0, T0, -128), OP(S8, T0, T0, 0), OP(ABS, T0, T0, 0), OP(ADD, T0, T0, T0), OP(SCALE8, V, T0, VAL)}, {}, {});
+}
+
+static code_t vm_band_spiral_val(void) {
+    return runner(time_dx_dy, dx_dy_dist, {OP(ATAN2_8, T0, DY, DX), OP(ADD, T1, VAL, DIST), OP(SUB, T1, T1, TIME), OP(SUB, T1, T1, T0), OP(SCALE8, V, T1, VAL)});
+}
+
+static code_t vm_cycle_all(void) {
+    return runner(time_i, {}, {OP(MOV, H, TIME, 0)});
+}
+
+static code_t vm_cycle_left_right(void) {
+    return runner(time_i, {}, {OP(LEDX, T0, I, 0), OP(SUB, H, T0, TIME)});
+}
+
+static code_t vm_cycle_up_down(void) {
+    return runner(time_i, {}, {OP(LEDY, T0, I, 0), OP(SUB, H, T0, TIME)});
+}
+
+static code_t vm_cycle_out_in(void) {
+    return runner(time_dx_dy, dx_dy_dist, {OPI(LDI, T0, 3), OP(MUL, T0, DIST, T0), OPI(LDI, T1, 2), OP(DIV, T0, T0, T1), OP(ADD, H, T0, TIME)});
+}
+
+static code_t vm_cycle_out_in_dual(void) {
+    return runner(time_dx_dy, dx_dy, {ENV(T0, CENTER_X), OPI(LDI, T1, 1), OP(SHR, T0, T0, T1), OP(S8, T1, DX, 0), OP(ABS, T1, T1, 0), OP(SUB, DX, T0, T1), OP(MUL, T0, DX, DX), OP(MUL, T1, DY, DY), OP(ADD, T0, T0, T1), OP(SQRT16, DIST, T0, 0), OPI(LDI, T0, 3), OP(MUL, T0, DIST, T0), OP(ADD, H, T0, TIME)});
+}
+
+static code_t vm_cycle_pinwheel(void) {
+    return runner(time_dx_dy, dx_dy, {OP(ATAN2_8, T0, DY, DX), OP(ADD, H, T0, TIME)});
+}
+
+static code_t vm_cycle_spiral(void) {
+    return runner(time_dx_dy, dx_dy_dist, {OP(ATAN2_8, T0, DY, DX), OP(SUB, H, DIST, TIME), OP(SUB, H, H, T0)});
+}
+
+static code_t vm_beacon(bool rainbow) {
+    code_t math = {OP(LEDY, T0, I, 0), ENV(T1, CENTER_Y), OP(SUB, T0, T0, T1), OP(MUL, T0, T0, SIN)};
+    if (rainbow) math.push_back(OP(ADD, T0, T0, T0));
+    append(math, {OP(LEDX, T1, I, 0), ENV(DX, CENTER_X), OP(SUB, T1, T1, DX), OP(MUL, T1, T1, COS)});
+    if (rainbow) math.push_back(OP(ADD, T1, T1, T1));
+    append(math, {OP(ADD, T0, T0, T1), OPI(LDI, T1, 128), OP(DIV, T0, T0, T1), OP(ADD, H, HUE, T0)});
+    return runner(time_sin_cos, {}, math);
+}
+
+static code_t vm_dual_beacon(void) {
+    return vm_beacon(false);
+}
+
+static code_t vm_rainbow_beacon(void) {
+    return vm_beacon(true);
+}
+
+static code_t vm_rainbow_moving_chevron(void) {
+    return runner(time_i, {}, {OP(LEDY, T0, I, 0), ENV(T1, CENTER_Y), OP(SUB, T0, T0, T1), OP(S8, T0, T0, 0), OP(ABS, T0, T0, 0), OP(ADD, H, HUE, T0), OP(LEDX, T0, I, 0), OP(SUB, T0, T0, TIME), OP(ADD, H, H, T0)});
+}
+
+// random hue, sat 127..254
+static const code_t random_color = {OP(RAND8, H, 0, 0), OPI(LDI, T1, 128), OP(RAND8_MAX, S, T1, 0), OP(ADDI, S, S, 127)};
+
+static code_t vm_jellybean_raindrops(void) {
+    code_t code = {ENV(I, LED_MIN), ENV(MAX, LED_MAX), ENV(FLAGS, FLAGS), ENV(V, VAL), ENV(T0, INIT)};
+    size_t to_init = code.size();
+    code.push_back(0);
+    // change one led every tick
+    append(code, {ENV(T0, SPEED), OPI(LDI, T1, 16), OP(QADD8, T0, T0, T1), ENV(TIME, TIME), OP(SCALE16BY8, TIME, TIME, T0), OPI(LDI, T1, 5), OP(MOD, T0, TIME, T1)});
+    std::vector<size_t> to_end;
+    to_end.push_back(code.size());
+    code.push_back(0); // JNZ T0 end
+    append(code, {ENV(T0, LED_COUNT), OP(RAND8_MAX, I, T0, 0), OP(LEDF, T0, I, 0), OP(AND, T0, T0, FLAGS)});
+    to_end.push_back(code.size());
+    code.push_back(0); // JZ T0 end
+    append(code, random_color);
+    code.push_back(OP(SETHSV, I, H, 0));
+    to_end.push_back(code.size());
+    code.push_back(0); // JMP end
+    // init, all leds
+    code[to_init] = OPI(JNZ, T0, code.size());
+    code.push_back(OP(SLT, T0, I, MAX));
+    to_end.push_back(code.size());
+    code.push_back(0); // JZ T0 end
+    size_t loop = code.size();
+    append(code, {OP(LEDF, T0, I, 0), OP(AND, T0, T0, FLAGS)});
+    size_t skip = code.size();
+    code.push_back(0);
+    append(code, random_color);
+    code.push_back(OP(SETHSV, I, H, 0));
+    code[skip] = OPI(JZ, T0, code.size());
+    code.push_back(OP(LOOP, I, MAX, code.size() - loop));
+    size_t end = code.size();
+    code.push_back(OP(HALT, 0, 0, 0));
+    code[to_end[0]] = OPI(JNZ, T0, end);
+    code[to_end[1]] = OPI(JZ, T0, end);
+    code[to_end[2]] = OPI(JMP, 0, end);
+    code[to_end[3]] = OPI(JZ, T0, end);
+    return code;
+}
+
+static code_t vm_pixel_rain(void) {
+    // mem word 0 is wait_timer
+    code_t code = {ENV(TIME, TIME), OPI(LDI, T0, 0), OP(LDW, T1, T0, 0), OP(SLTU, T0, T1, TIME)};
+    std::vector<size_t> to_end;
+    to_end.push_back(code.size());
+    code.push_back(0); // JZ T0 end
+    append(code, {ENV(T0, LED_COUNT), OP(RAND8_MAX, I, T0, 0), OP(LEDF, T0, I, 0), ENV(T1, FLAGS), OP(AND, T0, T0, T1)});
+    to_end.push_back(code.size());
+    code.push_back(0); // JZ T0 end
+    append(code, {OP(RAND8, T0, 0, 0), OPI(LDI, T1, 2), OP(AND, T0, T0, T1)});
+    size_t to_color = code.size();
+    code.push_back(0);
+    append(code, {OPI(LDI, H, 0), OPI(LDI, S, 0), OPI(LDI, V, 0)});
+    size_t to_set = code.size();
+    code.push_back(0);
+    code[to_color] = OPI(JZ, T0, code.size());
+    append(code, random_color);
+    code.push_back(ENV(V, VAL));
+    code[to_set] = OPI(JMP, 0, code.size());
+    code.push_back(OP(SETHSV, I, H, 0));
+    // wait_timer = timer + 500 / scale16by8(qadd8(speed, 16), 16)
+    append(code, {ENV(T0, SPEED), OPI(LDI, T1, 16), OP(QADD8, T0, T0, T1), OP(SCALE16BY8, T0, T0, T1), OPI(LDI, T1, 500), OP(DIV, T0, T1, T0), OP(ADD, T0, TIME, T0), OPI(LDI, T1, 0), OP(STW, T0, T1, 0)});
+    size_t end = code.size();
+    code.push_back(OP(HALT, 0, 0, 0));
+    code[to_end[0]] = OPI(JZ, T0, end);
+    code[to_end[1]] = OPI(JZ, T0, end);
+    return code;
+}
+
+//------------------------------------------------------------------------------
+
+struct effect_t {
+    const char *name;
+    code_t (*program)(void);
+};
+
+static const effect_t s_effects[] = {
+    {"SOLID_COLOR", vm_solid_color},
+    {"BREATHING", vm_breathing},
+    {"BAND_SPIRAL_VAL", vm_band_spiral_val},
+    {"CYCLE_ALL", vm_cycle_all},
+    {"CYCLE_LEFT_RIGHT", vm_cycle_left_right},
+    {"CYCLE_UP_DOWN", vm_cycle_up_down},
+    {"CYCLE_OUT_IN", vm_cycle_out_in},
+    {"CYCLE_OUT_IN_DUAL", vm_cycle_out_in_dual},
+    {"CYCLE_PINWHEEL", vm_cycle_pinwheel},
+    {"CYCLE_SPIRAL", vm_cycle_spiral},
+    {"DUAL_BEACON", vm_dual_beacon},
+    {"RAINBOW_BEACON", vm_rainbow_beacon},
+    {"RAINBOW_MOVING_CHEVRON", vm_rainbow_moving_chevron},
+    {"JELLYBEAN_RAINDROPS", vm_jellybean_raindrops},
+    {"PIXEL_RAIN", vm_pixel_rain},
+};
+
+class DynldVm : public ::testing::Test {
+   protected:
+    void SetUp() override {
+        // 6 rows, last row with wide keys, modifiers on the row ends
+        for (int i = 0; i < LED_COUNT; i++) {
+            int row           = i < 85 ? i / 17 : 5;
+            int col           = i < 85 ? i % 17 : (i - 85) * 8 + 4;
+            s_led_point[i][0] = col * 224 / 16;
+            s_led_point[i][1] = row * 64 / 5;
+            s_led_flags[i]    = (col == 0 || col == 16 || row == 5) ? FLAG_MODIFIER : FLAG_KEYLIGHT;
+            rgb_matrix_native_set_led(i, s_led_point[i][0], s_led_point[i][1], s_led_flags[i]);
+        }
+        memset(&vm, 0, sizeof(vm));
+        vm.env = &s_env;
+        clear_out();
+    }
+
+    int native(const effect_t &e) {
+        int effect = rgb_matrix_native_find(e.name);
+        EXPECT_GE(effect, 0) << e.name;
+        return effect;
+    }
+
+    int load(const code_t &img) {
+        return dynld_vm_load(&vm, img.data(), img.size() * sizeof(uint32_t));
+    }
+
+    int run(const frame_t &f) {
+        vm.in[DYNLD_VM_IN_TIME]      = f.timer;
+        vm.in[DYNLD_VM_IN_LED_MIN]   = f.led_min;
+        vm.in[DYNLD_VM_IN_LED_MAX]   = f.led_max;
+        vm.in[DYNLD_VM_IN_INIT]      = f.init;
+        vm.in[DYNLD_VM_IN_FLAGS]     = f.flags;
+        vm.in[DYNLD_VM_IN_HUE]       = f.hsv.h;
+        vm.in[DYNLD_VM_IN_SAT]       = f.hsv.s;
+        vm.in[DYNLD_VM_IN_VAL]       = f.hsv.v;
+        vm.in[DYNLD_VM_IN_SPEED]     = f.speed;
+        vm.in[DYNLD_VM_IN_LED_COUNT] = LED_COUNT;
+        vm.in[DYNLD_VM_IN_CENTER_X]  = CENTER_X;
+        vm.in[DYNLD_VM_IN_CENTER_Y]  = CENTER_Y;
+        return dynld_vm_run(&vm);
+    }
+
+    dynld_vm_t vm;
+};
+
+TEST_F(DynldVm, EffectsMatchNative) {
+    static const uint32_t timers[] = {0, 1, 1234, 65535 + 77, 400000};
+    static const uint8_t  speeds[] = {0, 127, 255};
+    static const uint8_t  flags[]  = {0xff, FLAG_KEYLIGHT};
+    static const uint8_t  ranges[][2] = {{0, LED_COUNT}, {0, 40}, {40, LED_COUNT}, {10, 10}};
+    for (const effect_t &e : s_effects) {
+        int effect = native(e);
+        ASSERT_GE(effect, 0);
+        code_t img = image(e.program());
+        ASSERT_EQ(load(img), 0) << e.name;
+        // pixel rain state carries over the frames, in the effect and in vm mem, same sequence for both
+        for (uint32_t timer : timers) {
+            for (uint8_t speed : speeds) {
+                for (uint8_t flag : flags) {
+                    for (auto &range : ranges) {
+                        for (bool init : {true, false}) {
+                            frame_t f = {timer, range[0], range[1], init, flag, {200, 255, 180}, speed};
+
+                            hsv_t native[LED_COUNT];
+                            bool  native_set[LED_COUNT];
+                            // same random sequence for both
+                            clear_out();
+                            random16_set_seed(1337);
+                            rgb_matrix_native_render(effect, &f);
+                            memcpy(native, s_out, sizeof(native));
+                            memcpy(native_set, s_out_set, sizeof(native_set));
+
+                            clear_out();
+                            random16_set_seed(1337);
+                            ASSERT_EQ(run(f), 0) << e.name;
+                            for (int i = 0; i < LED_COUNT; i++) {
+                                ASSERT_EQ(s_out_set[i], native_set[i]) << e.name << " led " << i << " timer " << timer << " speed " << (int)speed;
+                                if (!native_set[i]) continue;
+                                EXPECT_EQ(s_out[i].h, native[i].h) << e.name << " led " << i << " timer " << timer << " speed " << (int)speed;
+                                EXPECT_EQ(s_out[i].s, native[i].s) << e.name << " led " << i << " timer " << timer << " speed " << (int)speed;
+                                EXPECT_EQ(s_out[i].v, native[i].v) << e.name << " led " << i << " timer " << timer << " speed " << (int)speed;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        EXPECT_LT(vm.steps_max, (uint32_t)DYNLD_VM_BUDGET_DEFAULT) << e.name;
+    }
+}
+
+TEST_F(DynldVm, PixelRainKeepsState) {
+    code_t img = image(vm_pixel_rain());
+    ASSERT_EQ(load(img), 0);
+    frame_t f = {1000, 0, LED_COUNT, false, 0xff, {0, 255, 255}, 128};
+    int     set_count = 0;
+    // leds change only once per interval, wait_timer is kept in vm mem between frames
+    for (uint32_t t = 1000; t < 1100; t++) {
+        f.timer = t;
+        clear_out();
+        ASSERT_EQ(run(f), 0);
+        for (int i = 0; i < LED_COUNT; i++) set_count += s_out_set[i];
+    }
+    uint32_t interval = 500 / scale16by8(qadd8(128, 16), 16);
+    EXPECT_GT(set_count, 0);
+    EXPECT_LE(set_count, (int)(100 / interval + 1));
+}
+
+TEST_F(DynldVm, LoadRejectsInvalidPrograms) {
+    EXPECT_EQ(load({0x12345678, 1, OP(HALT, 0, 0, 0)}), -DYNLD_VM_ERR_HEADER);
+    code_t truncated = image({OP(HALT, 0, 0, 0)});
+    truncated[1]     = 2;
+    EXPECT_EQ(load(truncated), -DYNLD_VM_ERR_HEADER);
+    EXPECT_EQ(load(image({})), -DYNLD_VM_ERR_HEADER);
+    EXPECT_EQ(load(image({DYNLD_VM_OP_MAX_})), -DYNLD_VM_ERR_OP);
+    EXPECT_EQ(load(image({OP(ADD, 0, 1, DYNLD_VM_REGS)})), -DYNLD_VM_ERR_OPERAND);
+    EXPECT_EQ(load(image({OP(ENV, 0, DYNLD_VM_IN_MAX, 0)})), -DYNLD_VM_ERR_OPERAND);
+    EXPECT_EQ(load(image({OP(SETHSV, 0, DYNLD_VM_REGS - 2, 0)})), -DYNLD_VM_ERR_OPERAND);
+    EXPECT_EQ(load(image({OPI(LDI, 0, 1), OPI(JMP, 0, 0)})), -DYNLD_VM_ERR_JUMP);
+    EXPECT_EQ(load(image({OPI(JNZ, 0, 3), OP(HALT, 0, 0, 0)})), -DYNLD_VM_ERR_JUMP);
+    EXPECT_EQ(load(image({OPI(LDI, 1, 10), OP(LOOP, 0, 1, 2)})), -DYNLD_VM_ERR_JUMP);
+    EXPECT_EQ(load(image({OPI(LDI, 1, 10), OP(LOOP, 0, 1, 0)})), -DYNLD_VM_ERR_JUMP);
+    EXPECT_FALSE(dynld_vm_loaded(&vm));
+    EXPECT_EQ(load(image({OPI(LDI, 1, 10), OP(LOOP, 0, 1, 1)})), 0);
+    EXPECT_TRUE(dynld_vm_loaded(&vm));
+}
+
+TEST_F(DynldVm, BudgetUnloadsProgram) {
+    // loop to 0x7fffffff does not finish within the budget
+    code_t img = image({OPI(LDI, 1, -1), OPI(LDIH, 1, 0x7fff), OPI(LDI, 2, 0), OP(ADDI, 2, 2, 1), OP(LOOP, 0, 1, 1)}, 100);
+    ASSERT_EQ(load(img), 0);
+    frame_t f = {};
+    EXPECT_EQ(run(f), -DYNLD_VM_ERR_BUDGET);
+    EXPECT_FALSE(dynld_vm_loaded(&vm));
+    EXPECT_EQ(vm.error, DYNLD_VM_ERR_BUDGET);
+    EXPECT_EQ(run(f), -DYNLD_VM_ERR_NOPROG);
+}
+
+TEST_F(DynldVm, ArithmeticEdgeCases) {
+    // r0 = 7 / 0, r1 = 7 % 0, r2 = mem out of range wraps, r3 = led out of range, then store results in mem
+    code_t img = image({OPI(LDI, 5, 7), OPI(LDI, 6, 0), OP(DIV, 0, 5, 6), OP(MOD, 1, 5, 6), OPI(LDI, 7, 1000), OP(STB, 5, 7, 0), OP(LDB, 2, 7, 0), OP(LEDX, 3, 7, 0), OP(SETHSV, 7, 5, 0), OPI(LDI, 8, -3), OP(ABS, 4, 8, 0), OPI(LDI, 9, 0), OP(STB, 0, 9, 0), OP(STB, 1, 9, 1), OP(STB, 2, 9, 2), OP(STB, 3, 9, 3), OP(STB, 4, 9, 4)});
+    ASSERT_EQ(load(img), 0);
+    frame_t f = {};
+    ASSERT_EQ(run(f), 0);
+    EXPECT_EQ(vm.mem[0], 0);
+    EXPECT_EQ(vm.mem[1], 0);
+    EXPECT_EQ(vm.mem[2], 7);
+    EXPECT_EQ(vm.mem[3], 0);
+    EXPECT_EQ(vm.mem[4], 3);
+    EXPECT_EQ(vm.mem[1000 & (DYNLD_VM_MEM_SIZE - 1)], 7);
+    for (int i = 0; i < LED_COUNT; i++) EXPECT_FALSE(s_out_set[i]);
+}
+
+// interpreter overhead per frame against the C effects, printed, not asserted
+TEST_F(DynldVm, Benchmark) {
+    const int frames = 2000;
+    printf("%-24s %10s %10s %8s %8s\n", "effect", "native ns", "vm ns", "ratio", "insns");
+    for (const effect_t &e : s_effects) {
+        int effect = native(e);
+        ASSERT_GE(effect, 0);
+        code_t img = image(e.program());
+        ASSERT_EQ(load(img), 0);
+        frame_t f = {0, 0, LED_COUNT, false, 0xff, {0, 255, 255}, 128};
+
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < frames; n++) {
+            f.timer = n * 16;
+            rgb_matrix_native_render(effect, &f);
+        }
+        auto native_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / frames;
+
+        start = std::chrono::steady_clock::now();
+        for (int n = 0; n < frames; n++) {
+            f.timer = n * 16;
+            ASSERT_EQ(run(f), 0);
+        }
+        auto vm_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() / frames;
+
+        printf("%-24s %10lld %10lld %8.2f %8u\n", e.name, (long long)native_ns, (long long)vm_ns, native_ns ? (double)vm_ns / native_ns : 0.0, (unsigned)vm.steps_max);
+    }
+}
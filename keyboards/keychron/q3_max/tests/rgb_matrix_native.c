@@ -0,0 +1,83 @@
+#include <string.h>
+
+#define ENABLE_RGB_MATRIX_BREATHING
+#define ENABLE_RGB_MATRIX_BAND_SPIRAL_VAL
+#define ENABLE_RGB_MATRIX_CYCLE_ALL
+#define ENABLE_RGB_MATRIX_CYCLE_LEFT_RIGHT
+#define ENABLE_RGB_MATRIX_CYCLE_UP_DOWN
+#define ENABLE_RGB_MATRIX_RAINBOW_MOVING_CHEVRON
+#define ENABLE_RGB_MATRIX_CYCLE_OUT_IN
+#define ENABLE_RGB_MATRIX_CYCLE_OUT_IN_DUAL
+#define ENABLE_RGB_MATRIX_CYCLE_PINWHEEL
+#define ENABLE_RGB_MATRIX_CYCLE_SPIRAL
+#define ENABLE_RGB_MATRIX_DUAL_BEACON
+#define ENABLE_RGB_MATRIX_RAINBOW_BEACON
+#define ENABLE_RGB_MATRIX_JELLYBEAN_RAINDROPS
+#define ENABLE_RGB_MATRIX_PIXEL_RAIN
+
+#include "rgb_matrix.h"
+#include <lib/lib8tion/lib8tion.h>
+#include "rgb_matrix_native.h"
+
+const led_point_t k_rgb_matrix_center = {112, 32};
+
+rgb_config_t rgb_matrix_config;
+uint32_t     g_rgb_timer;
+led_config_t g_led_config;
+
+static uint8_t s_led_min, s_led_max;
+
+struct rgb_matrix_limits_t rgb_matrix_get_limits(uint8_t iter) {
+    return (struct rgb_matrix_limits_t){s_led_min, s_led_max};
+}
+
+RGB rgb_matrix_hsv_to_rgb(HSV hsv) {
+    return (RGB){.r = hsv.h, .g = hsv.s, .b = hsv.v};
+}
+
+void rgb_matrix_set_color(int index, uint8_t red, uint8_t green, uint8_t blue) {
+    rgb_matrix_native_set_color(index, red, green, blue);
+}
+
+#include "rgb_matrix_runners.inc"
+
+#define RGB_MATRIX_EFFECT(name)
+#define RGB_MATRIX_CUSTOM_EFFECT_IMPLS
+
+#include "rgb_matrix_effects.inc"
+
+#undef RGB_MATRIX_CUSTOM_EFFECT_IMPLS
+#undef RGB_MATRIX_EFFECT
+
+static const struct {
+    const char *name;
+    bool (*render)(effect_params_t *params);
+} s_effects[] = {
+#define RGB_MATRIX_EFFECT(name, ...) {#name, name},
+#include "rgb_matrix_effects.inc"
+#undef RGB_MATRIX_EFFECT
+};
+
+void rgb_matrix_native_set_led(uint8_t index, uint8_t x, uint8_t y, uint8_t flags) {
+    g_led_config.point[index] = (led_point_t){x, y};
+    g_led_config.flags[index] = flags;
+}
+
+int rgb_matrix_native_find(const char *name) {
+    for (int i = 0; i < (int)ARRAY_SIZE(s_effects); i++) {
+        if (!strcmp(s_effects[i].name, name)) return i;
+    }
+    return -1;
+}
+
+bool rgb_matrix_native_render(int effect, const frame_t *f) {
+    effect_params_t params = {.iter = 0, .flags = f->flags, .init = f->init};
+
+    s_led_min               = f->led_min;
+    s_led_max               = f->led_max;
+    g_rgb_timer             = f->timer;
+    rgb_matrix_config.hsv   = (HSV){f->hsv.h, f->hsv.s, f->hsv.v};
+    rgb_matrix_config.speed = f->speed;
+    rgb_matrix_config.flags = f->flags;
+    return s_effects[effect].render(&params);
+}
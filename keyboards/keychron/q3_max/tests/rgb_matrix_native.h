@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// the quantum/rgb_matrix effects built for the host, the reference of the vm programs.
+// leds are written through rgb_matrix_native_set_color with hsv unconverted (r=h, g=s, b=v).
+
+typedef struct {
+    uint8_t h, s, v;
+} hsv_t;
+
+typedef struct {
+    uint32_t timer;
+    uint8_t  led_min, led_max;
+    bool     init;
+    uint8_t  flags;
+    hsv_t    hsv;
+    uint8_t  speed;
+} frame_t;
+
+// provided by the test
+void rgb_matrix_native_set_color(int index, uint8_t h, uint8_t s, uint8_t v);
+
+void rgb_matrix_native_set_led(uint8_t index, uint8_t x, uint8_t y, uint8_t flags);
+// effect index of RGB_MATRIX_<name>, -1 if not built
+int rgb_matrix_native_find(const char *name);
+bool rgb_matrix_native_render(int effect, const frame_t *f);
@@ -0,0 +1,27 @@
+# not part of the core test list, built on request ahead of the core test makefile:
+#   make -r -R -f keyboards/keychron/q3_max/tests/rules.mk -f builddefs/build_test.mk \
+#       SILENT=false TEST=dynld_vm TEST_OUTPUT=dynld_vm TEST_PATH=keyboards/keychron/q3_max/tests
+#   .build/test/dynld_vm.elf
+# the paths are expanded once build_test.mk has set them, hence the deferred assignments.
+
+DYNLD_VM_PATH = keyboards/keychron/q3_max
+
+# rgb_matrix effects built for the host as the reference of the vm programs
+dynld_vm_DEFS = \
+	-DMATRIX_ROWS=6 \
+	-DMATRIX_COLS=17 \
+	-DRGB_MATRIX_LED_COUNT=87
+
+dynld_vm_SRC = \
+	$(DYNLD_VM_PATH)/tests/dynld_vm_tests.cpp \
+	$(DYNLD_VM_PATH)/tests/rgb_matrix_native.c \
+	$(DYNLD_VM_PATH)/dynld_vm.c \
+	$(LIB_PATH)/lib8tion/lib8tion.c
+
+dynld_vm_INC = \
+	. \
+	$(DYNLD_VM_PATH) \
+	$(DYNLD_VM_PATH)/tests \
+	$(QUANTUM_PATH)/rgb_matrix \
+	$(QUANTUM_PATH)/rgb_matrix/animations \
+	$(QUANTUM_PATH)/rgb_matrix/animations/runners
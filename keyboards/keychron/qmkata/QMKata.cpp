@@ -24,6 +24,15 @@ extern "C" {
 #include "timer.h"
 #include "debug_user.h"
 #include "version.h"
+#include "crc.h"
+#include "qmkata_pub.h"
+#include "qmkata_dispatch.h"
+#include "qmkata_log.h"
+#include "qmkata_trace.h"
+#include "trace_point.h"
+#ifdef PROTOCOL_CHIBIOS
+#include <ch.h>
+#endif
 
 void debug_led_on(int li);
 }
@@ -34,8 +43,8 @@ typedef uint16_t rx_buffer_index_t;
 typedef void (*send_data_fn)(uint8_t *data, uint16_t len);
 typedef void (*send_char_fn)(uint8_t ch);
 
-// BufferStream is the "Firmata Stream" implementation, external rx buffer can be set
-// to process directly from it or put in its own rx buffer with received().
+// BufferStream is a linear "Firmata Stream" implementation used for the console output,
+// external rx buffer can be set to process directly from it or put in its own rx buffer with received().
 // Firmata calls write() to write to tx buffer and flush() to send it.
 // sending is done in flush() by calling send_data() or send_char() function hooks.
 class BufferStream : public Stream
@@ -90,31 +99,6 @@ public:
         _rx_buffer_head = _rx_buffer_tail = 0;
     }
 
-    // set external "rx buffer" and process directly from it if possible
-    // otherwise copy to rx buffer with received()
-    int rx_buffer_set(uint8_t* buf, uint16_t len) {
-        _rx_buffer = buf;
-        _rx_buffer_size = len;
-        _rx_buffer_tail = 0;
-        _rx_buffer_head = len;
-        return 0;
-    }
-
-    // received byte insert at head
-    int received(uint8_t c) {
-        if (!_rx_buffer) return -1;
-
-        rx_buffer_index_t i = (_rx_buffer_head + 1) % _rx_buffer_size;
-        _rx_buffer[_rx_buffer_head] = c;
-        _rx_buffer_head = i;
-
-        if (_rx_buffer_head == _rx_buffer_tail) {
-            _rx_buffer_head = _rx_buffer_tail = 0;
-            return -1;
-        }
-        return 1;
-    }
-
     virtual int available(void) { if (_rx_buffer_head != _rx_buffer_tail) return 1; return 0; }
 
     virtual int peek(void) {
@@ -142,10 +126,12 @@ public:
     }
 
     virtual int availableForWrite(void) {
-        if (_tx_buffer_head < _tx_buffer_size) return 1;
-        return 0;
+        return _tx_buffer_size - _tx_buffer_head;
     }
 
+    // number of bytes waiting in tx buffer
+    uint16_t pending(void) { return _tx_buffer_head - _tx_buffer_tail; }
+
     virtual void flush(void) {
         _tx_last_flush = timer_read();
         if (!_tx_written) return;
@@ -172,18 +158,13 @@ public:
         _tx_buffer[_tx_buffer_head] = c;
         _tx_buffer_head++;
         _tx_written = 1;
-        tx_buffer_index_t next_head = _tx_buffer_head % _tx_buffer_size;
 
-        // todo bb: handle buffer full
-        if (next_head == 0) {
-            debug_led_on(0);
-            // buffer full
+        if (_tx_buffer_head >= _tx_buffer_size) {
+            // buffer full, hand it over to send_data, it only queues it
             flush();
             return 1;
         }
-
-        _tx_buffer_head = next_head;
-        if (next_head >= _tx_buffer_size/2) _tx_flush = 1;
+        if (_tx_buffer_head >= _tx_buffer_size/2) _tx_flush = 1;
         return 1;
     }
 
@@ -195,6 +176,232 @@ public:
     }
 };
 
+// ReportRingStream is the raw hid "Firmata Stream" implementation.
+// tx buffer is a ring of raw hid reports, each report starts with RAWHID_QMKATA_MSG followed by payload.
+// Firmata write() goes directly into the payload of the report at ring head, flush() closes the
+// partially filled report (zero padded) and send() passes complete reports to send_report() directly
+// from the ring, no intermediate copies.
+// write() never sends, when the ring is full the byte is dropped and counted, producers should
+// reserve() the space for a whole message first so no partial message gets into the stream.
+// rx is an external buffer set with rx_buffer_set() and processed directly from it.
+class ReportRingStream : public Stream
+{
+uint8_t *_rx_buffer;
+uint16_t _rx_buffer_size;
+rx_buffer_index_t _rx_buffer_head;
+rx_buffer_index_t _rx_buffer_tail;
+
+uint8_t *_tx_ring;          // report_count * report_size bytes
+uint16_t _tx_report_size;   // raw hid report size including header byte
+uint16_t _tx_report_count;  // power of 2
+uint16_t _tx_head;          // free running index of report being written
+uint16_t _tx_tail;          // free running index of next report to send
+uint16_t _tx_pos;           // write position in head report
+uint8_t  _tx_header;
+
+uint32_t _tx_dropped;       // bytes dropped because ring was full
+uint16_t _tx_last_commit;
+
+send_data_fn _send_report;
+
+    uint16_t _reports_used(void) { return _tx_head - _tx_tail; }
+    uint8_t* _report(uint16_t index) { return &_tx_ring[(index & (_tx_report_count-1)) * _tx_report_size]; }
+
+public:
+
+    ReportRingStream(uint8_t* tx_ring, uint16_t report_size, uint16_t report_count,
+                     uint8_t header, send_data_fn send_report) {
+        _rx_buffer = nullptr;
+        _rx_buffer_size = 0;
+        _rx_buffer_head = 0;
+        _rx_buffer_tail = 0;
+
+        _tx_ring = tx_ring;
+        _tx_report_size = report_size;
+        _tx_report_count = report_count;
+        _tx_head = 0;
+        _tx_tail = 0;
+        _tx_pos = 1;
+        _tx_header = header;
+        _tx_dropped = 0;
+        _tx_last_commit = 0;
+
+        _send_report = send_report;
+    };
+
+    void begin(unsigned long baud) { begin(baud, 0); }
+    void begin(unsigned long, uint8_t) {}
+    void end() {
+        flush();
+        while (send(_tx_report_count)) {}
+        _rx_buffer_head = _rx_buffer_tail = 0;
+    }
+
+    // set external "rx buffer" and process directly from it
+    int rx_buffer_set(uint8_t* buf, uint16_t len) {
+        _rx_buffer = buf;
+        _rx_buffer_size = len;
+        _rx_buffer_tail = 0;
+        _rx_buffer_head = len;
+        return 0;
+    }
+
+    virtual int available(void) { if (_rx_buffer_head != _rx_buffer_tail) return 1; return 0; }
+
+    virtual int peek(void) {
+        if (_rx_buffer_head == _rx_buffer_tail) return -1;
+        return _rx_buffer[_rx_buffer_tail];
+    }
+
+    virtual int read(void) {
+        if (_rx_buffer_head == _rx_buffer_tail) return -1;
+        return _rx_buffer[_rx_buffer_tail++];
+    }
+
+    // free payload bytes in tx ring
+    virtual int availableForWrite(void) {
+        uint16_t free_reports = _tx_report_count - _reports_used();
+        if (free_reports == 0) return 0;
+        return free_reports * (_tx_report_size - 1) - (_tx_pos - 1);
+    }
+
+    // check there is space for a message of len payload bytes
+    bool reserve(uint16_t len) {
+        if (availableForWrite() >= len) return 1;
+        _tx_dropped += len;
+        return 0;
+    }
+
+    uint32_t dropped(void) { return _tx_dropped; }
+
+    virtual size_t write(uint8_t c) {
+        if (_reports_used() == _tx_report_count) {
+            _tx_dropped++;
+            return 0;
+        }
+        uint8_t* report = _report(_tx_head);
+        if (_tx_pos == 1) {
+            report[0] = _tx_header;
+            _tx_last_commit = timer_read();
+        }
+        report[_tx_pos++] = c;
+        if (_tx_pos == _tx_report_size) {
+            _tx_head++;
+            _tx_pos = 1;
+        }
+        return 1;
+    }
+
+    // close the partially written report so it can be sent
+    virtual void flush(void) {
+        if (_tx_pos == 1) return;
+        uint8_t* report = _report(_tx_head);
+        memset(&report[_tx_pos], 0, _tx_report_size - _tx_pos);
+        _tx_head++;
+        _tx_pos = 1;
+    }
+
+    // partially written report waiting for more data too long
+    bool need_flush() {
+        return (_tx_pos != 1) && (timer_elapsed(_tx_last_commit) > 100);
+    }
+
+    // send up to max_reports complete reports, returns number of reports still queued
+    uint16_t send(uint16_t max_reports) {
+        while (_tx_tail != _tx_head && max_reports--) {
+            _send_report(_report(_tx_tail), _tx_report_size);
+            _tx_tail++;
+        }
+        return _reports_used();
+    }
+};
+
+// FrameAssembler reassembles a qmkata message the host split into multiple raw hid reports.
+// report: RAWHID_QMKATA_MSG, QMKATA_FRAME_START, frame id, fragment index, fragment payload
+// first fragment payload starts with message length (16 bits lsb first) and crc8 of the message.
+// message: cmd, seqnum, id, data... (same as QMKATA_SYSEX_START message)
+// fragments must arrive in order, a missing or repeated fragment drops the frame.
+class FrameAssembler
+{
+uint8_t *_arena;
+uint16_t _arena_size;
+
+uint16_t _len;          // message length
+uint16_t _received;     // message bytes received
+uint8_t  _crc;
+uint8_t  _frame_id;
+uint8_t  _next_frag;
+bool     _active;
+bool     _locked = 0;
+
+public:
+    enum {
+        FRAME_HEADER_SIZE = 3,  // QMKATA_FRAME_START, frame id, fragment index
+        FRAME_FIRST_SIZE  = 3,  // message length, crc8
+    };
+
+    FrameAssembler(uint8_t *arena, uint16_t arena_size) {
+        _arena = arena;
+        _arena_size = arena_size;
+        reset();
+    }
+
+    void reset() {
+        _len = 0;
+        _received = 0;
+        _crc = 0;
+        _next_frag = 0;
+        _active = 0;
+    }
+
+    // completed message is queued and still owns the arena
+    void lock() { _locked = 1; }
+    void release() { _locked = 0; }
+
+    uint8_t frame_id() { return _frame_id; }
+    uint8_t* message() { return _arena; }
+    uint16_t message_len() { return _len; }
+
+    // data points to QMKATA_FRAME_START, returns 1 when message is complete,
+    // 0 when more fragments expected, QMKATA_FRAME_ERR_... on error
+    int received(const uint8_t* data, uint8_t len) {
+        if (len <= FRAME_HEADER_SIZE) return -QMKATA_FRAME_ERR_LENGTH;
+        uint8_t frame_id = data[1];
+        uint8_t frag = data[2];
+        data += FRAME_HEADER_SIZE; len -= FRAME_HEADER_SIZE;
+
+        if (_locked) return -QMKATA_FRAME_ERR_BUSY;
+        if (frag == 0) {
+            if (len < FRAME_FIRST_SIZE) return -QMKATA_FRAME_ERR_LENGTH;
+            reset();
+            _frame_id = frame_id;
+            _len = data[0] | data[1] << 8;
+            _crc = data[2];
+            data += FRAME_FIRST_SIZE; len -= FRAME_FIRST_SIZE;
+            if (_len == 0 || _len > _arena_size) {
+                reset();
+                return -QMKATA_FRAME_ERR_LENGTH;
+            }
+            _active = 1;
+        } else
+        if (!_active || frame_id != _frame_id || frag != _next_frag) {
+            _frame_id = frame_id;
+            reset();
+            return -QMKATA_FRAME_ERR_SEQUENCE;
+        }
+        _next_frag++;
+
+        uint16_t n = MIN(len, _len - _received);
+        memcpy(&_arena[_received], data, n);
+        _received += n;
+        if (_received < _len) return 0;
+
+        _active = 0;
+        if (crc8(_arena, _len) != _crc) return -QMKATA_FRAME_ERR_CRC;
+        return 1;
+    }
+};
+
 class QMKata : public firmata::FirmataClass
 {
     bool _started = 0;
@@ -231,26 +438,45 @@ public:
 static QMKata s_qmkata;
 
 //------------------------------------------------------------------------------
-static void _rawhid_send_data(uint8_t *data, uint16_t len) {
-    uint8_t *hdr = data - 1;
-    *hdr = RAWHID_QMKATA_MSG; // qmkata
-
-    while (len) {
-        uint8_t send_len = MIN(RAW_EPSIZE_QMKATA, len+1);
-        if (send_len < RAW_EPSIZE_QMKATA) {
-            uint8_t buf[RAW_EPSIZE_QMKATA] = {0};
-            memcpy(buf, hdr, send_len);
-            raw_hid_send(buf, RAW_EPSIZE_QMKATA);
-            return;
-        }
+static void _rawhid_send_report(uint8_t *report, uint16_t len) {
+    raw_hid_send(report, len);
+}
 
-        //xprintf("RS:%u\n", send_len);
-        raw_hid_send(hdr, RAW_EPSIZE_QMKATA);
-        len -= send_len - 1;
-        if (len) {
-            hdr += send_len - 1;
-            *hdr = RAWHID_QMKATA_MSG;
-        }
+// tx sysex encoding, host selects QMKATA_TX_FORMAT_BINARY with REPORT_FIRMWARE
+static uint8_t s_tx_format = QMKATA_TX_FORMAT_7BIT;
+
+// sysex size in stream
+// 7 bits: start, command, 2x7 bits encoded data, end
+// binary: QMKATA_SYSEX_START, command, length (16 bits), data
+static inline uint16_t _sysex_stream_size(uint16_t len) {
+    if (s_tx_format == QMKATA_TX_FORMAT_BINARY) return 4 + len;
+    return 3 + 2*len;
+}
+
+#ifndef QMKATA_TX_RING_REPORTS
+#define QMKATA_TX_RING_REPORTS 16 // tx ring size in raw hid reports, power of 2
+#endif
+#ifndef QMKATA_TX_REPORTS_PER_TASK
+#define QMKATA_TX_REPORTS_PER_TASK 4 // max reports sent per qmkata_task call
+#endif
+static_assert((QMKATA_TX_RING_REPORTS & (QMKATA_TX_RING_REPORTS-1)) == 0, "QMKATA_TX_RING_REPORTS must be power of 2");
+
+static uint8_t _qmkata_tx_ring[QMKATA_TX_RING_REPORTS][RAW_EPSIZE_QMKATA] __attribute__((aligned(4))) = {};
+static ReportRingStream s_rawhid_stream(&_qmkata_tx_ring[0][0], RAW_EPSIZE_QMKATA, QMKATA_TX_RING_REPORTS,
+                                        RAWHID_QMKATA_MSG, _rawhid_send_report);
+
+// caller reserved the space
+static void _send_sysex(uint8_t cmd, uint8_t *data, uint16_t len) {
+    if (s_tx_format != QMKATA_TX_FORMAT_BINARY) {
+        s_qmkata.sendSysex(cmd, len, data);
+        return;
+    }
+    s_rawhid_stream.write(QMKATA_SYSEX_START);
+    s_rawhid_stream.write(cmd);
+    s_rawhid_stream.write(len & 0xff);
+    s_rawhid_stream.write(len >> 8);
+    for (uint16_t i = 0; i < len; i++) {
+        s_rawhid_stream.write(data[i]);
     }
 }
 
@@ -266,26 +492,154 @@ static void _send_console_string(uint8_t *data, uint16_t len) {
         int len = strlen(QMK_BUILDDATE);
         memcpy(__QMK_BUILDDATE__, QMK_BUILDDATE, len);
         __QMK_BUILDDATE__[len] = '\n';
-        s_qmkata.sendString(__QMK_BUILDDATE__);
+        if (s_rawhid_stream.reserve(_sysex_stream_size(len+1))) {
+            _send_sysex(STRING_DATA, (uint8_t*)__QMK_BUILDDATE__, len+1);
+        }
         build_date_sent = 1;
     }
 #endif
+    if (!s_rawhid_stream.reserve(_sysex_stream_size(len))) return;
+    if (s_tx_format == QMKATA_TX_FORMAT_BINARY) {
+        _send_sysex(STRING_DATA, data, len);
+        return;
+    }
     data[len] = 0;
     s_qmkata.sendString((char*)data);
 }
 
 //------------------------------------------------------------------------------
-#define TX_BUF_RESERVE 4 // reserve bytes before tx buffer for RAWHID_QMKATA_MSG
-static uint8_t _qmkata_tx_buf[512+TX_BUF_RESERVE] = {};
 static uint8_t _qmkata_console_buf[240] = {}; // adjust size as needed to hold console output until "qmkata task" is called
 
-static BufferStream s_rawhid_stream(0, 0,
-                                    _qmkata_tx_buf+TX_BUF_RESERVE, sizeof(_qmkata_tx_buf)-TX_BUF_RESERVE,
-                                    _rawhid_send_data, nullptr);
 static BufferStream s_console_stream(nullptr, 0,
                                      _qmkata_console_buf, sizeof(_qmkata_console_buf)-1,
                                      _send_console_string, nullptr);
 
+#ifndef QMKATA_RX_ARENA_SIZE
+#define QMKATA_RX_ARENA_SIZE 1088 // max reassembled message size, fits a 1024 bytes dynld function chunk
+#endif
+static uint8_t _qmkata_rx_arena[QMKATA_RX_ARENA_SIZE] __attribute__((aligned(4)));
+static FrameAssembler s_frame_assembler(_qmkata_rx_arena, sizeof(_qmkata_rx_arena));
+
+//------------------------------------------------------------------------------
+// requests are queued on receive and dispatched from qmkata_task.
+// the host gets QMKATA_RX_QUEUE_DEPTH credits, spends one per request and
+// gets them back with QMKATA_ID_CREDITS pubs once requests are processed.
+// requests complete strictly in the order received, responses carry the
+// request seqnum but never overtake each other. a request stays at the queue
+// head until the tx ring has room for its response (handler resp_size), a
+// handler sending more resumes from there. there is one reassembly arena,
+// a second frame is refused with QMKATA_FRAME_ERR_BUSY until the queued one is
+// dispatched, the host pipelines single report requests behind at most one frame.
+#ifndef QMKATA_RX_QUEUE_DEPTH
+#define QMKATA_RX_QUEUE_DEPTH 8 // power of 2
+#endif
+#ifndef QMKATA_RX_TASK_BUDGET_US
+#define QMKATA_RX_TASK_BUDGET_US 500 // max time spent dispatching requests per qmkata_task call
+#endif
+#define QMKATA_RX_REQUEST_SIZE (RAW_EPSIZE_QMKATA - 2) // report without RAWHID_QMKATA_MSG, QMKATA_SYSEX_START
+static_assert((QMKATA_RX_QUEUE_DEPTH & (QMKATA_RX_QUEUE_DEPTH-1)) == 0, "QMKATA_RX_QUEUE_DEPTH must be power of 2");
+
+class RequestQueue
+{
+struct request {
+    uint8_t *data;  // buf or reassembled frame
+    uint16_t len;
+    uint8_t  buf[QMKATA_RX_REQUEST_SIZE];
+};
+request  _req[QMKATA_RX_QUEUE_DEPTH];
+uint16_t _head = 0;
+uint16_t _tail = 0;
+uint8_t  _credits = 0;  // processed requests not yet returned to host
+uint16_t _rejected = 0;
+
+public:
+    uint8_t used() { return _head - _tail; }
+    uint8_t credits() { return _credits; }
+    uint16_t rejected() { return _rejected; }
+    void credits_returned(uint8_t n) { _credits -= n; }
+
+    // copy request (cmd, seqnum, id, data), false if host sent without credit
+    bool push(const uint8_t *data, uint16_t len) {
+        if (used() >= QMKATA_RX_QUEUE_DEPTH || len > QMKATA_RX_REQUEST_SIZE) {
+            _rejected++;
+            return false;
+        }
+        request &r = _req[_head & (QMKATA_RX_QUEUE_DEPTH-1)];
+        memcpy(r.buf, data, len);
+        r.data = r.buf;
+        r.len = len;
+        _head++;
+        return true;
+    }
+
+    // queue reassembled frame in place, frame assembler stays locked until dispatched
+    bool push_frame(uint8_t *data, uint16_t len) {
+        if (used() >= QMKATA_RX_QUEUE_DEPTH) {
+            _rejected++;
+            return false;
+        }
+        request &r = _req[_head & (QMKATA_RX_QUEUE_DEPTH-1)];
+        r.data = data;
+        r.len = len;
+        _head++;
+        return true;
+    }
+
+    // dispatch oldest request, false if queue is empty or the request stays queued
+    bool dispatch() {
+        if (!used()) return false;
+        request &r = _req[_tail & (QMKATA_RX_QUEUE_DEPTH-1)];
+        if (!qmkata_sysex_handler(r.data[0], r.len-1, r.data+1)) return false;
+        if (r.data != r.buf) s_frame_assembler.release();
+        _tail++;
+        _credits++;
+        return true;
+    }
+};
+static RequestQueue s_request_queue;
+
+static void _send_request_rejected(uint8_t seqnum) {
+    uint8_t resp[3];
+    resp[0] = seqnum;
+    resp[1] = QMKATA_ID_CREDITS;
+    resp[2] = QMKATA_CREDITS_REJECTED;
+    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, sizeof(resp));
+}
+
+// pub: id, credits returned, queue depth
+static void _send_credits(void) {
+    uint8_t credits = s_request_queue.credits();
+    if (!credits) return;
+    uint8_t data[3];
+    data[0] = QMKATA_ID_CREDITS;
+    data[1] = credits;
+    data[2] = QMKATA_RX_QUEUE_DEPTH;
+    if (qmkata_send_sysex(QMKATA_CMD_PUB, data, sizeof(data)) < 0) return;
+    s_request_queue.credits_returned(credits);
+}
+
+static void _dispatch_requests(void) {
+    // rounded up to one tick, the 1 kHz timer of non ChibiOS builds would give no budget at all
+    uint32_t budget = ((uint64_t)qmkata_timestamp_freq() * QMKATA_RX_TASK_BUDGET_US + 999999) / 1000000;
+    uint32_t start = qmkata_timestamp();
+    while (s_request_queue.dispatch()) {
+        if (qmkata_timestamp() - start >= budget) break;
+    }
+    _send_credits();
+}
+
+// get: queue depth, free entries (credits the host can use after reset)
+static void _qmkata_handle_cmd_get_credits(uint8_t cmd, uint8_t seqnum, uint16_t len, uint8_t *buf) {
+    uint8_t resp[4];
+    resp[0] = seqnum;
+    resp[1] = QMKATA_ID_CREDITS;
+    resp[2] = QMKATA_RX_QUEUE_DEPTH;
+    resp[3] = QMKATA_RX_QUEUE_DEPTH - s_request_queue.used();
+    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, sizeof(resp));
+}
+
+QMKATA_HANDLER(QMKATA_CMD_GET, QMKATA_ID_CREDITS, 0, 4, _qmkata_handle_cmd_get_credits)
+
 extern "C" {
 
 void debug_led_on(int li)
@@ -312,6 +666,7 @@ int8_t sendchar(uint8_t c) {
 
 void qmkata_init(const char* firmware) {
     s_qmkata.setFirmwareNameAndVersion(firmware, QMKATA_MAJOR_VERSION, QMKATA_MINOR_VERSION);
+    qmkata_dispatch_init();
     //s_qmkata.attach(0, qmkata_sysex_handler);
 }
 
@@ -319,10 +674,50 @@ void qmkata_start() {
     s_qmkata.begin(s_rawhid_stream);
 }
 
-void qmkata_send_sysex(uint8_t cmd, uint8_t* data, int len) {
-    if (!s_qmkata.started()) return;
+int qmkata_send_sysex(uint8_t cmd, uint8_t* data, int len) {
+    if (!s_qmkata.started()) return -1;
+    // whole message or nothing, host would not be able to parse a partial sysex
+    if (!s_rawhid_stream.reserve(_sysex_stream_size(len))) return -1;
 
-    s_qmkata.sendSysex(cmd, len, data);
+    _send_sysex(cmd, data, len);
+    return 0;
+}
+
+int qmkata_tx_capacity(void) {
+    int size = QMKATA_TX_RING_REPORTS * (RAW_EPSIZE_QMKATA - 1);
+    if (s_tx_format == QMKATA_TX_FORMAT_BINARY) return size - 4;
+    return (size - 3)/2;
+}
+
+int qmkata_tx_available(void) {
+    if (s_tx_format == QMKATA_TX_FORMAT_BINARY) {
+        int avail = s_rawhid_stream.availableForWrite() - 4;
+        if (avail < 0) return 0;
+        return avail;
+    }
+    int avail = s_rawhid_stream.availableForWrite() - 3;
+    if (avail < 0) return 0;
+    return avail/2;
+}
+
+uint32_t qmkata_timestamp(void) {
+#ifdef PROTOCOL_CHIBIOS
+    return chSysGetRealtimeCounterX();
+#else
+    return timer_read32();
+#endif
+}
+
+uint32_t qmkata_timestamp_freq(void) {
+#if defined(PROTOCOL_CHIBIOS) && defined(STM32_SYSCLK)
+    return STM32_SYSCLK;
+#else
+    return 1000;
+#endif
+}
+
+uint32_t qmkata_tx_dropped(void) {
+    return s_rawhid_stream.dropped();
 }
 
 int qmkata_recv(uint8_t c) {
@@ -338,19 +733,60 @@ int qmkata_recv_data(uint8_t *data, uint8_t len) {
     // skip RAWHID_QMKATA_MSG byte
     data++; len--;
     // qmkata sysex start without 2x7 bits encoding, call handler directly
-    if (data[0] == 0xF1) {
-        extern void qmkata_sysex_handler(uint8_t cmd, uint8_t len, uint8_t* buf);
+    if (data[0] == QMKATA_SYSEX_START) {
         data++; len--; // skip sysex start
-        if (data[0] == 0x79) { //REPORT_FIRMWARE
+        if (data[0] == 0x79) { //REPORT_FIRMWARE, optional requested tx format
+            uint8_t tx_format = QMKATA_TX_FORMAT_7BIT;
+            if (len > 1 && data[1] == QMKATA_TX_FORMAT_BINARY) tx_format = QMKATA_TX_FORMAT_BINARY;
+            // version always 7 bits encoded so any host can parse it, format switches after it
+            s_tx_format = QMKATA_TX_FORMAT_7BIT;
             s_qmkata.sendVersion();
+            s_tx_format = tx_format;
+            if (tx_format != QMKATA_TX_FORMAT_7BIT) {
+                uint8_t resp[3];
+                resp[0] = 0;
+                resp[1] = QMKATA_ID_TX_FORMAT;
+                resp[2] = tx_format;
+                qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, sizeof(resp));
+            }
             return 0;
         }
-        qmkata_sysex_handler(data[0], len, data+1);
+        if (len < 3) return -1;
+        if (!s_request_queue.push(data, len)) {
+            _send_request_rejected(data[1]);
+            return -1;
+        }
+        return 0;
+    }
+    // qmkata message split in multiple reports, call handler when fully received
+    if (data[0] == QMKATA_FRAME_START) {
+        int rc = s_frame_assembler.received(data, len);
+        if (rc < 0) {
+            DBG_USR(qmkata, "frame[%u]:err %d\n", s_frame_assembler.frame_id(), rc);
+            uint8_t resp[4];
+            resp[0] = 0; // seqnum unknown
+            resp[1] = QMKATA_ID_FRAME;
+            resp[2] = s_frame_assembler.frame_id();
+            resp[3] = -rc;
+            qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, sizeof(resp));
+            return -1;
+        }
+        if (rc == 1) {
+            uint8_t *msg = s_frame_assembler.message();
+            uint16_t msg_len = s_frame_assembler.message_len();
+            if (msg_len < 3) return -1;
+            if (!s_request_queue.push_frame(msg, msg_len)) {
+                _send_request_rejected(msg[1]);
+                return -1;
+            }
+            s_frame_assembler.lock();
+        }
         return 0;
     }
     // firmata sysex start 0xf0, with 2x7 bits encoding, sysex handler should decode it
 #ifdef QMKATA_7BIT_SYSEX_ENABLE
     if (data[0] == START_SYSEX) {
+        s_tx_format = QMKATA_TX_FORMAT_7BIT; // plain firmata client
         s_rawhid_stream.rx_buffer_set(data, len);
         const uint8_t max_iterations = len+1;
         uint8_t n = 0;
@@ -371,13 +807,24 @@ int qmkata_recv_data(uint8_t *data, uint8_t len) {
 void qmkata_task() {
     if (!s_qmkata.started()) return;
 
-    if (s_rawhid_stream.availableForWrite()) {
-        s_rawhid_stream.flush();
-    }
+    TRACE_BEGIN(TRACE_ID_QMKATA_TASK);
+    _dispatch_requests();
+    qmkata_pub_task();
+    qmkata_log_task();
+#ifdef TRACE_POINT_ENABLE
+    qmkata_trace_task();
+#endif
+    qmkata_sysex_task();
     if (s_console_stream.need_flush()) {
         s_console_stream.flush();
+    }
+    // responses are written in one go by the handlers, close the partial report
+    // right away unless there is still queued data to send before it
+    if (s_rawhid_stream.send(QMKATA_TX_REPORTS_PER_TASK) == 0 || s_rawhid_stream.need_flush()) {
         s_rawhid_stream.flush();
+        s_rawhid_stream.send(QMKATA_TX_REPORTS_PER_TASK);
     }
+    TRACE_END(TRACE_ID_QMKATA_TASK);
 }
 
 }
@@ -51,14 +51,27 @@ enum {
     QMKATA_ID_STRUCT_LAYOUT   = 8,
     QMKATA_ID_CONFIG          = 9,
     QMKATA_ID_KEYEVENT        = 10,   // todo bb: ID_EVENT and add EVENT_ID_KEYPRESS, EVENT_ID_...
+    QMKATA_ID_FRAME           = 11,   // multi report frame error response
+    QMKATA_ID_KEYEVENTS       = 12,   // batched key events pub, see qmkata_pub.h
+    QMKATA_ID_MATRIX_DELTAS   = 13,   // raw matrix row deltas pub, see qmkata_pub.h
+    QMKATA_ID_CREDITS         = 14,   // request queue credits, get/pub/rejected response
+    QMKATA_ID_TX_FORMAT       = 15,   // tx format accepted, response to REPORT_FIRMWARE
+    QMKATA_ID_LOG             = 16,   // deferred format log records pub, see qmkata_log.h
+    QMKATA_ID_TRACE           = 17,   // trace point events pub, see qmkata_trace.h
+    QMKATA_ID_DISPATCH        = 18,   // request not dispatched error response, see qmkata_dispatch.h
     QMKATA_ID_DYNLD_FUNCTION  = 250,  // dynamic load function into ram (todo bb: move to CLI or CONTROL_...)
     QMKATA_ID_DYNLD_FUNEXEC   = 251,  // exec "dynamic loaded function"
+    QMKATA_ID_DYNLD_MODULE    = 252,  // load relocatable multi function module, see dynld_module.h
+    QMKATA_ID_DYNLD_UPLOAD    = 253,  // windowed crc32 verified dynld function upload
+    QMKATA_ID_DYNLD_HOOK      = 254,  // dynld hook enable/budget, overrun pub
 };
 
 #define _QMKATA_HANDLE_CMD_SET_FN(name)   _qmkata_handle_cmd_set_##name
 #define _QMKATA_HANDLE_CMD_GET_FN(name)   _qmkata_handle_cmd_get_##name
-#define _QMKATA_HANDLE_CMD_SET(name)      void _QMKATA_HANDLE_CMD_SET_FN(name)(uint8_t cmd, uint8_t seqnum, uint8_t len, uint8_t *buf)
-#define _QMKATA_HANDLE_CMD_GET(name)      void _QMKATA_HANDLE_CMD_GET_FN(name)(uint8_t cmd, uint8_t seqnum, uint8_t len, uint8_t *buf)
+#define _QMKATA_HANDLE_CMD_SET(name)      void _QMKATA_HANDLE_CMD_SET_FN(name)(uint8_t cmd, uint8_t seqnum, uint16_t len, uint8_t *buf)
+#define _QMKATA_HANDLE_CMD_GET(name)      void _QMKATA_HANDLE_CMD_GET_FN(name)(uint8_t cmd, uint8_t seqnum, uint16_t len, uint8_t *buf)
+#define _QMKATA_HANDLE_CMD_SUB_FN(name)   _qmkata_handle_cmd_sub_##name
+#define _QMKATA_HANDLE_CMD_SUB(name)      void _QMKATA_HANDLE_CMD_SUB_FN(name)(uint8_t cmd, uint8_t seqnum, uint16_t len, uint8_t *buf)
 #define _QMKATA_HANDLE_CMD_SETGET(name)   _QMKATA_HANDLE_CMD_SET(name); _QMKATA_HANDLE_CMD_GET(name)
 
 _QMKATA_HANDLE_CMD_SETGET(default_layer);
@@ -70,6 +83,11 @@ _QMKATA_HANDLE_CMD_GET(struct_layout);
 _QMKATA_HANDLE_CMD_SETGET(config);
 _QMKATA_HANDLE_CMD_SET(dynld_function);
 _QMKATA_HANDLE_CMD_SET(dynld_funexec);
+_QMKATA_HANDLE_CMD_SET(dynld_module);
+_QMKATA_HANDLE_CMD_SET(dynld_upload);
+_QMKATA_HANDLE_CMD_SETGET(dynld_hook);
+_QMKATA_HANDLE_CMD_SUB(status);
+_QMKATA_HANDLE_CMD_SUB(config);
 
 // rgb matrix buffer set from host
 typedef struct rgb_matrix_host_buffer {
@@ -81,13 +99,68 @@ typedef struct rgb_matrix_host_buffer {
     } led[RGB_MATRIX_LED_COUNT];
 
     bool written;
+    uint16_t seq; // timed frame sequence number
+    uint32_t pts; // timed frame presentation time in g_rgb_timer units, 0: asap
 } rgb_matrix_host_buffer_t;
 
+#ifndef RGB_HOST_FRAME_QUEUE_SIZE
+#define RGB_HOST_FRAME_QUEUE_SIZE 3     // jitter buffer depth
+#endif
+#ifndef RGB_HOST_FRAME_LATE_MS
+#define RGB_HOST_FRAME_LATE_MS 20       // presented later than pts + this is counted as late
+#endif
+#ifndef RGB_HOST_FRAME_HOLD_MS
+#define RGB_HOST_FRAME_HOLD_MS 1000     // last frame is shown this long when host stops streaming
+#endif
+
+// timed host frames (RGB_BUF_FMT_FRAME), decoded into a free back buffer, queued until their
+// presentation time and swapped to front once per rendered rgb frame right before flush
+typedef struct rgb_matrix_host_frames {
+    rgb_matrix_host_buffer_t frame[RGB_HOST_FRAME_QUEUE_SIZE+2]; // queued + front + back
+    uint8_t queue[RGB_HOST_FRAME_QUEUE_SIZE]; // frame indices, oldest first
+    uint8_t queued;
+    int8_t  front;
+    bool    seq_valid;
+    uint16_t seq_last; // last queued sequence number
+} rgb_matrix_host_frames_t;
+
+typedef struct rgb_matrix_host_frame_status {
+    uint32_t timer;     // g_rgb_timer at last present, host aligns pts to it
+    uint16_t seq;       // last presented frame
+    uint16_t presented;
+    uint16_t dropped;   // replaced in queue before presentation, stale or queue overflow
+    uint16_t late;      // presented later than pts + RGB_HOST_FRAME_LATE_MS
+    uint16_t lost;      // sequence number gaps
+    uint8_t  queued;
+} rgb_matrix_host_frame_status_t;
+
+// front frame to render at time now or NULL
+rgb_matrix_host_buffer_t* rgb_matrix_host_frame_present(uint32_t now);
+
+// QMKATA_ID_RGB_MATRIX_BUF encodings, selected by first byte >= RGB_BUF_FMT_BASE,
+// otherwise data is [index, duration, r, g, b] tuples
+enum rgb_matrix_buf_format {
+    RGB_BUF_FMT_BASE    = 0xF0,
+    RGB_BUF_FMT_RGB888  = 0xF1, // duration, start, count, [r, g, b] x count
+    RGB_BUF_FMT_RGB565  = 0xF2, // duration, start, count, [rgb565 lsb first] x count
+    RGB_BUF_FMT_RLE     = 0xF3, // duration, start, [run length, r, g, b]...
+    RGB_BUF_FMT_PALETTE = 0xF4, // duration, start, count, palette size, [r, g, b] x palette size, indices (4 bits if palette size <= 16)
+    RGB_BUF_FMT_DELTA   = 0xF5, // duration, [skip, count, [r, g, b] x count]... unchanged leds keep previous color
+    RGB_BUF_FMT_FRAME   = 0xF6, // seq (16 bits), pts (32 bits), format (one of above), data... timed frame, lsb first
+};
+
 enum DYNLD_FUNC_ID {
     DYNLD_FUN_ID_ANIMATION = 0,
     DYNLD_FUN_ID_EXEC,
 
     DYNLD_FUN_ID_TEST,
+    // hooks, only set by module exports, see dynld_hooks.h
+    DYNLD_FUN_ID_HOOK_FIRST,
+    DYNLD_FUN_ID_HOOK_PROCESS_RECORD = DYNLD_FUN_ID_HOOK_FIRST,
+    DYNLD_FUN_ID_HOOK_MATRIX_SCAN,
+    DYNLD_FUN_ID_HOOK_LAYER_STATE,
+    DYNLD_FUN_ID_HOOK_HOUSEKEEPING,
+    DYNLD_FUN_ID_HOOK_INDICATORS,
     DYNLD_FUN_ID_MAX
 };
 
@@ -96,6 +169,26 @@ typedef struct dynld_funcs {
 } dynld_funcs_t;
 
 #define RAWHID_QMKATA_MSG  0xFA
+#define QMKATA_SYSEX_START 0xF1 // sysex in one report without 2x7 bits encoding
+#define QMKATA_FRAME_START 0xF2 // message split in multiple reports, see FrameAssembler
+
+enum qmkata_frame_error {
+    QMKATA_FRAME_ERR_LENGTH = 1,
+    QMKATA_FRAME_ERR_SEQUENCE,
+    QMKATA_FRAME_ERR_CRC,
+    QMKATA_FRAME_ERR_BUSY,      // previous frame not dispatched yet, one frame in flight at a time
+};
+
+// tx sysex encoding, host requests it with QMKATA_SYSEX_START, REPORT_FIRMWARE, format.
+// firmware answers with the 7 bits encoded version followed by a QMKATA_ID_TX_FORMAT
+// response in the new format.
+// binary sysex: QMKATA_SYSEX_START, cmd, length (16 bits lsb first), data
+enum qmkata_tx_format {
+    QMKATA_TX_FORMAT_7BIT   = 0, // firmata sysex, START_SYSEX ... END_SYSEX, 2x7 bits per byte
+    QMKATA_TX_FORMAT_BINARY = 1,
+};
+
+#define QMKATA_CREDITS_REJECTED 0xff // request received without credit, not processed
 
 //------------------------------------------------------------------------------
 typedef void (*sysexCallbackFunction)(uint8_t command, uint8_t len, uint8_t *buf);
@@ -106,7 +199,20 @@ void qmkata_task(void);
 
 int qmkata_recv(uint8_t c);
 int qmkata_recv_data(uint8_t *data, uint8_t len);
-void qmkata_send_sysex(uint8_t cmd, uint8_t* data, int len);
+// dispatch a queued request, false while it has to stay queued (no tx space for the response, resumed handler)
+bool qmkata_sysex_handler(uint8_t cmd, uint16_t len, uint8_t *buf);
+void qmkata_sysex_task(void); // board sysex handler periodic work, called from qmkata_task
+// returns -1 if not started or there is no space in tx ring for the whole message
+int qmkata_send_sysex(uint8_t cmd, uint8_t* data, int len);
+// high resolution free running timestamp (cpu cycles on chibios)
+uint32_t qmkata_timestamp(void);
+uint32_t qmkata_timestamp_freq(void); // qmkata_timestamp ticks per second
+// max sysex data length which can be queued now
+int qmkata_tx_available(void);
+// max sysex data length the empty tx ring holds
+int qmkata_tx_capacity(void);
+// bytes dropped because tx ring was full
+uint32_t qmkata_tx_dropped(void);
 
 #ifdef __cplusplus
 }
@@ -6,13 +6,44 @@ QMKATA_DIR = qmkata
 SRC += \
 qmkata_sysex_handler.c \
 qmkata_rgb_matrix_user.c \
+dynld_module.c \
+dynld_hooks.c \
+dynld_vm.c \
 $(QMKATA_DIR)/FirmataParser.cpp \
 $(QMKATA_DIR)/FirmataMarshaller.cpp \
 $(QMKATA_DIR)/Firmata.cpp \
 $(QMKATA_DIR)/QMKata.cpp \
+$(QMKATA_DIR)/qmkata_pub.c \
+$(QMKATA_DIR)/qmkata_dispatch.c \
+$(QMKATA_DIR)/qmkata_log.c \
 $(QMKATA_DIR)/Print.cpp \
 #empty line
 
 CONSOLE_ENABLE = yes
+CRC_ENABLE = yes
 CONSOLE_QMKATA = yes
 RGB_MATRIX_CUSTOM_USER = yes
+
+# DBG_USR queues string id and raw arguments instead of formatting on the mcu, see qmkata_log.h
+#QMKATA_LOG_DEFERRED = yes
+ifeq ($(strip $(QMKATA_LOG_DEFERRED)), yes)
+    OPT_DEFS += -DQMKATA_LOG_DEFERRED
+    EXTRALDFLAGS += -T $(TOP_DIR)/keyboards/keychron/$(QMKATA_DIR)/qmkata_log.ld
+endif
+
+# latency histograms of scan loop trace points and key transitions (quantum/key_latency.h)
+# as STATUS_ID_LATENCY_*, see qmkata_latency.h
+#QMKATA_LATENCY = yes
+ifeq ($(strip $(QMKATA_LATENCY)), yes)
+    OPT_DEFS += -DQMKATA_LATENCY_ENABLE
+    SRC += $(QMKATA_DIR)/qmkata_latency.c
+    QMKATA_TRACE = yes
+    KEY_LATENCY_ENABLE = yes
+endif
+
+# scan loop trace points (quantum/trace_point.h) published while devel_config.pub_trace is set, see qmkata_trace.h
+#QMKATA_TRACE = yes
+ifeq ($(strip $(QMKATA_TRACE)), yes)
+    OPT_DEFS += -DTRACE_POINT_ENABLE
+    SRC += $(QMKATA_DIR)/qmkata_trace.c
+endif
@@ -0,0 +1,115 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "debug_user.h"
+
+#include "QMKata.h"
+#include "qmkata_dispatch.h"
+
+_Static_assert(QMKATA_DISPATCH_HANDLERS_MAX < 0x100, "handler index is 8 bits");
+
+extern const qmkata_handler_t __start_qmkata_handlers[];
+extern const qmkata_handler_t __stop_qmkata_handlers[];
+
+// slot -> handler index + 1, 0: no handler
+static uint8_t s_dispatch[QMKATA_DISPATCH_CMD_LAST - QMKATA_DISPATCH_CMD_FIRST + 1][QMKATA_DISPATCH_ID_SLOTS];
+
+qmkata_dispatch_stats_t g_qmkata_dispatch_stats;
+
+static uint8_t *_dispatch_slot(uint8_t cmd, uint8_t id) {
+    if (cmd < QMKATA_DISPATCH_CMD_FIRST || cmd > QMKATA_DISPATCH_CMD_LAST) return NULL;
+    uint8_t *row = s_dispatch[cmd - QMKATA_DISPATCH_CMD_FIRST];
+    if (id < QMKATA_DISPATCH_ID_LOW) return &row[id];
+    if (id >= QMKATA_DISPATCH_ID_HIGH) return &row[QMKATA_DISPATCH_ID_LOW + id - QMKATA_DISPATCH_ID_HIGH];
+    return NULL;
+}
+
+void qmkata_dispatch_init(void) {
+    uint16_t count = __stop_qmkata_handlers - __start_qmkata_handlers;
+    for (uint16_t i = 0; i < count; i++) {
+        const qmkata_handler_t *h = &__start_qmkata_handlers[i];
+        uint8_t *slot = _dispatch_slot(h->cmd, h->id);
+        if (!slot || i >= QMKATA_DISPATCH_HANDLERS_MAX) {
+            g_qmkata_dispatch_stats.rejected++;
+            DBG_USR(qmkata, "handler %u:%u rejected\n", h->cmd, h->id);
+            continue;
+        }
+        *slot = i + 1;
+    }
+}
+
+static uint8_t s_step;      // resume step of the request at the queue head
+static bool    s_resume;    // handler asked to be called again
+
+void qmkata_dispatch_resume(uint8_t step) {
+    s_step = step;
+    s_resume = true;
+}
+
+uint8_t qmkata_dispatch_step(void) {
+    return s_step;
+}
+
+static void _send_dispatch_error(uint8_t cmd, uint8_t seqnum, uint8_t id, uint8_t err) {
+    uint8_t resp[QMKATA_DISPATCH_ERR_RESP_SIZE];
+    resp[0] = seqnum;
+    resp[1] = QMKATA_ID_DISPATCH;
+    resp[2] = cmd;
+    resp[3] = id;
+    resp[4] = err;
+    qmkata_send_sysex(QMKATA_CMD_RESPONSE, resp, sizeof(resp));
+}
+
+bool qmkata_sysex_handler(uint8_t cmd, uint16_t len, uint8_t *buf) {
+    if (len < 2) return true;
+
+    uint8_t seqnum = buf[0];
+    uint8_t id = buf[1];
+    buf += 2; len -= 2;
+    DBG_USR(qmkata, "cmd:%d,len:%u,seqnum=%u\n", cmd, len, seqnum);
+
+    const qmkata_handler_t *h = NULL;
+    uint8_t err = 0;
+    uint8_t *slot = _dispatch_slot(cmd, id);
+    if (!slot || !*slot) {
+        err = QMKATA_DISPATCH_ERR_UNHANDLED;
+    } else {
+        h = &__start_qmkata_handlers[*slot - 1];
+        if (len < h->min_len) err = QMKATA_DISPATCH_ERR_SHORT;
+        else if (h->resp_size > qmkata_tx_capacity()) err = QMKATA_DISPATCH_ERR_OVERSIZE;
+    }
+
+    // request stays queued until the response fits, the host waits for it or runs out of credits
+    uint16_t resp_size = err ? QMKATA_DISPATCH_ERR_RESP_SIZE : h->resp_size;
+    if (qmkata_tx_available() < resp_size) {
+        g_qmkata_dispatch_stats.busy++;
+        return false;
+    }
+    if (err) {
+        if (err == QMKATA_DISPATCH_ERR_UNHANDLED) g_qmkata_dispatch_stats.unhandled++;
+        if (err == QMKATA_DISPATCH_ERR_SHORT) g_qmkata_dispatch_stats.short_len++;
+        if (err == QMKATA_DISPATCH_ERR_OVERSIZE) g_qmkata_dispatch_stats.oversize++;
+        _send_dispatch_error(cmd, seqnum, id, err);
+        return true;
+    }
+    s_resume = false;
+    h->fn(cmd, seqnum, len, buf);
+    if (s_resume) return false;
+    s_step = 0;
+    return true;
+}
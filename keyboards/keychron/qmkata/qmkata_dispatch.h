@@ -0,0 +1,90 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef QMKATA_DISPATCH_HANDLERS_MAX
+#define QMKATA_DISPATCH_HANDLERS_MAX 255 // max handlers (all modules), handler index is 8 bits
+#endif
+
+// dispatch slots: cmd QMKATA_CMD_SET..QMKATA_CMD_SUB x id 0..31 and 0xe0..0xff
+#define QMKATA_DISPATCH_CMD_FIRST   QMKATA_CMD_SET
+#define QMKATA_DISPATCH_CMD_LAST    QMKATA_CMD_SUB
+#define QMKATA_DISPATCH_ID_LOW      32
+#define QMKATA_DISPATCH_ID_HIGH     0xe0
+#define QMKATA_DISPATCH_ID_SLOTS    (QMKATA_DISPATCH_ID_LOW + (0x100 - QMKATA_DISPATCH_ID_HIGH))
+
+typedef void (*qmkata_handler_fn_t)(uint8_t cmd, uint8_t seqnum, uint16_t len, uint8_t *buf);
+
+typedef struct qmkata_handler {
+    uint8_t  cmd;
+    uint8_t  id;
+    uint8_t  min_len;   // min payload length after seqnum and id, shorter requests get QMKATA_DISPATCH_ERR_SHORT
+    uint16_t resp_size; // sysex data length sent per call, request stays queued until the tx ring has it, 0: no response
+    qmkata_handler_fn_t fn;
+} qmkata_handler_t;
+
+// requests which are not dispatched get an error response so the host does not wait for them:
+// seqnum, QMKATA_ID_DISPATCH, cmd, id, error
+enum qmkata_dispatch_error {
+    QMKATA_DISPATCH_ERR_UNHANDLED = 1,  // no handler for cmd/id
+    QMKATA_DISPATCH_ERR_SHORT,          // payload shorter than min_len
+    QMKATA_DISPATCH_ERR_OVERSIZE,       // response larger than the empty tx ring
+};
+#define QMKATA_DISPATCH_ERR_RESP_SIZE 5
+
+typedef struct qmkata_dispatch_stats {
+    uint16_t unhandled; // no handler for cmd/id
+    uint16_t short_len; // payload shorter than min_len
+    uint16_t busy;      // dispatch deferred, not enough tx space for the response yet
+    uint16_t oversize;  // response larger than the empty tx ring
+    uint8_t  rejected;  // handlers out of dispatch range or beyond QMKATA_DISPATCH_HANDLERS_MAX, never dispatched
+} qmkata_dispatch_stats_t;
+
+extern qmkata_dispatch_stats_t g_qmkata_dispatch_stats;
+
+// index of the linked handler table by cmd/id, called once from qmkata_init
+void qmkata_dispatch_init(void);
+
+// handlers sending more than resp_size (struct layout bursts) send what fits, call
+// qmkata_dispatch_resume with the next step and return. the request keeps its queue
+// entry and credit, the handler is called again from a later qmkata_task once resp_size
+// is available, qmkata_dispatch_step returns the step (0 on the first call).
+void qmkata_dispatch_resume(uint8_t step);
+uint8_t qmkata_dispatch_step(void);
+
+// handlers are collected at link time from any module into the qmkata_handlers section
+// (__start_/__stop_ symbols provided by the linker), nothing is registered at runtime:
+// QMKATA_HANDLER(QMKATA_CMD_GET, QMKATA_ID_..., 1, 0, my_get_handler)
+// each entry is a global symbol named after cmd and id, a cmd/id handled twice does not link.
+#ifdef __cplusplus
+#define QMKATA_HANDLER_LINKAGE extern "C"
+#else
+#define QMKATA_HANDLER_LINKAGE
+#endif
+#define QMKATA_HANDLER(cmd, id, min_len, resp_size, fn) \
+    QMKATA_HANDLER_LINKAGE const qmkata_handler_t qmkata_handler_##cmd##_##id \
+        __attribute__((used, section("qmkata_handlers"))) = { cmd, id, min_len, resp_size, fn };
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,157 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "util.h"
+#include "trace_point.h"
+
+#include "QMKata.h"
+#include "qmkata_latency.h"
+#ifdef KEY_LATENCY_ENABLE
+#    include "key_latency.h"
+#endif
+
+#define SUB_COUNT (1 << QMKATA_LATENCY_SUB_BITS)
+
+typedef struct latency_hist {
+    uint16_t bucket[QMKATA_LATENCY_BUCKETS];
+    uint32_t min;
+    uint32_t max;
+    uint32_t begin;         // timestamp of the begin trace point
+    bool     begin_valid;
+} latency_hist_t;
+
+static latency_hist_t s_hist[QMKATA_LATENCY_MAX] = {
+    [0 ... QMKATA_LATENCY_MAX-1] = { .min = UINT32_MAX },
+};
+
+static inline uint8_t _bucket(uint32_t v) {
+    if (v < SUB_COUNT) return v;
+    uint8_t e = 31 - __builtin_clz(v);
+    return ((e - QMKATA_LATENCY_SUB_BITS + 1) << QMKATA_LATENCY_SUB_BITS) + ((v >> (e - QMKATA_LATENCY_SUB_BITS)) & (SUB_COUNT - 1));
+}
+
+// largest value counted in bucket
+static uint32_t _bucket_upper(uint8_t idx) {
+    if (idx < SUB_COUNT) return idx;
+    uint8_t  shift = (idx >> QMKATA_LATENCY_SUB_BITS) - 1;
+    uint32_t lower = (uint32_t)(SUB_COUNT + (idx & (SUB_COUNT - 1))) << shift;
+    return lower + ((1u << shift) - 1);
+}
+
+static void _record(latency_hist_t *h, uint32_t ticks) {
+    uint8_t idx = _bucket(ticks);
+    if (h->bucket[idx] == UINT16_MAX) {
+        for (uint8_t i = 0; i < QMKATA_LATENCY_BUCKETS; i++) h->bucket[i] >>= 1;
+    }
+    h->bucket[idx]++;
+    if (ticks < h->min) h->min = ticks;
+    if (ticks > h->max) h->max = ticks;
+}
+
+static int8_t _latency_id(uint8_t trace_id) {
+    switch (trace_id) {
+        case TRACE_ID_MATRIX_SCAN:  return QMKATA_LATENCY_MATRIX_SCAN;
+        case TRACE_ID_RGB_RENDER:   return QMKATA_LATENCY_RGB_RENDER;
+        case TRACE_ID_RGB_FLUSH:    return QMKATA_LATENCY_RGB_FLUSH;
+        case TRACE_ID_USB_SEND:     return QMKATA_LATENCY_USB_SEND;
+        default:                    return -1;
+    }
+}
+
+void qmkata_latency_trace_point(uint8_t trace_id, uint8_t type, uint32_t timestamp) {
+    if (trace_id == TRACE_ID_KEYBOARD_TASK) {
+        if (type != TRACE_TYPE_BEGIN) return;
+        latency_hist_t *h = &s_hist[QMKATA_LATENCY_LOOP];
+        if (h->begin_valid) _record(h, timestamp - h->begin);
+        h->begin = timestamp;
+        h->begin_valid = true;
+        return;
+    }
+    int8_t lid = _latency_id(trace_id);
+    if (lid < 0) return;
+    latency_hist_t *h = &s_hist[lid];
+    if (type == TRACE_TYPE_BEGIN) {
+        h->begin = timestamp;
+        h->begin_valid = true;
+    } else if (type == TRACE_TYPE_END && h->begin_valid) {
+        _record(h, timestamp - h->begin);
+        h->begin_valid = false;
+    }
+}
+
+#ifdef KEY_LATENCY_ENABLE
+// key transitions are stamped with the same clock as the trace points
+uint32_t key_latency_timestamp(void) {
+    return qmkata_timestamp();
+}
+
+uint32_t key_latency_timestamp_freq(void) {
+    return qmkata_timestamp_freq();
+}
+
+void key_latency_sample_kb(const key_latency_sample_t *sample) {
+    _record(&s_hist[QMKATA_LATENCY_KEY_DEBOUNCE], sample->debounce);
+    _record(&s_hist[QMKATA_LATENCY_KEY_HOLD], sample->hold);
+    _record(&s_hist[QMKATA_LATENCY_KEY_REPORT], sample->report);
+    _record(&s_hist[QMKATA_LATENCY_KEY_TOTAL], sample->total);
+    key_latency_sample_user(sample);
+}
+#endif
+
+static uint32_t _ticks_to_ns(uint32_t ticks) {
+    uint64_t ns = (uint64_t)ticks * 1000000000u / qmkata_timestamp_freq();
+    return ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+}
+
+void qmkata_latency_get(uint8_t latency_id, qmkata_latency_status_t *status) {
+    memset(status, 0, sizeof(*status));
+    if (latency_id >= QMKATA_LATENCY_MAX) return;
+    const latency_hist_t *h = &s_hist[latency_id];
+
+    uint32_t count = 0;
+    for (uint8_t i = 0; i < QMKATA_LATENCY_BUCKETS; i++) count += h->bucket[i];
+    status->count = count;
+    if (count == 0) return;
+    status->min = _ticks_to_ns(h->min);
+    status->max = _ticks_to_ns(h->max);
+
+    // rank of each percentile in parts per thousand, rounded up, at least the first sample
+    static const uint16_t permille[] = { 500, 900, 990, 999 };
+    uint32_t pct[ARRAY_SIZE(permille)] = {0};
+    uint32_t cum = 0;
+    uint8_t  p = 0;
+    for (uint8_t i = 0; i < QMKATA_LATENCY_BUCKETS && p < ARRAY_SIZE(permille); i++) {
+        cum += h->bucket[i];
+        while (p < ARRAY_SIZE(permille) && (uint64_t)cum * 1000 >= (uint64_t)count * permille[p]) {
+            // the bucket upper bound may exceed the largest sample seen
+            pct[p++] = _ticks_to_ns(MIN(_bucket_upper(i), h->max));
+        }
+    }
+    status->p50 = pct[0];
+    status->p90 = pct[1];
+    status->p99 = pct[2];
+    status->p999 = pct[3];
+}
+
+void qmkata_latency_reset(uint8_t latency_id) {
+    if (latency_id >= QMKATA_LATENCY_MAX) return;
+    latency_hist_t *h = &s_hist[latency_id];
+    memset(h->bucket, 0, sizeof(h->bucket));
+    h->min = UINT32_MAX;
+    h->max = 0;
+}
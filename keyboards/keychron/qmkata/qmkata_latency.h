@@ -0,0 +1,57 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// latency histograms (QMKATA_LATENCY = yes in qmkata.mk), fed by the trace points of quantum/trace_point.h.
+// samples are qmkata_timestamp ticks counted in log buckets, 4 sub buckets per power of 2 (hdr style),
+// so a percentile is off by at most one bucket width, 25% of the value.
+// percentiles are reported as the bucket upper bound, tails are never underestimated.
+// bucket counters are 16 bits, all buckets are halved when one would overflow, recent samples weigh more.
+
+enum qmkata_latency_id {
+    QMKATA_LATENCY_LOOP = 0,        // keyboard_task start to start, main loop period
+    QMKATA_LATENCY_MATRIX_SCAN,     // matrix_scan
+    QMKATA_LATENCY_RGB_RENDER,      // rgb_task_render
+    QMKATA_LATENCY_RGB_FLUSH,       // rgb_task_flush, led driver pwm buffer update
+    QMKATA_LATENCY_USB_SEND,        // keyboard and nkro report send
+    QMKATA_LATENCY_KEY_DEBOUNCE,    // key transitions (quantum/key_latency.h), raw transition to key event
+    QMKATA_LATENCY_KEY_HOLD,        // key event to process_record, tapping and combo terms
+    QMKATA_LATENCY_KEY_REPORT,      // process_record to report sent
+    QMKATA_LATENCY_KEY_TOTAL,       // raw transition to report sent
+    QMKATA_LATENCY_MAX
+};
+
+#define QMKATA_LATENCY_SUB_BITS 2
+#define QMKATA_LATENCY_BUCKETS  ((32 - QMKATA_LATENCY_SUB_BITS + 1) << QMKATA_LATENCY_SUB_BITS)
+
+// STATUS_ID_LATENCY_* status, times in ns
+typedef struct __attribute__((packed)) qmkata_latency_status {
+    uint32_t count;     // samples in the histogram, decays when buckets are halved
+    uint32_t min;       // since last reset
+    uint32_t max;
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t p999;
+} qmkata_latency_status_t;
+
+// called by trace_point() with its timestamp
+void qmkata_latency_trace_point(uint8_t trace_id, uint8_t type, uint32_t timestamp);
+void qmkata_latency_get(uint8_t latency_id, qmkata_latency_status_t *status);
+void qmkata_latency_reset(uint8_t latency_id);
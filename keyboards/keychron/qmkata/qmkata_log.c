@@ -0,0 +1,134 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "QMKata.h"
+#include "qmkata_log.h"
+
+_Static_assert((QMKATA_LOG_RING_SIZE & (QMKATA_LOG_RING_SIZE-1)) == 0, "QMKATA_LOG_RING_SIZE must be power of 2");
+_Static_assert(QMKATA_LOG_RECORD_MAX <= QMKATA_LOG_PUB_MAX, "QMKATA_LOG_PUB_MAX too small for a record");
+
+qmkata_log_stats_t g_qmkata_log_stats;
+
+// byte ring of whole records, producer qmkata_log_write / consumer qmkata_log_task
+static struct {
+    uint8_t  buf[QMKATA_LOG_RING_SIZE];
+    uint16_t head;
+    uint16_t tail;
+    uint32_t last_ts;   // timestamp of the last queued record
+    uint32_t dropped;   // records dropped since last sync
+    bool     synced;
+} s_log;
+
+static inline uint8_t _varint(uint8_t *p, uint32_t v) {
+    uint8_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static bool _ring_put(const uint8_t *rec, uint8_t len) {
+    uint16_t head = s_log.head;
+    if ((uint16_t)(QMKATA_LOG_RING_SIZE - (uint16_t)(head - s_log.tail)) < len) return false;
+    for (uint8_t i = 0; i < len; i++) {
+        s_log.buf[(head + i) & (QMKATA_LOG_RING_SIZE-1)] = rec[i];
+    }
+    s_log.head = head + len;
+    return true;
+}
+
+static bool _sync(uint32_t now) {
+    uint8_t rec[1 + 2 + 1 + 3*5];
+    uint8_t n = 1;
+    rec[n++] = QMKATA_LOG_SYNC_ID & 0xff;
+    rec[n++] = QMKATA_LOG_SYNC_ID >> 8;
+    rec[n++] = 0;
+    n += _varint(&rec[n], qmkata_timestamp_freq());
+    n += _varint(&rec[n], now);
+    n += _varint(&rec[n], s_log.dropped);
+    rec[0] = n;
+    if (!_ring_put(rec, n)) return false;
+
+    s_log.synced = true;
+    s_log.dropped = 0;
+    s_log.last_ts = now;
+    return true;
+}
+
+void qmkata_log_write(uint16_t id, uint8_t nargs, ...) {
+    uint32_t now = qmkata_timestamp();
+    if (!s_log.synced && !_sync(now)) {
+        s_log.dropped++;
+        g_qmkata_log_stats.dropped++;
+        return;
+    }
+
+    uint8_t rec[QMKATA_LOG_RECORD_MAX];
+    uint8_t n = 1;
+    rec[n++] = id & 0xff;
+    rec[n++] = id >> 8;
+    n += _varint(&rec[n], now - s_log.last_ts);
+
+    va_list ap;
+    va_start(ap, nargs);
+    if (nargs > QMKATA_LOG_ARGS_MAX) nargs = QMKATA_LOG_ARGS_MAX;
+    for (uint8_t i = 0; i < nargs; i++) {
+        n += _varint(&rec[n], va_arg(ap, uint32_t));
+    }
+    va_end(ap);
+    rec[0] = n;
+
+    if (!_ring_put(rec, n)) {
+        // resync so the host knows records are missing and timestamps restart from absolute
+        s_log.synced = false;
+        s_log.dropped++;
+        g_qmkata_log_stats.dropped++;
+        return;
+    }
+    s_log.last_ts = now;
+    g_qmkata_log_stats.records++;
+}
+
+void qmkata_log_task(void) {
+    uint16_t tail = s_log.tail;
+    while (tail != s_log.head) {
+        uint8_t data[1 + QMKATA_LOG_PUB_MAX];
+        uint16_t off = 0;
+        data[off++] = QMKATA_ID_LOG;
+        // whole records only, a record never spans two messages
+        uint16_t next = tail;
+        while (next != s_log.head) {
+            uint8_t len = s_log.buf[next & (QMKATA_LOG_RING_SIZE-1)];
+            if (off - 1 + len > QMKATA_LOG_PUB_MAX) break;
+            for (uint8_t i = 0; i < len; i++) {
+                data[off++] = s_log.buf[(next + i) & (QMKATA_LOG_RING_SIZE-1)];
+            }
+            next += len;
+        }
+        // tx ring full, keep records queued and retry on next task call
+        if (qmkata_send_sysex(QMKATA_CMD_PUB, data, off) < 0) break;
+
+        g_qmkata_log_stats.bytes += off - 1;
+        tail = next;
+        s_log.tail = tail;
+    }
+}
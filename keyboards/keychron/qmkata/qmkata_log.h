@@ -0,0 +1,67 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+// deferred format logging (QMKATA_LOG_DEFERRED = yes in qmkata.mk).
+// the format string is placed in the .qmkata_log section, which qmkata_log.ld keeps in the elf
+// but does not load into flash, the string address in that section is the string id.
+// a log call only queues id, timestamp and raw arguments, no formatting on the mcu.
+// qmkata_log_task publishes the queued records as QMKATA_ID_LOG pub messages,
+// util/qmkata_log_decode.py rebuilds the text from the elf of the same build.
+//
+// arguments are passed as 32 bits words (int, unsigned, char, pointer), no 64 bits or floating point.
+// %s arguments must point to constant strings in flash, the decoder reads them from the elf.
+// not interrupt safe, log from the main loop only (same as xprintf on the console stream).
+//
+// QMKATA_ID_LOG pub message: id, records
+// record: length (whole record incl. this byte), string id (16 bits), timestamp delta, arguments
+//  - timestamp delta: qmkata_timestamp ticks since previous record, unsigned LEB128
+//  - arguments: unsigned LEB128 each, count given by the record length
+// string id 0 is the sync record, sent before the first record and after dropped records,
+// arguments: qmkata_timestamp_freq, absolute qmkata_timestamp, records dropped since last sync.
+
+#ifndef QMKATA_LOG_RING_SIZE
+#define QMKATA_LOG_RING_SIZE 256 // bytes, power of 2
+#endif
+#ifndef QMKATA_LOG_PUB_MAX
+#define QMKATA_LOG_PUB_MAX   56  // max record bytes in one pub message
+#endif
+
+#define QMKATA_LOG_ARGS_MAX   8
+#define QMKATA_LOG_RECORD_MAX (1 + 2 + 5 + QMKATA_LOG_ARGS_MAX*5)
+#define QMKATA_LOG_SYNC_ID    0
+
+#define QMKATA_LOG_NARGS(...) _QMKATA_LOG_NARGS(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define _QMKATA_LOG_NARGS(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+
+// fmt must be a string literal
+#define QMKATA_LOG(fmt, ...) do { \
+    static const char _qmkata_log_fmt[] __attribute__((section(".qmkata_log"), used)) = fmt; \
+    qmkata_log_write((uint16_t)(uintptr_t)_qmkata_log_fmt, QMKATA_LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__); \
+    } while (0)
+
+typedef struct qmkata_log_stats {
+    uint32_t records;
+    uint32_t bytes;
+    uint32_t dropped;   // records dropped because the ring was full
+} qmkata_log_stats_t;
+extern qmkata_log_stats_t g_qmkata_log_stats;
+
+void qmkata_log_write(uint16_t id, uint8_t nargs, ...);
+void qmkata_log_task(void);
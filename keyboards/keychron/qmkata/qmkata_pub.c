@@ -0,0 +1,192 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "timer.h"
+#include "util.h"
+#include "debug_user.h"
+
+#include "QMKata.h"
+#include "qmkata_pub.h"
+
+extern matrix_row_t raw_matrix[MATRIX_ROWS];
+
+_Static_assert((QMKATA_PUB_KEYEVENT_RING_SIZE & (QMKATA_PUB_KEYEVENT_RING_SIZE-1)) == 0, "QMKATA_PUB_KEYEVENT_RING_SIZE must be power of 2");
+_Static_assert((QMKATA_PUB_MATRIX_RING_SIZE & (QMKATA_PUB_MATRIX_RING_SIZE-1)) == 0, "QMKATA_PUB_MATRIX_RING_SIZE must be power of 2");
+_Static_assert(MATRIX_ROWS < QMKATA_PUB_MATRIX_ROW_SYNC, "matrix row collides with sync flag");
+
+// single producer (key event path) / single consumer (qmkata_task) ring,
+// head only written by producer, tail only by consumer
+static struct {
+    qmkata_pub_keyevent_t event[QMKATA_PUB_KEYEVENT_RING_SIZE];
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    uint16_t oldest_time; // timer_read() when oldest queued event was recorded
+} s_keyevent_ring;
+
+// matrix scan (producer) / qmkata_task (consumer) ring, same rules as key event ring
+static struct {
+    qmkata_pub_matrix_delta_t delta[QMKATA_PUB_MATRIX_RING_SIZE];
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    uint16_t oldest_time;
+    bool enabled; // consumer side view of devel_config.pub_matrix
+    bool sync;    // absolute rows must be queued before deltas make sense again
+} s_matrix_ring;
+
+qmkata_pub_stats_t g_qmkata_pub_stats;
+
+bool qmkata_pub_keyevent(const keyevent_t *event) {
+    uint16_t head = s_keyevent_ring.head;
+    uint16_t used = head - s_keyevent_ring.tail;
+    if (used >= QMKATA_PUB_KEYEVENT_RING_SIZE) {
+        g_qmkata_pub_stats.dropped++;
+        g_qmkata_pub_stats.overflows++;
+        return false;
+    }
+    qmkata_pub_keyevent_t *ev = &s_keyevent_ring.event[head & (QMKATA_PUB_KEYEVENT_RING_SIZE-1)];
+    ev->timestamp = qmkata_timestamp();
+    ev->row = event->key.row;
+    ev->col = event->key.col;
+    ev->type = event->type;
+    ev->pressed = event->pressed;
+    ev->time = event->time;
+    if (used == 0) s_keyevent_ring.oldest_time = timer_read();
+    s_keyevent_ring.head = head + 1;
+    return true;
+}
+
+static inline void _matrix_ring_put(uint16_t head, uint32_t timestamp, uint8_t row, matrix_row_t bits) {
+    qmkata_pub_matrix_delta_t *d = &s_matrix_ring.delta[head & (QMKATA_PUB_MATRIX_RING_SIZE-1)];
+    d->timestamp = timestamp;
+    d->row = row;
+    d->bits = bits;
+}
+
+void qmkata_pub_matrix(const matrix_row_t prev[], const matrix_row_t curr[]) {
+    if (!devel_config.pub_matrix || !s_matrix_ring.enabled) return;
+
+    uint32_t timestamp = qmkata_timestamp();
+    uint16_t head = s_matrix_ring.head;
+    uint16_t used = head - s_matrix_ring.tail;
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        matrix_row_t bits = prev[row] ^ curr[row];
+        if (!bits) continue;
+        if (s_matrix_ring.sync || used >= QMKATA_PUB_MATRIX_RING_SIZE) {
+            if (!s_matrix_ring.sync) g_qmkata_pub_stats.matrix_overflows++;
+            g_qmkata_pub_stats.matrix_dropped++;
+            s_matrix_ring.sync = true;
+            continue;
+        }
+        if (used == 0) s_matrix_ring.oldest_time = timer_read();
+        _matrix_ring_put(head++, timestamp, row, bits);
+        used++;
+    }
+    s_matrix_ring.head = head;
+}
+
+// queue absolute rows once the ring is drained, deltas queued after them apply again
+static void _matrix_sync(void) {
+    uint16_t head = s_matrix_ring.head;
+    if (head != s_matrix_ring.tail) return;
+
+    uint32_t timestamp = qmkata_timestamp();
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        _matrix_ring_put(head++, timestamp, row | QMKATA_PUB_MATRIX_ROW_SYNC, raw_matrix[row]);
+    }
+    s_matrix_ring.oldest_time = timer_read();
+    s_matrix_ring.sync = false;
+    s_matrix_ring.head = head;
+}
+
+static void _matrix_pub_task(void) {
+    if (devel_config.pub_matrix != s_matrix_ring.enabled) {
+        s_matrix_ring.enabled = devel_config.pub_matrix;
+        s_matrix_ring.sync = true;
+    }
+    if (!s_matrix_ring.enabled) {
+        s_matrix_ring.tail = s_matrix_ring.head;
+        return;
+    }
+    if (s_matrix_ring.sync) _matrix_sync();
+
+    uint16_t tail = s_matrix_ring.tail;
+    uint16_t used = s_matrix_ring.head - tail;
+    if (used == 0) return;
+
+    uint8_t max_latency = devel_config.pub_max_latency; // ms
+    if (used < QMKATA_PUB_MATRIX_BATCH_MAX && timer_elapsed(s_matrix_ring.oldest_time) < max_latency) return;
+
+    while (used) {
+        uint8_t count = MIN(used, QMKATA_PUB_MATRIX_BATCH_MAX);
+        uint8_t data[4 + QMKATA_PUB_MATRIX_BATCH_MAX*sizeof(qmkata_pub_matrix_delta_t)];
+        uint16_t off = 0;
+        data[off++] = QMKATA_ID_MATRIX_DELTAS;
+        data[off++] = count;
+        memcpy(&data[off], &g_qmkata_pub_stats.matrix_dropped, sizeof(g_qmkata_pub_stats.matrix_dropped));
+        off += sizeof(g_qmkata_pub_stats.matrix_dropped);
+        for (uint8_t i = 0; i < count; i++) {
+            memcpy(&data[off], &s_matrix_ring.delta[(tail + i) & (QMKATA_PUB_MATRIX_RING_SIZE-1)], sizeof(qmkata_pub_matrix_delta_t));
+            off += sizeof(qmkata_pub_matrix_delta_t);
+        }
+        if (qmkata_send_sysex(QMKATA_CMD_PUB, data, off) < 0) break;
+
+        g_qmkata_pub_stats.matrix_dropped = 0;
+        g_qmkata_pub_stats.matrix_published += count;
+        tail += count;
+        used -= count;
+        s_matrix_ring.tail = tail;
+    }
+    s_matrix_ring.oldest_time = timer_read();
+}
+
+static void _keyevent_pub_task(void) {
+    uint16_t tail = s_keyevent_ring.tail;
+    uint16_t used = s_keyevent_ring.head - tail;
+    if (used == 0) return;
+
+    uint8_t max_latency = devel_config.pub_max_latency; // ms
+    if (used < QMKATA_PUB_KEYEVENT_BATCH_MAX && timer_elapsed(s_keyevent_ring.oldest_time) < max_latency) return;
+
+    while (used) {
+        uint8_t count = MIN(used, QMKATA_PUB_KEYEVENT_BATCH_MAX);
+        // events may wrap around the ring end, so copy into message
+        uint8_t data[4 + QMKATA_PUB_KEYEVENT_BATCH_MAX*sizeof(qmkata_pub_keyevent_t)];
+        uint16_t off = 0;
+        data[off++] = QMKATA_ID_KEYEVENTS;
+        data[off++] = count;
+        memcpy(&data[off], &g_qmkata_pub_stats.dropped, sizeof(g_qmkata_pub_stats.dropped));
+        off += sizeof(g_qmkata_pub_stats.dropped);
+        for (uint8_t i = 0; i < count; i++) {
+            memcpy(&data[off], &s_keyevent_ring.event[(tail + i) & (QMKATA_PUB_KEYEVENT_RING_SIZE-1)], sizeof(qmkata_pub_keyevent_t));
+            off += sizeof(qmkata_pub_keyevent_t);
+        }
+        // tx ring full, keep events queued and retry on next task call
+        if (qmkata_send_sysex(QMKATA_CMD_PUB, data, off) < 0) break;
+
+        g_qmkata_pub_stats.dropped = 0;
+        g_qmkata_pub_stats.published += count;
+        tail += count;
+        used -= count;
+        s_keyevent_ring.tail = tail;
+    }
+    s_keyevent_ring.oldest_time = timer_read();
+}
+
+void qmkata_pub_task(void) {
+    _keyevent_pub_task();
+    _matrix_pub_task();
+}
@@ -0,0 +1,75 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "keyboard.h"
+#include "matrix.h"
+
+#ifndef QMKATA_PUB_KEYEVENT_RING_SIZE
+#define QMKATA_PUB_KEYEVENT_RING_SIZE 64 // power of 2
+#endif
+#ifndef QMKATA_PUB_KEYEVENT_BATCH_MAX
+#define QMKATA_PUB_KEYEVENT_BATCH_MAX 16 // max events in one pub message
+#endif
+#ifndef QMKATA_PUB_MATRIX_RING_SIZE
+#define QMKATA_PUB_MATRIX_RING_SIZE 128 // power of 2
+#endif
+#ifndef QMKATA_PUB_MATRIX_BATCH_MAX
+#define QMKATA_PUB_MATRIX_BATCH_MAX 24 // max row deltas in one pub message
+#endif
+
+// QMKATA_ID_KEYEVENTS pub message:
+// id, count, dropped (16 bits), count x qmkata_pub_keyevent_t
+typedef struct __attribute__((packed)) qmkata_pub_keyevent {
+    uint8_t  row;
+    uint8_t  col;
+    uint8_t  type;
+    uint8_t  pressed;
+    uint16_t time;      // keyevent_t time (timer_read() at matrix scan)
+    uint32_t timestamp; // qmkata_timestamp() when the event left the matrix scan
+} qmkata_pub_keyevent_t;
+
+// QMKATA_ID_MATRIX_DELTAS pub message:
+// id, count, dropped (16 bits), count x qmkata_pub_matrix_delta_t
+// one entry per changed raw matrix row, rows changed in the same scan share the timestamp.
+// entries with QMKATA_PUB_MATRIX_ROW_SYNC set carry the absolute row value instead of the
+// xor delta, they are sent after enabling and after deltas were dropped.
+#define QMKATA_PUB_MATRIX_ROW_SYNC 0x80
+typedef struct __attribute__((packed)) qmkata_pub_matrix_delta {
+    uint32_t     timestamp; // qmkata_timestamp() of the scan
+    uint8_t      row;
+    matrix_row_t bits;      // xor against previous scan, or absolute on sync
+} qmkata_pub_matrix_delta_t;
+
+typedef struct qmkata_pub_stats {
+    uint32_t published;
+    uint16_t dropped;   // events lost because ring was full, reset when reported
+    uint16_t overflows; // times the ring was found full
+    uint32_t matrix_published;
+    uint16_t matrix_dropped;
+    uint16_t matrix_overflows;
+} qmkata_pub_stats_t;
+
+extern qmkata_pub_stats_t g_qmkata_pub_stats;
+
+// queue key event, called from the key event path, never sends
+bool qmkata_pub_keyevent(const keyevent_t *event);
+// queue raw matrix row deltas, called from matrix scan before prev is updated, never sends
+void qmkata_pub_matrix(const matrix_row_t prev[], const matrix_row_t curr[]);
+// send queued events in batches, called from qmkata_task
+void qmkata_pub_task(void);
@@ -0,0 +1,108 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "util.h"
+#include "debug_user.h"
+
+#include "QMKata.h"
+#include "qmkata_trace.h"
+#ifdef QMKATA_LATENCY_ENABLE
+#    include "qmkata_latency.h"
+#endif
+
+_Static_assert((QMKATA_TRACE_RING_SIZE & (QMKATA_TRACE_RING_SIZE-1)) == 0, "QMKATA_TRACE_RING_SIZE must be power of 2");
+
+// trace points (producer) / qmkata_task (consumer) ring, head only written by producer, tail only by consumer
+static struct {
+    qmkata_trace_event_t event[QMKATA_TRACE_RING_SIZE];
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    volatile bool     full; // window closed, set by producer, cleared by consumer once drained
+    uint32_t dropped_seen;  // g_qmkata_trace_stats.dropped when the last window was opened
+    uint16_t gap;           // events lost before the next message, consumer only
+} s_trace_ring;
+
+qmkata_trace_stats_t g_qmkata_trace_stats;
+
+void trace_point(uint8_t id, uint8_t type, uint16_t arg) {
+    uint32_t timestamp = qmkata_timestamp();
+#ifdef QMKATA_LATENCY_ENABLE
+    qmkata_latency_trace_point(id, type, timestamp);
+#endif
+    if (!devel_config.pub_trace) return;
+    if (s_trace_ring.full) {
+        g_qmkata_trace_stats.dropped++;
+        return;
+    }
+    uint16_t head = s_trace_ring.head;
+    if ((uint16_t)(head - s_trace_ring.tail) >= QMKATA_TRACE_RING_SIZE) {
+        s_trace_ring.full = true;
+        g_qmkata_trace_stats.dropped++;
+        return;
+    }
+    qmkata_trace_event_t *ev = &s_trace_ring.event[head & (QMKATA_TRACE_RING_SIZE-1)];
+    ev->timestamp = timestamp;
+    ev->id = id;
+    ev->type = type;
+    ev->arg = arg;
+    s_trace_ring.head = head + 1;
+}
+
+void qmkata_trace_task(void) {
+    uint16_t tail = s_trace_ring.tail;
+    uint16_t used = s_trace_ring.head - tail;
+    if (!devel_config.pub_trace) {
+        s_trace_ring.tail = s_trace_ring.head;
+        s_trace_ring.full = false;
+        s_trace_ring.dropped_seen = g_qmkata_trace_stats.dropped;
+        return;
+    }
+
+    while (used) {
+        uint8_t count = MIN(used, QMKATA_TRACE_BATCH_MAX);
+        // events may wrap around the ring end, so copy into message
+        uint8_t data[8 + QMKATA_TRACE_BATCH_MAX*sizeof(qmkata_trace_event_t)];
+        uint16_t off = 0;
+        uint32_t freq = qmkata_timestamp_freq();
+        data[off++] = QMKATA_ID_TRACE;
+        data[off++] = count;
+        memcpy(&data[off], &s_trace_ring.gap, sizeof(s_trace_ring.gap));
+        off += sizeof(s_trace_ring.gap);
+        memcpy(&data[off], &freq, sizeof(freq));
+        off += sizeof(freq);
+        for (uint8_t i = 0; i < count; i++) {
+            memcpy(&data[off], &s_trace_ring.event[(tail + i) & (QMKATA_TRACE_RING_SIZE-1)], sizeof(qmkata_trace_event_t));
+            off += sizeof(qmkata_trace_event_t);
+        }
+        // tx ring full, keep events queued and retry on next task call
+        if (qmkata_send_sysex(QMKATA_CMD_PUB, data, off) < 0) break;
+
+        s_trace_ring.gap = 0;
+        g_qmkata_trace_stats.published += count;
+        tail += count;
+        used -= count;
+        s_trace_ring.tail = tail;
+    }
+    // drained, open the next capture window
+    if (used == 0 && s_trace_ring.full) {
+        uint32_t lost = g_qmkata_trace_stats.dropped - s_trace_ring.dropped_seen;
+        s_trace_ring.gap = MIN(lost + s_trace_ring.gap, UINT16_MAX);
+        s_trace_ring.dropped_seen = g_qmkata_trace_stats.dropped;
+        g_qmkata_trace_stats.windows++;
+        s_trace_ring.full = false;
+    }
+}
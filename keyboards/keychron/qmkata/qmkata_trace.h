@@ -0,0 +1,57 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "trace_point.h"
+
+// trace point ring (TRACE_POINT_ENABLE builds, QMKATA_TRACE = yes in qmkata.mk).
+// trace_point() stores begin/end/instant events with qmkata_timestamp() while devel_config.pub_trace
+// is set, qmkata_trace_task publishes them in batches, util/qmkata_trace_to_perfetto.py converts
+// captured messages into chrome trace json.
+//
+// a full scan loop records more events than raw hid can carry, so the ring works as a capture window:
+// when it overflows recording stops until the ring is drained and restarts with a fresh window.
+// each window is complete, the first message of a window carries the events lost before it.
+
+#ifndef QMKATA_TRACE_RING_SIZE
+#define QMKATA_TRACE_RING_SIZE 256 // events, power of 2
+#endif
+#ifndef QMKATA_TRACE_BATCH_MAX
+#define QMKATA_TRACE_BATCH_MAX 24 // max events in one pub message
+#endif
+
+// QMKATA_ID_TRACE pub message:
+// id, count, dropped (16 bits, events lost before the first event of this message),
+// timestamp freq (32 bits), count x qmkata_trace_event_t
+typedef struct __attribute__((packed)) qmkata_trace_event {
+    uint32_t timestamp; // qmkata_timestamp()
+    uint8_t  id;        // trace_point_id
+    uint8_t  type;      // trace_point_type
+    uint16_t arg;
+} qmkata_trace_event_t;
+
+typedef struct qmkata_trace_stats {
+    uint32_t published;
+    uint32_t dropped;   // events lost while the window was full
+    uint32_t windows;   // capture windows closed and reopened
+} qmkata_trace_stats_t;
+
+extern qmkata_trace_stats_t g_qmkata_trace_stats;
+
+// send recorded events in batches, called from qmkata_task
+void qmkata_trace_task(void);
@@ -31,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "keycode_config.h"
 #include "debug.h"
 #include "quantum.h"
+#include "trace_point.h"
 
 #ifdef BACKLIGHT_ENABLE
 #    include "backlight.h"
@@ -40,6 +41,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #    include "pointing_device.h"
 #endif
 
+#ifdef KEY_LATENCY_ENABLE
+#    include "key_latency.h"
+#endif
+
 #if defined(ENCODER_ENABLE) && defined(ENCODER_MAP_ENABLE) && defined(SWAP_HANDS_ENABLE)
 #    include "encoder.h"
 #endif
@@ -271,17 +276,23 @@ void process_record(keyrecord_t *record) {
         return;
     }
 
+    TRACE_BEGIN(TRACE_ID_PROCESS_RECORD);
+#ifdef KEY_LATENCY_ENABLE
+    key_latency_process(&record->event);
+#endif
     if (!process_record_quantum(record)) {
 #ifndef NO_ACTION_ONESHOT
         if (is_oneshot_layer_active() && record->event.pressed && keymap_config.oneshot_enable) {
             clear_oneshot_layer_state(ONESHOT_OTHER_KEY_PRESSED);
         }
 #endif
+        TRACE_END(TRACE_ID_PROCESS_RECORD);
         return;
     }
 
     process_record_handler(record);
     post_process_record_quantum(record);
+    TRACE_END(TRACE_ID_PROCESS_RECORD);
 }
 
 void process_record_handler(keyrecord_t *record) {
@@ -7,6 +7,10 @@
 #include "util.h"
 #include "action_layer.h"
 
+#if !defined(NO_ACTION_LAYER) && defined(RESOLVED_LAYER_CACHE)
+static void resolved_layer_cache_layers_changed(void);
+#endif
+
 /** \brief Default Layer State
  */
 layer_state_t default_layer_state = 0;
@@ -39,6 +43,9 @@ static void default_layer_state_set(layer_state_t state) {
     default_layer_state = state;
     default_layer_debug();
     ac_dprintf("\n");
+#if !defined(NO_ACTION_LAYER) && defined(RESOLVED_LAYER_CACHE)
+    resolved_layer_cache_layers_changed();
+#endif
 #if defined(STRICT_LAYER_RELEASE)
     clear_keyboard_but_mods(); // To avoid stuck keys
 #elif defined(SEMI_STRICT_LAYER_RELEASE)
@@ -119,6 +126,9 @@ void layer_state_set(layer_state_t state) {
     layer_state = state;
     layer_debug();
     ac_dprintf("\n");
+#    ifdef RESOLVED_LAYER_CACHE
+    resolved_layer_cache_layers_changed();
+#    endif
 #    if defined(STRICT_LAYER_RELEASE)
     clear_keyboard_but_mods(); // To avoid stuck keys
 #    elif defined(SEMI_STRICT_LAYER_RELEASE)
@@ -216,11 +226,113 @@ void layer_debug(void) {
 }
 #endif
 
+#if !defined(NO_ACTION_LAYER) && defined(RESOLVED_LAYER_CACHE)
+/** \brief resolved layer cache
+ *
+ * Topmost non-transparent layer of each matrix key for the layers in resolved_layer_state,
+ * in the low bits of the entry. The high bits hold the source layer of the last press
+ * (source_layers_cache), so the pressed actions cache costs no extra memory.
+ */
+#    if MAX_LAYER_BITS <= 4
+typedef uint8_t resolved_layer_t;
+#        define RESOLVED_LAYER_SHIFT 4
+#    else
+typedef uint16_t resolved_layer_t;
+#        define RESOLVED_LAYER_SHIFT 8
+#    endif
+#    define RESOLVED_LAYER_MASK ((resolved_layer_t)((1U << RESOLVED_LAYER_SHIFT) - 1))
+
+static resolved_layer_t resolved_layer_cache[MATRIX_ROWS][MATRIX_COLS];
+static layer_state_t    resolved_layer_state;
+static bool             resolved_layer_cache_valid = false;
+#endif
+
+#ifndef NO_ACTION_LAYER
+/** \brief Top opaque layer
+ *
+ * Scans the given layers from the top, returns the first one where the key is not transparent or -1
+ */
+static int8_t top_opaque_layer(keypos_t key, layer_state_t layers) {
+    for (int8_t i = MAX_LAYER - 1; i >= 0; i--) {
+        if (layers & ((layer_state_t)1 << i)) {
+            if (action_for_key(i, key).code != ACTION_TRANSPARENT) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+#endif
+
+#if !defined(NO_ACTION_LAYER) && defined(RESOLVED_LAYER_CACHE)
+/** \brief Resolved layer cache invalidate
+ *
+ * The keymap changed, the table is rebuilt on the next lookup. Source layers of held keys are kept.
+ */
+void resolved_layer_cache_invalidate(void) {
+    resolved_layer_cache_valid = false;
+}
+
+/** \brief Resolved layer cache update
+ *
+ * Brings the table to the given layers. Only the keys that a layer turned on can shadow,
+ * or whose resolved layer was turned off, are looked up again.
+ */
+static void resolved_layer_cache_update(layer_state_t layers) {
+    if (resolved_layer_cache_valid && layers == resolved_layer_state) {
+        return;
+    }
+
+    const layer_state_t added   = layers & ~resolved_layer_state;
+    const layer_state_t removed = resolved_layer_state & ~layers;
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            const keypos_t    key   = {.col = col, .row = row};
+            resolved_layer_t *entry = &resolved_layer_cache[row][col];
+            uint8_t           layer = *entry & RESOLVED_LAYER_MASK;
+            int8_t            found;
+
+            if (!resolved_layer_cache_valid) {
+                found = top_opaque_layer(key, layers);
+            } else {
+                // the active layers above the resolved one are transparent, only a layer
+                // turned on above it can shadow it
+                found = top_opaque_layer(key, added & ~(((layer_state_t)2 << layer) - 1));
+                if (found < 0) {
+                    if (!(removed & ((layer_state_t)1 << layer))) {
+                        continue;
+                    }
+                    found = top_opaque_layer(key, layers & (((layer_state_t)1 << layer) - 1));
+                }
+            }
+            /* fall back to layer 0 */
+            *entry = (*entry & ~RESOLVED_LAYER_MASK) | (found < 0 ? 0 : found);
+        }
+    }
+    resolved_layer_state       = layers;
+    resolved_layer_cache_valid = true;
+}
+
+/** \brief Resolved layer cache layers changed
+ *
+ * Incremental update when the layer state or default layer state is set, before any key
+ * event of the new state. Nothing to do until the first lookup built the table.
+ */
+static void resolved_layer_cache_layers_changed(void) {
+    if (resolved_layer_cache_valid) {
+        resolved_layer_cache_update(layer_state | default_layer_state);
+    }
+}
+#endif
+
 #if !defined(NO_ACTION_LAYER) && !defined(STRICT_LAYER_RELEASE)
 /** \brief source layer cache
  */
 
+#    ifndef RESOLVED_LAYER_CACHE
 uint8_t source_layers_cache[((MATRIX_ROWS * MATRIX_COLS) + (CHAR_BIT)-1) / (CHAR_BIT)][MAX_LAYER_BITS] = {{0}};
+#    endif
 #    ifdef ENCODER_MAP_ENABLE
 uint8_t encoder_source_layers_cache[(NUM_ENCODERS + (CHAR_BIT)-1) / (CHAR_BIT)][MAX_LAYER_BITS] = {{0}};
 #    endif // ENCODER_MAP_ENABLE
@@ -259,8 +371,13 @@ uint8_t read_source_layers_cache_impl(uint16_t entry_number, uint8_t cache[][MAX
  */
 void update_source_layers_cache(keypos_t key, uint8_t layer) {
     if (key.row < MATRIX_ROWS && key.col < MATRIX_COLS) {
+#    ifdef RESOLVED_LAYER_CACHE
+        resolved_layer_t *entry = &resolved_layer_cache[key.row][key.col];
+        *entry                  = (*entry & RESOLVED_LAYER_MASK) | ((resolved_layer_t)layer << RESOLVED_LAYER_SHIFT);
+#    else
         const uint16_t entry_number = (uint16_t)(key.row * MATRIX_COLS) + key.col;
         update_source_layers_cache_impl(layer, entry_number, source_layers_cache);
+#    endif
     }
 #    ifdef ENCODER_MAP_ENABLE
     else if (key.row == KEYLOC_ENCODER_CW || key.row == KEYLOC_ENCODER_CCW) {
@@ -276,8 +393,12 @@ void update_source_layers_cache(keypos_t key, uint8_t layer) {
  */
 uint8_t read_source_layers_cache(keypos_t key) {
     if (key.row < MATRIX_ROWS && key.col < MATRIX_COLS) {
+#    ifdef RESOLVED_LAYER_CACHE
+        return resolved_layer_cache[key.row][key.col] >> RESOLVED_LAYER_SHIFT;
+#    else
         const uint16_t entry_number = (uint16_t)(key.row * MATRIX_COLS) + key.col;
         return read_source_layers_cache_impl(entry_number, source_layers_cache);
+#    endif
     }
 #    ifdef ENCODER_MAP_ENABLE
     else if (key.row == KEYLOC_ENCODER_CW || key.row == KEYLOC_ENCODER_CCW) {
@@ -322,21 +443,18 @@ action_t store_or_get_action(bool pressed, keypos_t key) {
  */
 uint8_t layer_switch_get_layer(keypos_t key) {
 #ifndef NO_ACTION_LAYER
-    action_t action;
-    action.code = ACTION_TRANSPARENT;
-
     layer_state_t layers = layer_state | default_layer_state;
-    /* check top layer first */
-    for (int8_t i = MAX_LAYER - 1; i >= 0; i--) {
-        if (layers & ((layer_state_t)1 << i)) {
-            action = action_for_key(i, key);
-            if (action.code != ACTION_TRANSPARENT) {
-                return i;
-            }
-        }
+#    ifdef RESOLVED_LAYER_CACHE
+    if (key.row < MATRIX_ROWS && key.col < MATRIX_COLS) {
+        // also catches the layer states assigned without layer_state_set (split sync, eeconfig)
+        resolved_layer_cache_update(layers);
+        return resolved_layer_cache[key.row][key.col] & RESOLVED_LAYER_MASK;
     }
+#    endif
+    /* check top layer first */
+    int8_t layer = top_opaque_layer(key, layers);
     /* fall back to layer 0 */
-    return 0;
+    return layer < 0 ? 0 : layer;
 #else
     return get_highest_layer(default_layer_state);
 #endif
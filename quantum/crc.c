@@ -73,3 +73,44 @@ __attribute__((weak)) uint8_t crc8(const void *data, size_t data_len) {
     return crc;
 }
 #endif
+
+#if defined(CRC32_USE_TABLE)
+// half byte table, 64 bytes instead of 1k for a full byte table
+static const uint32_t crc32_table[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c, //
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c  //
+};
+
+__attribute__((weak)) uint32_t crc32_update(uint32_t crc, const void *data, size_t data_len) {
+    const uint8_t *d = (const uint8_t *)data;
+
+    crc = ~crc;
+    while (data_len--) {
+        crc ^= *d++;
+        crc = (crc >> 4) ^ crc32_table[crc & 0x0f];
+        crc = (crc >> 4) ^ crc32_table[crc & 0x0f];
+    }
+    return ~crc;
+}
+#else
+__attribute__((weak)) uint32_t crc32_update(uint32_t crc, const void *data, size_t data_len) {
+    const uint8_t *d = (const uint8_t *)data;
+    size_t         i, j;
+
+    crc = ~crc;
+    for (i = 0; i < data_len; i++) {
+        crc ^= d[i];
+        for (j = 0; j < 8; j++) {
+            if ((crc & 1) != 0)
+                crc = (crc >> 1) ^ 0xedb88320;
+            else
+                crc >>= 1;
+        }
+    }
+    return ~crc;
+}
+#endif
+
+__attribute__((weak)) uint32_t crc32(const void *data, size_t data_len) {
+    return crc32_update(0, data, data_len);
+}
@@ -43,3 +43,22 @@ __attribute__((weak)) void crc_init(void);
  * \return             The calculated crc value.
  */
 __attribute__((weak)) uint8_t crc8(const void *data, size_t data_len);
+
+/**
+ * Continue CRC32 (IEEE 802.3, reflected, polynomial 0x04c11db7) over given data.
+ *
+ * \param[in] crc      CRC32 of the preceding data, 0 to start.
+ * \param[in] data     Pointer to a buffer of \a data_len bytes.
+ * \param[in] data_len Number of bytes in the \a data buffer.
+ * \return             The calculated crc value.
+ */
+__attribute__((weak)) uint32_t crc32_update(uint32_t crc, const void *data, size_t data_len);
+
+/**
+ * Generate CRC32 (IEEE 802.3, same as zlib) value from given data.
+ *
+ * \param[in] data     Pointer to a buffer of \a data_len bytes.
+ * \param[in] data_len Number of bytes in the \a data buffer.
+ * \return             The calculated crc value.
+ */
+__attribute__((weak)) uint32_t crc32(const void *data, size_t data_len);
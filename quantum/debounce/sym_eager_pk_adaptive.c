@@ -0,0 +1,288 @@
+/*
+Copyright 2017 Alex Ong<the.onga@gmail.com>
+Copyright 2021 Simon Arlott
+Copyright 2024 bugbuster
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+Per-key eager algorithm with a debounce window per key, see debounce_adaptive.h.
+After pressing a key, it immediately changes state, and sets a counter to the
+window of the key. No further inputs are accepted until it expires.
+
+The counters are bit planes like sym_eager_pk_bitsliced. The raw changes of a
+key while its counter runs are bounces, the time of the last one is recorded
+in the histogram of the key when the counter expires. If the raw state then
+differs from the debounced one the bounce outlasted the window (or the key
+was really released within it), the window is recorded.
+*/
+
+#include "debounce.h"
+#include "debounce_adaptive.h"
+#include "timer.h"
+#include <string.h>
+
+#ifndef DEBOUNCE
+#    define DEBOUNCE 5
+#endif
+
+// Maximum debounce: 255ms
+#if DEBOUNCE > UINT8_MAX
+#    undef DEBOUNCE
+#    define DEBOUNCE UINT8_MAX
+#endif
+
+#define DEBOUNCE_COUNTER_BITS 8
+
+// raw rows may have bits above MATRIX_COLS set, they are not keys and have no window
+#define DEBOUNCE_COLS_MASK ((matrix_row_t)((1ULL << MATRIX_COLS) - 1))
+
+typedef struct {
+    matrix_row_t active;                         // keys with a running counter
+    matrix_row_t counter[DEBOUNCE_COUNTER_BITS]; // bit n of the counter of each key
+    matrix_row_t raw;                            // raw state of the previous call
+} debounce_row_t;
+
+#if DEBOUNCE > 0
+static debounce_row_t debounce_rows[MATRIX_ROWS];
+static uint8_t        bounce_times[MATRIX_ROWS][MATRIX_COLS];
+static fast_timer_t   last_time;
+static bool           counters_need_update;
+static bool           matrix_need_update;
+static bool           cooked_changed;
+
+uint8_t g_debounce = DEBOUNCE;
+
+debounce_adaptive_config_t g_debounce_adaptive = {
+    .min    = DEBOUNCE_ADAPTIVE_MIN,
+    .max    = DEBOUNCE_ADAPTIVE_MAX,
+    .margin = DEBOUNCE_ADAPTIVE_MARGIN,
+    .learn  = 1,
+};
+
+uint8_t debounce_adaptive_windows[MATRIX_ROWS][MATRIX_COLS];
+uint8_t debounce_adaptive_histograms[MATRIX_ROWS][MATRIX_COLS][DEBOUNCE_ADAPTIVE_BUCKETS];
+
+// bucket n holds the bounce times below its edge and from the previous one
+static const uint8_t bucket_edges[DEBOUNCE_ADAPTIVE_BUCKETS] = {1, 2, 3, 4, 6, 8, 12, UINT8_MAX};
+
+static void update_debounce_counters(matrix_row_t cooked[], uint8_t num_rows, uint8_t elapsed_time);
+static void record_bounces(matrix_row_t raw[], uint8_t num_rows);
+static void transfer_matrix_values(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows);
+
+uint8_t debounce_adaptive_clamp(uint8_t window) {
+    if (window < g_debounce_adaptive.min) window = g_debounce_adaptive.min;
+    if (window > g_debounce_adaptive.max) window = g_debounce_adaptive.max;
+    return window;
+}
+
+void debounce_adaptive_clamp_windows(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            debounce_adaptive_windows[row][col] = debounce_adaptive_clamp(debounce_adaptive_windows[row][col]);
+        }
+    }
+}
+
+void debounce_adaptive_reset(void) {
+    memset(debounce_adaptive_histograms, 0, sizeof(debounce_adaptive_histograms));
+    memset(debounce_adaptive_windows, debounce_adaptive_clamp(g_debounce), sizeof(debounce_adaptive_windows));
+}
+
+// we use num_rows rather than MATRIX_ROWS to support split keyboards
+void debounce_init(uint8_t num_rows) {
+    memset(debounce_rows, 0, sizeof(debounce_rows));
+    debounce_adaptive_reset();
+}
+
+void debounce_free(void) {}
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed) {
+    bool updated_last = false;
+    cooked_changed    = false;
+
+    if (counters_need_update) {
+        fast_timer_t now          = timer_read_fast();
+        fast_timer_t elapsed_time = TIMER_DIFF_FAST(now, last_time);
+
+        last_time    = now;
+        updated_last = true;
+        if (elapsed_time > UINT8_MAX) {
+            elapsed_time = UINT8_MAX;
+        }
+
+        if (elapsed_time > 0) {
+            update_debounce_counters(cooked, num_rows, elapsed_time);
+        }
+    }
+
+    if (changed || matrix_need_update) {
+        if (!updated_last) {
+            last_time = timer_read_fast();
+        }
+
+        if (changed) {
+            record_bounces(raw, num_rows);
+        }
+        transfer_matrix_values(raw, cooked, num_rows);
+    }
+
+    return cooked_changed;
+}
+
+static uint8_t counter_get(const debounce_row_t *row_data, uint8_t col) {
+    uint8_t counter = 0;
+    for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++) {
+        if (row_data->counter[bit] & ((matrix_row_t)1 << col)) {
+            counter |= 1U << bit;
+        }
+    }
+    return counter;
+}
+
+// histogram of the key and window step toward the p99 bounce time
+static void record_transition(uint8_t row, uint8_t col, uint8_t bounce_time) {
+    if (!g_debounce_adaptive.learn) {
+        return;
+    }
+
+    uint8_t *histogram = debounce_adaptive_histograms[row][col];
+    uint8_t  bucket    = 0;
+    while (bucket < DEBOUNCE_ADAPTIVE_BUCKETS - 1 && bounce_time >= bucket_edges[bucket]) {
+        bucket++;
+    }
+    if (histogram[bucket] == UINT8_MAX) {
+        for (uint8_t i = 0; i < DEBOUNCE_ADAPTIVE_BUCKETS; i++) {
+            histogram[i] /= 2;
+        }
+    }
+    histogram[bucket]++;
+
+    uint16_t total = 0;
+    for (uint8_t i = 0; i < DEBOUNCE_ADAPTIVE_BUCKETS; i++) {
+        total += histogram[i];
+    }
+    if (total < DEBOUNCE_ADAPTIVE_MIN_SAMPLES) {
+        return;
+    }
+
+    uint16_t count = 0;
+    for (bucket = 0; bucket < DEBOUNCE_ADAPTIVE_BUCKETS - 1; bucket++) {
+        count += histogram[bucket];
+        if ((uint32_t)count * 100 >= (uint32_t)total * 99) {
+            break;
+        }
+    }
+    uint16_t target = bucket_edges[bucket] + g_debounce_adaptive.margin;
+    uint8_t  window = debounce_adaptive_windows[row][col];
+    if (window < target) {
+        window++;
+    } else if (window > target) {
+        window--;
+    }
+    debounce_adaptive_windows[row][col] = debounce_adaptive_clamp(window);
+}
+
+// Subtract the elapsed time from the running counters, the ones reaching 0 enable input.
+static void update_debounce_counters(matrix_row_t cooked[], uint8_t num_rows, uint8_t elapsed_time) {
+    counters_need_update     = false;
+    matrix_need_update       = false;
+    debounce_row_t *row_data = debounce_rows;
+    for (uint8_t row = 0; row < num_rows; row++, row_data++) {
+        const matrix_row_t active = row_data->active;
+        if (!active) {
+            continue;
+        }
+
+        // counter - elapsed_time for all the keys of the row, borrow ripples through the planes
+        matrix_row_t borrow  = 0;
+        matrix_row_t nonzero = 0;
+        for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++) {
+            const matrix_row_t counter = row_data->counter[bit];
+            const matrix_row_t elapsed = (elapsed_time & (1U << bit)) ? (matrix_row_t)~0 : 0;
+            const matrix_row_t diff    = counter ^ elapsed ^ borrow;
+
+            borrow = (~counter & (elapsed | borrow)) | (counter & elapsed & borrow);
+            row_data->counter[bit] = diff & active;
+            nonzero |= diff;
+        }
+
+        // counter <= elapsed_time: underflow or zero
+        const matrix_row_t done = active & (borrow | ~nonzero) & DEBOUNCE_COLS_MASK;
+        if (done) {
+            for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++) {
+                row_data->counter[bit] &= ~done;
+            }
+            row_data->active   = active & ~done;
+            matrix_need_update = true;
+
+            // raw state at the end of the window, still apart from cooked: bounced at least the window
+            const matrix_row_t unsettled = (row_data->raw ^ cooked[row]) & done;
+            for (matrix_row_t keys = done; keys; keys &= keys - 1) {
+                const uint8_t col = __builtin_ctzl(keys);
+                record_transition(row, col, (unsettled & (keys & -keys)) ? debounce_adaptive_windows[row][col] : bounce_times[row][col]);
+            }
+        }
+        if (row_data->active) {
+            counters_need_update = true;
+        }
+    }
+}
+
+// time since the start of the window of the keys changing while their counter runs
+static void record_bounces(matrix_row_t raw[], uint8_t num_rows) {
+    debounce_row_t *row_data = debounce_rows;
+    for (uint8_t row = 0; row < num_rows; row++, row_data++) {
+        for (matrix_row_t keys = (raw[row] ^ row_data->raw) & row_data->active & DEBOUNCE_COLS_MASK; keys; keys &= keys - 1) {
+            const uint8_t col      = __builtin_ctzl(keys);
+            const uint8_t window   = debounce_adaptive_windows[row][col];
+            const uint8_t counter  = counter_get(row_data, col);
+            bounce_times[row][col] = window > counter ? window - counter : 0;
+        }
+        row_data->raw = raw[row];
+    }
+}
+
+// upload from raw_matrix to final matrix;
+static void transfer_matrix_values(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows) {
+    matrix_need_update       = false;
+    debounce_row_t *row_data = debounce_rows;
+    for (uint8_t row = 0; row < num_rows; row++, row_data++) {
+        // changed keys without a running counter flip and start one with their window
+        const matrix_row_t flip = (raw[row] ^ cooked[row]) & ~row_data->active & DEBOUNCE_COLS_MASK;
+        if (!flip) {
+            continue;
+        }
+
+        for (matrix_row_t keys = flip; keys; keys &= keys - 1) {
+            const uint8_t      col    = __builtin_ctzl(keys);
+            const matrix_row_t key    = keys & -keys;
+            const uint8_t      window = debounce_adaptive_windows[row][col];
+            for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++) {
+                if (window & (1U << bit)) {
+                    row_data->counter[bit] |= key;
+                }
+            }
+            if (window) {
+                row_data->active |= key;
+            }
+            bounce_times[row][col] = 0;
+        }
+        counters_need_update = true;
+        cooked[row] ^= flip;
+        cooked_changed = true;
+    }
+}
+
+#else
+#    include "none.c"
+#endif
@@ -0,0 +1,176 @@
+/*
+Copyright 2017 Alex Ong<the.onga@gmail.com>
+Copyright 2021 Simon Arlott
+Copyright 2024 bugbuster
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+Basic per-key algorithm, same behavior as sym_eager_pk.
+After pressing a key, it immediately changes state, and sets a counter.
+No further inputs are accepted until DEBOUNCE milliseconds have occurred.
+
+The 8-bit counters are stored as bit planes (vertical counters): bit n of
+the counters of all the keys of a row is one matrix_row_t. The counters of
+a whole row are decremented together with a bitwise subtraction, the cost
+does not depend on the number of columns.
+*/
+
+#include "debounce.h"
+#include "timer.h"
+#include <stdlib.h>
+
+#ifdef PROTOCOL_CHIBIOS
+#    if CH_CFG_USE_MEMCORE == FALSE
+#        error ChibiOS is configured without a memory allocator. Your keyboard may have set `#define CH_CFG_USE_MEMCORE FALSE`, which is incompatible with this debounce algorithm.
+#    endif
+#endif
+
+#ifndef DEBOUNCE
+#    define DEBOUNCE 5
+#endif
+
+// Maximum debounce: 255ms
+#if DEBOUNCE > UINT8_MAX
+#    undef DEBOUNCE
+#    define DEBOUNCE UINT8_MAX
+#endif
+
+#define DEBOUNCE_COUNTER_BITS 8
+
+// raw rows may have bits above MATRIX_COLS set, they are not keys and never flip
+#define DEBOUNCE_COLS_MASK ((matrix_row_t)((1ULL << MATRIX_COLS) - 1))
+
+typedef struct {
+    matrix_row_t active;                         // keys with a running counter
+    matrix_row_t counter[DEBOUNCE_COUNTER_BITS]; // bit n of the counter of each key
+} debounce_row_t;
+
+#if DEBOUNCE > 0
+static debounce_row_t *debounce_rows;
+static fast_timer_t    last_time;
+static bool            counters_need_update;
+static bool            matrix_need_update;
+static bool            cooked_changed;
+
+uint8_t g_debounce = DEBOUNCE;
+
+static void update_debounce_counters(uint8_t num_rows, uint8_t elapsed_time);
+static void transfer_matrix_values(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows);
+
+// we use num_rows rather than MATRIX_ROWS to support split keyboards
+void debounce_init(uint8_t num_rows) {
+    debounce_rows = (debounce_row_t *)calloc(num_rows, sizeof(debounce_row_t));
+}
+
+void debounce_free(void) {
+    free(debounce_rows);
+    debounce_rows = NULL;
+}
+
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed) {
+    bool updated_last = false;
+    cooked_changed    = false;
+
+    if (counters_need_update) {
+        fast_timer_t now          = timer_read_fast();
+        fast_timer_t elapsed_time = TIMER_DIFF_FAST(now, last_time);
+
+        last_time    = now;
+        updated_last = true;
+        if (elapsed_time > UINT8_MAX) {
+            elapsed_time = UINT8_MAX;
+        }
+
+        if (elapsed_time > 0) {
+            update_debounce_counters(num_rows, elapsed_time);
+        }
+    }
+
+    if (changed || matrix_need_update) {
+        if (!updated_last) {
+            last_time = timer_read_fast();
+        }
+
+        transfer_matrix_values(raw, cooked, num_rows);
+    }
+
+    return cooked_changed;
+}
+
+// Subtract the elapsed time from the running counters, the ones reaching 0 enable input.
+static void update_debounce_counters(uint8_t num_rows, uint8_t elapsed_time) {
+    counters_need_update     = false;
+    matrix_need_update       = false;
+    debounce_row_t *row_data = debounce_rows;
+    for (uint8_t row = 0; row < num_rows; row++, row_data++) {
+        const matrix_row_t active = row_data->active;
+        if (!active) {
+            continue;
+        }
+
+        // counter - elapsed_time for all the keys of the row, borrow ripples through the planes
+        matrix_row_t borrow  = 0;
+        matrix_row_t nonzero = 0;
+        for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++) {
+            const matrix_row_t counter = row_data->counter[bit];
+            const matrix_row_t elapsed = (elapsed_time & (1U << bit)) ? (matrix_row_t)~0 : 0;
+            const matrix_row_t diff    = counter ^ elapsed ^ borrow;
+
+            borrow = (~counter & (elapsed | borrow)) | (counter & elapsed & borrow);
+            row_data->counter[bit] = diff & active;
+            nonzero |= diff;
+        }
+
+        // counter <= elapsed_time: underflow or zero
+        const matrix_row_t done = active & (borrow | ~nonzero);
+        if (done) {
+            for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++) {
+                row_data->counter[bit] &= ~done;
+            }
+            row_data->active   = active & ~done;
+            matrix_need_update = true;
+        }
+        if (row_data->active) {
+            counters_need_update = true;
+        }
+    }
+}
+
+// upload from raw_matrix to final matrix;
+static void transfer_matrix_values(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows) {
+    matrix_need_update       = false;
+    debounce_row_t *row_data = debounce_rows;
+    for (uint8_t row = 0; row < num_rows; row++, row_data++) {
+        // changed keys without a running counter flip and start one
+        const matrix_row_t flip = (raw[row] ^ cooked[row]) & ~row_data->active & DEBOUNCE_COLS_MASK;
+        if (!flip) {
+            continue;
+        }
+
+        for (uint8_t bit = 0; bit < DEBOUNCE_COUNTER_BITS; bit++) {
+            if (g_debounce & (1U << bit)) {
+                row_data->counter[bit] |= flip;
+            }
+        }
+        if (g_debounce) {
+            row_data->active |= flip;
+        }
+        counters_need_update = true;
+        cooked[row] ^= flip;
+        cooked_changed = true;
+    }
+}
+
+#else
+#    include "none.c"
+#endif
@@ -0,0 +1,101 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#    include <x86intrin.h>
+#endif
+
+extern "C" {
+#include "debounce.h"
+#include "timer.h"
+
+void set_time(uint32_t t);
+void advance_time(uint32_t ms);
+}
+
+// cost of a debounce() call for the algorithm of the test target, printed, not asserted.
+// cycles from the time stamp counter on x86 hosts, nanoseconds elsewhere.
+
+static uint64_t bench_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+template <typename F>
+static double bench_scans(int scans, F input) {
+    matrix_row_t raw[MATRIX_ROWS]    = {0};
+    matrix_row_t cooked[MATRIX_ROWS] = {0};
+    uint64_t     total               = 0;
+
+    debounce_init(MATRIX_ROWS);
+    set_time(7777);
+    for (int n = 0; n < scans; n++) {
+        bool changed = input(n, raw);
+
+        uint64_t start = bench_clock();
+        debounce(raw, cooked, MATRIX_ROWS, changed);
+        total += bench_clock() - start;
+
+        advance_time(1);
+    }
+    debounce_free();
+    return (double)total / scans;
+}
+
+TEST(DebounceBenchmark, Scan) {
+    const int    scans = 100000;
+    matrix_row_t chatter[256][MATRIX_ROWS];
+
+    srand(24);
+    for (auto &matrix : chatter) {
+        for (auto &row : matrix) {
+            row = (matrix_row_t)rand() & (matrix_row_t)((1ULL << MATRIX_COLS) - 1);
+        }
+    }
+
+    double idle = bench_scans(scans, [](int n, matrix_row_t raw[]) { return false; });
+    // one key changing every 10 ms, its counter running half of the time
+    double typing = bench_scans(scans, [](int n, matrix_row_t raw[]) {
+        if (n % 10) return false;
+        raw[(n / 10) % MATRIX_ROWS] ^= (matrix_row_t)1 << ((n / 40) % MATRIX_COLS);
+        return true;
+    });
+    // every key changing at random on every scan, all counters running
+    double noise = bench_scans(scans, [&](int n, matrix_row_t raw[]) {
+        memcpy(raw, chatter[n % 256], sizeof(chatter[0]));
+        return true;
+    });
+
+#if defined(__x86_64__) || defined(__i386__)
+    const char *unit = "cycles";
+#else
+    const char *unit = "ns";
+#endif
+    printf("debounce() %d x %d matrix, DEBOUNCE %d, %s/scan\n", MATRIX_ROWS, MATRIX_COLS, DEBOUNCE, unit);
+    printf("%-16s %10.1f\n", "idle", idle);
+    printf("%-16s %10.1f\n", "typing", typing);
+    printf("%-16s %10.1f\n", "all keys noise", noise);
+}
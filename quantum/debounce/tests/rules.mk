@@ -43,6 +43,35 @@ debounce_sym_eager_pk_SRC := $(DEBOUNCE_COMMON_SRC) \
 	$(QUANTUM_PATH)/debounce/sym_eager_pk.c \
 	$(QUANTUM_PATH)/debounce/tests/sym_eager_pk_tests.cpp
 
+debounce_sym_eager_pk_bitsliced_DEFS := $(DEBOUNCE_COMMON_DEFS)
+debounce_sym_eager_pk_bitsliced_SRC := $(DEBOUNCE_COMMON_SRC) \
+	$(QUANTUM_PATH)/debounce/sym_eager_pk_bitsliced.c \
+	$(QUANTUM_PATH)/debounce/tests/sym_eager_pk_tests.cpp \
+	$(QUANTUM_PATH)/debounce/tests/sym_eager_pk_bitsliced_tests.cpp \
+	$(QUANTUM_PATH)/debounce/tests/sym_eager_pk_reference.c
+
+debounce_sym_eager_pk_adaptive_DEFS := $(DEBOUNCE_COMMON_DEFS)
+debounce_sym_eager_pk_adaptive_SRC := $(DEBOUNCE_COMMON_SRC) \
+	$(QUANTUM_PATH)/debounce/sym_eager_pk_adaptive.c \
+	$(QUANTUM_PATH)/debounce/tests/sym_eager_pk_tests.cpp \
+	$(QUANTUM_PATH)/debounce/tests/sym_eager_pk_adaptive_tests.cpp
+
+# debounce() cost per algorithm, only listed with DEBOUNCE_BENCHMARK = yes
+debounce_benchmark_sym_eager_pk_DEFS := $(DEBOUNCE_COMMON_DEFS)
+debounce_benchmark_sym_eager_pk_SRC := $(DEBOUNCE_COMMON_SRC) \
+	$(QUANTUM_PATH)/debounce/sym_eager_pk.c \
+	$(QUANTUM_PATH)/debounce/tests/debounce_benchmark_tests.cpp
+
+debounce_benchmark_sym_eager_pk_bitsliced_DEFS := $(DEBOUNCE_COMMON_DEFS)
+debounce_benchmark_sym_eager_pk_bitsliced_SRC := $(DEBOUNCE_COMMON_SRC) \
+	$(QUANTUM_PATH)/debounce/sym_eager_pk_bitsliced.c \
+	$(QUANTUM_PATH)/debounce/tests/debounce_benchmark_tests.cpp
+
+debounce_benchmark_sym_eager_pk_adaptive_DEFS := $(DEBOUNCE_COMMON_DEFS)
+debounce_benchmark_sym_eager_pk_adaptive_SRC := $(DEBOUNCE_COMMON_SRC) \
+	$(QUANTUM_PATH)/debounce/sym_eager_pk_adaptive.c \
+	$(QUANTUM_PATH)/debounce/tests/debounce_benchmark_tests.cpp
+
 debounce_sym_eager_pr_DEFS := $(DEBOUNCE_COMMON_DEFS)
 debounce_sym_eager_pr_SRC := $(DEBOUNCE_COMMON_SRC) \
 	$(QUANTUM_PATH)/debounce/sym_eager_pr.c \
@@ -0,0 +1,231 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include <utility>
+#include <vector>
+
+#include "debounce_test_common.h"
+
+extern "C" {
+#include "debounce.h"
+#include "debounce_adaptive.h"
+
+void set_time(uint32_t t);
+void advance_time(uint32_t ms);
+
+extern uint8_t g_debounce;
+}
+
+/* sym_eager_pk_tests.cpp runs on this algorithm too, with fewer transitions per key than needed to adapt */
+
+class DebounceAdaptiveTest : public DebounceTest {
+   protected:
+    void TearDown() override {
+        g_debounce          = DEBOUNCE;
+        g_debounce_adaptive = {DEBOUNCE_ADAPTIVE_MIN, DEBOUNCE_ADAPTIVE_MAX, DEBOUNCE_ADAPTIVE_MARGIN, 1};
+    }
+
+    // key (0, 1) follows the raw changes (ms into the cycle, pressed) every cycle, returns the cooked changes
+    // the debounce state carries over from one call to the next
+    int runCycles(int cycles, int period, std::vector<std::pair<int, bool>> changes) {
+        int cooked_changes = 0;
+
+        if (!started_) {
+            debounce_init(MATRIX_ROWS);
+            set_time(7777);
+            started_ = true;
+        }
+        for (int n = 0; n < cycles * period; n++) {
+            bool changed = false;
+            for (auto &change : changes) {
+                if (n % period == change.first) {
+                    raw_[0] = change.second ? 2 : 0;
+                    changed = true;
+                }
+            }
+            matrix_row_t previous = cooked_[0];
+            debounce(raw_, cooked_, MATRIX_ROWS, changed);
+            if (cooked_[0] != previous) cooked_changes++;
+            advance_time(1);
+        }
+        return cooked_changes;
+    }
+
+    // transitions of the key over all its buckets
+    int samples(void) {
+        int total = 0;
+        for (auto count : debounce_adaptive_histograms[0][1]) total += count;
+        return total;
+    }
+
+    bool         started_             = false;
+    matrix_row_t raw_[MATRIX_ROWS]    = {0};
+    matrix_row_t cooked_[MATRIX_ROWS] = {0};
+};
+
+TEST_F(DebounceAdaptiveTest, CleanKeyWindowShrinks) {
+    // 2 clean transitions per cycle, DEBOUNCE_ADAPTIVE_MIN_SAMPLES then 1 ms per transition
+    addEvents({
+        /* Time, Inputs, Outputs */
+        {0, {{0, 1, DOWN}}, {{0, 1, DOWN}}},
+    });
+    for (fast_timer_t time = 10; time < 400; time += 10) {
+        addEvents({{time, {{0, 1, (time / 10) % 2 ? UP : DOWN}}, {{0, 1, (time / 10) % 2 ? UP : DOWN}}}});
+    }
+    addEvents({
+        /* Time, Inputs, Outputs */
+        // window of 1 ms p99 plus margin, DEBOUNCE on the other keys
+        {400, {{0, 1, DOWN}}, {{0, 1, DOWN}}},
+        {403, {{0, 1, UP}}, {{0, 1, UP}}},
+        {420, {{0, 2, DOWN}}, {{0, 2, DOWN}}},
+        {423, {{0, 2, UP}}, {}},
+        {425, {}, {{0, 2, UP}}},
+    });
+    runEvents();
+
+    EXPECT_EQ(debounce_adaptive_windows[0][1], 2);
+    EXPECT_EQ(debounce_adaptive_windows[0][2], DEBOUNCE);
+}
+
+TEST_F(DebounceAdaptiveTest, BouncyKeyWindowGrows) {
+    g_debounce              = 2;
+    g_debounce_adaptive.max = 20;
+
+    // press bouncing until 3 ms, clean release
+    std::vector<std::pair<int, bool>> bouncy = {{0, true}, {1, false}, {3, true}, {10, false}};
+
+    // chatter while the window is shorter than the bounces
+    EXPECT_GT(runCycles(10, 20, bouncy), 10 * 2);
+
+    runCycles(200, 20, bouncy);
+    // 3 ms bounce: [3, 4) bucket, edge plus margin
+    EXPECT_EQ(debounce_adaptive_windows[0][1], 5);
+    EXPECT_EQ(debounce_adaptive_windows[0][2], 2);
+    EXPECT_EQ(runCycles(10, 20, bouncy), 10 * 2);
+}
+
+TEST_F(DebounceAdaptiveTest, WindowBounds) {
+    std::vector<std::pair<int, bool>> clean  = {{0, true}, {10, false}};
+    std::vector<std::pair<int, bool>> bouncy = {{0, true}, {1, false}, {9, true}, {15, false}};
+
+    g_debounce_adaptive.min = 4;
+    runCycles(100, 20, clean);
+    EXPECT_EQ(debounce_adaptive_windows[0][1], 4);
+
+    g_debounce_adaptive.max = 6;
+    runCycles(100, 30, bouncy);
+    EXPECT_EQ(debounce_adaptive_windows[0][1], 6);
+}
+
+TEST_F(DebounceAdaptiveTest, LearningDisabled) {
+    std::vector<std::pair<int, bool>> clean = {{0, true}, {10, false}};
+
+    g_debounce_adaptive.learn = 0;
+    runCycles(100, 20, clean);
+    EXPECT_EQ(debounce_adaptive_windows[0][1], DEBOUNCE);
+    EXPECT_EQ(samples(), 0);
+}
+
+TEST_F(DebounceAdaptiveTest, WindowWrittenByHost) {
+    matrix_row_t raw[MATRIX_ROWS]    = {2};
+    matrix_row_t cooked[MATRIX_ROWS] = {0};
+
+    // a window of 12 ms holds a release 10 ms after the press
+    debounce_init(MATRIX_ROWS);
+    debounce_adaptive_windows[0][1] = 12;
+    set_time(100);
+    debounce(raw, cooked, MATRIX_ROWS, true);
+    EXPECT_EQ(cooked[0], 2);
+    for (int n = 1; n < 12; n++) {
+        advance_time(1);
+        if (n == 10) raw[0] = 0;
+        debounce(raw, cooked, MATRIX_ROWS, n == 10);
+        EXPECT_EQ(cooked[0], 2) << n << " ms";
+    }
+    advance_time(1);
+    debounce(raw, cooked, MATRIX_ROWS, false);
+    EXPECT_EQ(cooked[0], 0);
+}
+
+TEST_F(DebounceAdaptiveTest, WindowsClampedToBounds) {
+    debounce_init(MATRIX_ROWS);
+    debounce_adaptive_windows[0][1] = 200;
+    debounce_adaptive_windows[1][2] = 0;
+    g_debounce_adaptive.min         = 3;
+    g_debounce_adaptive.max         = 8;
+    debounce_adaptive_clamp_windows();
+    EXPECT_EQ(debounce_adaptive_windows[0][1], 8);
+    EXPECT_EQ(debounce_adaptive_windows[1][2], 3);
+    EXPECT_EQ(debounce_adaptive_windows[2][3], DEBOUNCE);
+    EXPECT_EQ(debounce_adaptive_clamp(1), 3);
+}
+
+TEST_F(DebounceAdaptiveTest, HistogramHalvedWhenFull) {
+    std::vector<std::pair<int, bool>> clean = {{0, true}, {10, false}};
+
+    runCycles(200, 20, clean);
+    // 400 transitions in bucket 0, halved before the 256th and the 384th
+    EXPECT_EQ(debounce_adaptive_histograms[0][1][0], 127 + 400 - 383);
+    EXPECT_EQ(samples(), 127 + 400 - 383);
+}
+
+TEST_F(DebounceAdaptiveTest, FullWindowInLastBucket) {
+    matrix_row_t raw[MATRIX_ROWS]    = {2};
+    matrix_row_t cooked[MATRIX_ROWS] = {0};
+
+    // a release 10 ms into a 255 ms window, still apart from cooked when the window ends
+    debounce_init(MATRIX_ROWS);
+    g_debounce_adaptive.max         = 255;
+    debounce_adaptive_windows[0][1] = 255;
+    set_time(100);
+    debounce(raw, cooked, MATRIX_ROWS, true);
+    for (int n = 1; n <= 255; n++) {
+        advance_time(1);
+        if (n == 10) raw[0] = 0;
+        debounce(raw, cooked, MATRIX_ROWS, n == 10);
+    }
+    EXPECT_EQ(cooked[0], 0);
+    EXPECT_EQ(debounce_adaptive_histograms[0][1][DEBOUNCE_ADAPTIVE_BUCKETS - 1], 1);
+    EXPECT_EQ(samples(), 1);
+    for (auto count : debounce_adaptive_histograms[0][2]) {
+        EXPECT_EQ(count, 0);
+    }
+}
+
+TEST_F(DebounceAdaptiveTest, BitsAboveMatrixColsIgnored) {
+    const matrix_row_t cols_mask           = (matrix_row_t)((1ULL << MATRIX_COLS) - 1);
+    matrix_row_t       raw[MATRIX_ROWS]    = {0};
+    matrix_row_t       cooked[MATRIX_ROWS] = {0};
+
+    // phantom columns toggling on every scan next to key (0, 1)
+    debounce_init(MATRIX_ROWS);
+    set_time(100);
+    for (int n = 0; n < 200; n++) {
+        for (auto &row : raw) {
+            row = (n % 2 ? ~cols_mask : 0) | (n % 20 < 10 ? 2 : 0);
+        }
+        debounce(raw, cooked, MATRIX_ROWS, true);
+        for (int row = 0; row < MATRIX_ROWS; row++) {
+            ASSERT_EQ(cooked[row] & ~cols_mask, 0) << n << " ms";
+        }
+        advance_time(1);
+    }
+    EXPECT_EQ(cooked[0], 0);
+    EXPECT_EQ(debounce_adaptive_windows[0][1], DEBOUNCE);
+    EXPECT_EQ(debounce_adaptive_windows[MATRIX_ROWS - 1][MATRIX_COLS - 1], DEBOUNCE);
+}
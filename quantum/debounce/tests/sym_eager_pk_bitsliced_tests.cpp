@@ -0,0 +1,137 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+
+#include "debounce_test_common.h"
+
+extern "C" {
+#include "debounce.h"
+
+void advance_time(uint32_t ms);
+
+extern uint8_t g_debounce;
+
+// sym_eager_pk_reference.c
+bool sym_eager_pk_debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed);
+void sym_eager_pk_debounce_init(uint8_t num_rows);
+void sym_eager_pk_debounce_free(void);
+}
+
+/* sym_eager_pk_tests.cpp runs on this algorithm too, these cover the bit planes */
+
+class DebounceBitslicedTest : public DebounceTest {
+   protected:
+    void TearDown() override {
+        g_debounce = DEBOUNCE;
+    }
+};
+
+TEST_F(DebounceBitslicedTest, LongDebounce) {
+    g_debounce = 200;
+    addEvents({
+        /* Time, Inputs, Outputs */
+        {0, {{0, 1, DOWN}}, {{0, 1, DOWN}}},
+        {1, {{0, 1, UP}}, {}},
+
+        {200, {}, {{0, 1, UP}}},
+    });
+    runEvents();
+}
+
+TEST_F(DebounceBitslicedTest, MaxDebounceTimeJumps) {
+    g_debounce = 255;
+    addEvents({
+        /* Time, Inputs, Outputs */
+        {0, {{0, 1, DOWN}}, {{0, 1, DOWN}}},
+        {100, {{0, 1, UP}}, {}},
+        {254, {}, {}},
+
+        {255, {}, {{0, 1, UP}}},
+    });
+    time_jumps_ = true;
+    runEvents();
+}
+
+TEST_F(DebounceBitslicedTest, ZeroDebounce) {
+    g_debounce = 0;
+    addEvents({
+        /* Time, Inputs, Outputs */
+        {0, {{0, 1, DOWN}}, {{0, 1, DOWN}}},
+        {1, {{0, 1, UP}}, {{0, 1, UP}}},
+        {2, {{0, 1, DOWN}}, {{0, 1, DOWN}}},
+        {3, {{0, 1, UP}}, {{0, 1, UP}}},
+    });
+    runEvents();
+}
+
+TEST_F(DebounceBitslicedTest, KeysOfOneRowIndependent) {
+    addEvents({
+        /* Time, Inputs, Outputs */
+        {0, {{0, 0, DOWN}, {0, 9, DOWN}}, {{0, 0, DOWN}, {0, 9, DOWN}}},
+        {3, {{0, 1, DOWN}}, {{0, 1, DOWN}}},
+        {4, {{0, 0, UP}, {0, 1, UP}}, {}},
+
+        {5, {}, {{0, 0, UP}}},
+        {8, {}, {{0, 1, UP}}},
+        {20, {{0, 9, UP}}, {{0, 9, UP}}},
+    });
+    runEvents();
+}
+
+TEST_F(DebounceBitslicedTest, AllKeys) {
+    addEvents({
+        /* Time, Inputs, Outputs */
+        {0, {{0, 0, DOWN}, {0, 1, DOWN}, {0, 2, DOWN}, {0, 3, DOWN}, {0, 4, DOWN}, {0, 5, DOWN}, {0, 6, DOWN}, {0, 7, DOWN}, {0, 8, DOWN}, {0, 9, DOWN}, {3, 0, DOWN}, {3, 9, DOWN}},
+         {{0, 0, DOWN}, {0, 1, DOWN}, {0, 2, DOWN}, {0, 3, DOWN}, {0, 4, DOWN}, {0, 5, DOWN}, {0, 6, DOWN}, {0, 7, DOWN}, {0, 8, DOWN}, {0, 9, DOWN}, {3, 0, DOWN}, {3, 9, DOWN}}},
+        {1, {{0, 0, UP}, {0, 1, UP}, {0, 2, UP}, {0, 3, UP}, {0, 4, UP}, {0, 5, UP}, {0, 6, UP}, {0, 7, UP}, {0, 8, UP}, {0, 9, UP}, {3, 0, UP}, {3, 9, UP}}, {}},
+
+        {5, {}, {{0, 0, UP}, {0, 1, UP}, {0, 2, UP}, {0, 3, UP}, {0, 4, UP}, {0, 5, UP}, {0, 6, UP}, {0, 7, UP}, {0, 8, UP}, {0, 9, UP}, {3, 0, UP}, {3, 9, UP}}},
+    });
+    runEvents();
+}
+
+TEST_F(DebounceBitslicedTest, MatchesSymEagerPkOnFullWidthRows) {
+    const matrix_row_t cols_mask              = (matrix_row_t)((1ULL << MATRIX_COLS) - 1);
+    matrix_row_t       raw[MATRIX_ROWS]       = {0};
+    matrix_row_t       cooked[MATRIX_ROWS]    = {0};
+    matrix_row_t       reference[MATRIX_ROWS] = {0};
+
+    // random rows with the bits above MATRIX_COLS set too, changing on a third of the scans
+    debounce_init(MATRIX_ROWS);
+    sym_eager_pk_debounce_init(MATRIX_ROWS);
+    srand(24);
+    for (int n = 0; n < 20000; n++) {
+        bool changed = rand() % 3 == 0;
+        if (changed) {
+            for (auto &row : raw) {
+                row = (matrix_row_t)rand() ^ ((matrix_row_t)rand() << 16);
+            }
+        }
+        bool cooked_changed    = debounce(raw, cooked, MATRIX_ROWS, changed);
+        bool reference_changed = sym_eager_pk_debounce(raw, reference, MATRIX_ROWS, changed);
+        ASSERT_EQ(cooked_changed, reference_changed) << "scan " << n;
+        for (int row = 0; row < MATRIX_ROWS; row++) {
+            ASSERT_EQ(cooked[row], reference[row]) << "scan " << n << " row " << row;
+            ASSERT_EQ(cooked[row] & ~cols_mask, 0) << "scan " << n << " row " << row;
+        }
+        advance_time(1 + rand() % 3);
+    }
+    sym_eager_pk_debounce_free();
+    debounce_free();
+}
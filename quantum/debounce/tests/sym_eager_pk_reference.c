@@ -0,0 +1,24 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* sym_eager_pk with renamed symbols, linked next to another algorithm to compare them */
+
+#define debounce sym_eager_pk_debounce
+#define debounce_init sym_eager_pk_debounce_init
+#define debounce_free sym_eager_pk_debounce_free
+#define g_debounce sym_eager_pk_g_debounce
+
+#include "../sym_eager_pk.c"
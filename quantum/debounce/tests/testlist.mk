@@ -4,5 +4,14 @@ TEST_LIST += \
 	debounce_sym_defer_pk \
 	debounce_sym_defer_pr \
 	debounce_sym_eager_pk \
+	debounce_sym_eager_pk_bitsliced \
+	debounce_sym_eager_pk_adaptive \
 	debounce_sym_eager_pr \
 	debounce_asym_eager_defer_pk
+
+ifeq ($(strip $(DEBOUNCE_BENCHMARK)), yes)
+TEST_LIST += \
+	debounce_benchmark_sym_eager_pk \
+	debounce_benchmark_sym_eager_pk_bitsliced \
+	debounce_benchmark_sym_eager_pk_adaptive
+endif
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include "matrix.h"
+
+/* Per key debounce windows of DEBOUNCE_TYPE = sym_eager_pk_adaptive.
+ *
+ * The bounce time of each transition is recorded in a per key histogram,
+ * every window moves 1 ms per transition toward the p99 bounce time of its
+ * key plus a margin, within min and max.
+ */
+
+#ifndef DEBOUNCE_ADAPTIVE_MIN
+#    define DEBOUNCE_ADAPTIVE_MIN 2
+#endif
+
+#ifndef DEBOUNCE_ADAPTIVE_MAX
+#    define DEBOUNCE_ADAPTIVE_MAX DEBOUNCE
+#endif
+
+#ifndef DEBOUNCE_ADAPTIVE_MARGIN
+#    define DEBOUNCE_ADAPTIVE_MARGIN 1
+#endif
+
+// transitions recorded before a window is adapted
+#ifndef DEBOUNCE_ADAPTIVE_MIN_SAMPLES
+#    define DEBOUNCE_ADAPTIVE_MIN_SAMPLES 32
+#endif
+
+#define DEBOUNCE_ADAPTIVE_BUCKETS 8
+
+typedef struct {
+    uint8_t min;    // window bounds, ms, min <= max
+    uint8_t max;
+    uint8_t margin; // ms added to the p99 bounce time
+    uint8_t learn;  // 0: windows are not adapted
+} debounce_adaptive_config_t;
+
+extern debounce_adaptive_config_t g_debounce_adaptive;
+
+// ms, loaded when a key changes state, can be written at any time
+extern uint8_t debounce_adaptive_windows[MATRIX_ROWS][MATRIX_COLS];
+
+// transitions per bounce time bucket, halved when one bucket is full
+extern uint8_t debounce_adaptive_histograms[MATRIX_ROWS][MATRIX_COLS][DEBOUNCE_ADAPTIVE_BUCKETS];
+
+/**
+ * @brief Forget the histograms, windows back to g_debounce within the bounds.
+ */
+void debounce_adaptive_reset(void);
+
+/**
+ * @brief The window within the bounds of g_debounce_adaptive.
+ */
+uint8_t debounce_adaptive_clamp(uint8_t window);
+
+/**
+ * @brief All the windows back within the bounds, after the bounds or the windows were written.
+ */
+void debounce_adaptive_clamp_windows(void);
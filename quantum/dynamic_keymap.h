@@ -27,6 +27,16 @@ uint16_t dynamic_keymap_get_encoder(uint8_t layer, uint8_t encoder_id, bool cloc
 void     dynamic_keymap_set_encoder(uint8_t layer, uint8_t encoder_id, bool clockwise, uint16_t keycode);
 #endif // ENCODER_MAP_ENABLE
 void dynamic_keymap_reset(void);
+#ifdef DYNAMIC_KEYMAP_RAM_CACHE
+// RAM copy of the keymaps, native byte order, loaded on first use and written
+// through by the set functions. Read only, change keycodes with the set functions.
+extern uint16_t dynamic_keymap_cache[][MATRIX_ROWS][MATRIX_COLS];
+void            dynamic_keymap_cache_load(void);
+// Reload the RAM copy on next use, after the EEPROM was changed behind dynamic_keymap
+void dynamic_keymap_cache_invalidate(void);
+// Load the RAM copy if not valid, call before reading dynamic_keymap_cache directly
+void dynamic_keymap_cache_check(void);
+#endif // DYNAMIC_KEYMAP_RAM_CACHE
 // These get/set the keycodes as stored in the EEPROM buffer
 // Data is big-endian 16-bit values (the keycodes)
 // Order is by layer/row/column
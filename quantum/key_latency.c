@@ -0,0 +1,153 @@
+// Copyright 2024 bugbuster
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <string.h>
+#include "key_latency.h"
+#include "timer.h"
+#include "util.h"
+
+#ifndef KEY_LATENCY_PENDING_MAX
+#    define KEY_LATENCY_PENDING_MAX 8
+#endif
+
+#ifndef KEY_LATENCY_REPORT_TIMEOUT
+#    define KEY_LATENCY_REPORT_TIMEOUT 100 // ms, processed transitions older than this are dropped at report time
+#endif
+
+typedef struct {
+    keypos_t key;
+    bool     pressed;
+    uint32_t raw;
+    uint32_t event;
+    uint32_t process;
+} key_latency_pending_t;
+
+static uint32_t              raw_stamp[MATRIX_ROWS][MATRIX_COLS];
+static matrix_row_t          raw_stamped[MATRIX_ROWS]; // raw transition seen, waiting for its key event
+static key_latency_pending_t inflight[KEY_LATENCY_PENDING_MAX]; // key events not processed yet, tapping, combos, ...
+static uint8_t               inflight_count = 0;
+static key_latency_pending_t pending[KEY_LATENCY_PENDING_MAX]; // processed, waiting for a report
+static uint8_t               pending_count = 0;
+static key_latency_stats_t   stats         = {0};
+
+// append to a queue, the oldest entry is dropped when full
+static key_latency_pending_t *queue_push(key_latency_pending_t *queue, uint8_t *count) {
+    if (*count == KEY_LATENCY_PENDING_MAX) {
+        memmove(&queue[0], &queue[1], sizeof(queue[0]) * (KEY_LATENCY_PENDING_MAX - 1));
+        (*count)--;
+        stats.dropped++;
+    }
+    return &queue[(*count)++];
+}
+
+__attribute__((weak)) uint32_t key_latency_timestamp(void) {
+    return timer_read32();
+}
+
+__attribute__((weak)) uint32_t key_latency_timestamp_freq(void) {
+    return 1000;
+}
+
+__attribute__((weak)) void key_latency_sample_user(const key_latency_sample_t *sample) {}
+
+__attribute__((weak)) void key_latency_sample_kb(const key_latency_sample_t *sample) {
+    key_latency_sample_user(sample);
+}
+
+void key_latency_matrix_changed(uint8_t row, matrix_row_t changes, matrix_row_t current) {
+    if (row >= MATRIX_ROWS || !changes) return;
+    uint32_t now = key_latency_timestamp();
+    // raw keys differing from the debounced state have a key event to come
+    matrix_row_t differs = current ^ matrix_get_row(row);
+    // a bounce settled back to the debounced state drops its stamp,
+    // while the key bounces the first transition is kept, debounce time starts there
+    raw_stamped[row] &= differs;
+    changes &= differs & ~raw_stamped[row];
+    raw_stamped[row] |= changes;
+    for (uint8_t col = 0; col < MATRIX_COLS && changes; col++, changes >>= 1) {
+        if (changes & 1) raw_stamp[row][col] = now;
+    }
+}
+
+void key_latency_matrix_scan(uint8_t row_offset, const matrix_row_t previous[], const matrix_row_t current[], uint8_t rows) {
+    for (uint8_t row = 0; row < rows; row++) {
+        key_latency_matrix_changed(row + row_offset, previous[row] ^ current[row], current[row]);
+    }
+}
+
+void key_latency_event(keypos_t key, bool pressed) {
+    if (key.row >= MATRIX_ROWS || key.col >= MATRIX_COLS) return;
+    uint32_t     now  = key_latency_timestamp();
+    matrix_row_t mask = (matrix_row_t)1 << key.col;
+    // matrix without raw stamps
+    if (!(raw_stamped[key.row] & mask)) raw_stamp[key.row][key.col] = now;
+    raw_stamped[key.row] &= ~mask;
+
+    // the release of a key can come before its press is processed (tap hold), queued per event
+    key_latency_pending_t *p = queue_push(inflight, &inflight_count);
+    p->key                   = key;
+    p->pressed               = pressed;
+    p->raw                   = raw_stamp[key.row][key.col];
+    p->event                 = now;
+}
+
+void key_latency_process(keyevent_t *event) {
+    if (!IS_KEYEVENT(*event)) return;
+    keypos_t key = event->key;
+    if (key.row >= MATRIX_ROWS || key.col >= MATRIX_COLS) return;
+
+    uint32_t               now = key_latency_timestamp();
+    key_latency_pending_t *p   = queue_push(pending, &pending_count);
+    p->key                     = key;
+    p->pressed                 = event->pressed;
+    p->raw                     = now;
+    p->event                   = now;
+    p->process                 = now;
+    for (uint8_t i = 0; i < inflight_count; i++) {
+        if (KEYEQ(inflight[i].key, key) && inflight[i].pressed == event->pressed) {
+            p->raw   = inflight[i].raw;
+            p->event = inflight[i].event;
+            memmove(&inflight[i], &inflight[i + 1], sizeof(inflight[0]) * (inflight_count - i - 1));
+            inflight_count--;
+            break;
+        }
+    }
+}
+
+void key_latency_report_sent(void) {
+    if (!pending_count) return;
+
+    uint32_t now     = key_latency_timestamp();
+    uint32_t timeout = (uint64_t)KEY_LATENCY_REPORT_TIMEOUT * key_latency_timestamp_freq() / 1000;
+    for (uint8_t i = 0; i < pending_count; i++) {
+        key_latency_pending_t *p = &pending[i];
+        // transitions that changed nothing in the report (layer keys, ...) are closed by an unrelated report
+        if (now - p->process > timeout) {
+            stats.dropped++;
+            continue;
+        }
+        key_latency_sample_t sample = {
+            .key      = p->key,
+            .pressed  = p->pressed,
+            .debounce = p->event - p->raw,
+            .hold     = p->process - p->event,
+            .report   = now - p->process,
+            .total    = now - p->raw,
+        };
+        stats.count++;
+        stats.max_total = MAX(stats.max_total, sample.total);
+        stats.last      = sample;
+        key_latency_sample_kb(&sample);
+    }
+    pending_count = 0;
+}
+
+const key_latency_stats_t *key_latency_get_stats(void) {
+    return &stats;
+}
+
+void key_latency_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+    inflight_count = 0;
+    pending_count  = 0;
+}
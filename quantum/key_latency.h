@@ -0,0 +1,89 @@
+// Copyright 2024 bugbuster
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+/**
+ * \file
+ *
+ * \defgroup key_latency Key Latency
+ *
+ * \brief Measures the time from a raw matrix transition to the HID report carrying it.
+ *
+ * Each transition is stamped when the matrix scan first sees it, when the debounced key event
+ * is generated, when process_record handles it (after tapping and combo delays) and when the next
+ * report leaves through the usb or wireless transport. The stage times of each key are passed to
+ * key_latency_sample_kb().
+ *
+ * Timestamps come from key_latency_timestamp(), milliseconds unless the keyboard provides a finer clock.
+ *
+ * \{
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "keyboard.h"
+#include "matrix.h"
+
+/** \brief Stage times of one key transition, in key_latency_timestamp() ticks
+ */
+typedef struct key_latency_sample_t {
+    keypos_t key;
+    bool     pressed;
+    uint32_t debounce; // raw transition to debounced key event
+    uint32_t hold;     // key event to process_record, tapping term, combo term, ...
+    uint32_t report;   // process_record to report sent
+    uint32_t total;    // raw transition to report sent
+} key_latency_sample_t;
+
+/** \brief Summary of the samples since the last reset
+ */
+typedef struct key_latency_stats_t {
+    uint32_t             count;
+    uint32_t             dropped; // processed transitions without report in time
+    uint32_t             max_total;
+    key_latency_sample_t last;
+} key_latency_stats_t;
+
+/** \brief Stamp raw transitions of a matrix row, called by the matrix scan before debouncing
+ *
+ * \param changes raw bits changed since the previous scan
+ * \param current raw row after the scan
+ */
+void key_latency_matrix_changed(uint8_t row, matrix_row_t changes, matrix_row_t current);
+
+/** \brief Stamp raw transitions of a scan, rows are offset by row_offset (split keyboards)
+ */
+void key_latency_matrix_scan(uint8_t row_offset, const matrix_row_t previous[], const matrix_row_t current[], uint8_t rows);
+
+/** \brief Stamp the debounced key event, called when the key event is generated
+ *
+ * The stamps are queued per event until process_record, the release of a key can be
+ * generated before its press is processed (tap hold, combos).
+ */
+void key_latency_event(keypos_t key, bool pressed);
+
+/** \brief Stamp the start of processing, called from process_record
+ */
+void key_latency_process(keyevent_t *event);
+
+/** \brief Closes all processed transitions, called when a keyboard report left through a transport
+ */
+void key_latency_report_sent(void);
+
+const key_latency_stats_t *key_latency_get_stats(void);
+void                       key_latency_reset_stats(void);
+
+/** \brief Clock of the stamps, weak, defaults to timer_read32()
+ */
+uint32_t key_latency_timestamp(void);
+/** \brief Ticks per second of key_latency_timestamp(), weak, defaults to 1000
+ */
+uint32_t key_latency_timestamp_freq(void);
+
+/** \brief Called for each completed sample
+ */
+void key_latency_sample_kb(const key_latency_sample_t *sample);
+void key_latency_sample_user(const key_latency_sample_t *sample);
+
+/** \} */
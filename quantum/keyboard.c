@@ -19,7 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "keyboard.h"
 #include "keycode_config.h"
 #include "matrix.h"
-#include "keymap_introspection.h"
+#include "keymap_common.h"
 #include "magic.h"
 #include "host.h"
 #include "led.h"
@@ -33,6 +33,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "sendchar.h"
 #include "eeconfig.h"
 #include "action_layer.h"
+#include "trace_point.h"
 #ifdef AUDIO_ENABLE
 #    include "audio.h"
 #endif
@@ -81,6 +82,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifdef SECURE_ENABLE
 #    include "secure.h"
 #endif
+#ifdef KEY_LATENCY_ENABLE
+#    include "key_latency.h"
+#endif
 #ifdef POINTING_DEVICE_ENABLE
 #    include "pointing_device.h"
 #endif
@@ -102,6 +106,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifdef VIA_ENABLE
 #    include "via.h"
 #endif
+#if defined(DYNAMIC_KEYMAP_ENABLE) && defined(DYNAMIC_KEYMAP_RAM_CACHE)
+#    include "dynamic_keymap.h"
+#endif
 #ifdef DIP_SWITCH_ENABLE
 #    include "dip_switch.h"
 #endif
@@ -211,17 +218,36 @@ uint32_t get_matrix_scan_rate(void) {
 #    define matrix_scan_perf_task()
 #endif
 
+#if (MATRIX_COLS <= 16)
+#    define matrix_row_ctz(bits) __builtin_ctz(bits)
+#else
+#    define matrix_row_ctz(bits) __builtin_ctzl(bits)
+#endif
+
 #ifdef MATRIX_HAS_GHOST
-static matrix_row_t get_real_keys(uint8_t row, matrix_row_t rowdata) {
-    matrix_row_t out = 0;
-    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
-        // read each key in the row data and check if the keymap defines it as a real key
-        if (keycode_at_keymap_location(0, row, col) && (rowdata & (((matrix_row_t)1) << col))) {
-            // this creates new row data, if a key is defined in the keymap, it will be set here
-            out |= ((matrix_row_t)1) << col;
+// keys defined in the keymap per row, loaded on first use
+static matrix_row_t real_keys[MATRIX_ROWS];
+static bool         real_keys_valid = false;
+
+void matrix_real_keys_invalidate(void) {
+    real_keys_valid = false;
+}
+
+static void real_keys_load(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        real_keys[row] = 0;
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            // check if the keymap defines it as a real key
+            if (keymap_key_to_keycode(0, MAKE_KEYPOS(row, col))) {
+                real_keys[row] |= ((matrix_row_t)1) << col;
+            }
         }
     }
-    return out;
+    real_keys_valid = true;
+}
+
+static inline matrix_row_t get_real_keys(uint8_t row, matrix_row_t rowdata) {
+    return rowdata & real_keys[row];
 }
 
 static inline bool popcount_more_than_one(matrix_row_t rowdata) {
@@ -234,6 +260,9 @@ static inline bool has_ghost_in_row(uint8_t row, matrix_row_t rowdata) {
     If there are "active" blanks in the matrix, the key can't be pressed by the user,
     there is no doubt as to which keys are really being pressed.
     The ghosts will be ignored, they are KC_NO.   */
+    if (!real_keys_valid) {
+        real_keys_load();
+    }
     rowdata = get_real_keys(row, rowdata);
     if ((popcount_more_than_one(rowdata)) == 0) {
         return false;
@@ -404,6 +433,9 @@ void keyboard_init(void) {
 #ifdef VIA_ENABLE
     via_init();
 #endif
+#if defined(DYNAMIC_KEYMAP_ENABLE) && defined(DYNAMIC_KEYMAP_RAM_CACHE)
+    dynamic_keymap_cache_load();
+#endif
 #ifdef SPLIT_KEYBOARD
     split_pre_init();
 #endif
@@ -508,12 +540,18 @@ static bool matrix_task(void) {
     }
 
     static matrix_row_t matrix_previous[MATRIX_ROWS];
+    matrix_row_t        matrix_changes[MATRIX_ROWS];
 
+    TRACE_BEGIN(TRACE_ID_MATRIX_SCAN);
     matrix_scan();
-    bool matrix_changed = false;
-    for (uint8_t row = 0; row < MATRIX_ROWS && !matrix_changed; row++) {
-        matrix_changed |= matrix_previous[row] ^ matrix_get_row(row);
+    TRACE_END(TRACE_ID_MATRIX_SCAN);
+    // changed keys of the whole matrix, one pass without early exit
+    matrix_row_t any_changes = 0;
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        matrix_changes[row] = matrix_previous[row] ^ matrix_get_row(row);
+        any_changes |= matrix_changes[row];
     }
+    bool matrix_changed = any_changes;
 
     matrix_scan_perf_task();
 
@@ -530,24 +568,29 @@ static bool matrix_task(void) {
     const bool process_keypress = should_process_keypress();
 
     for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
-        const matrix_row_t current_row = matrix_get_row(row);
-        const matrix_row_t row_changes = current_row ^ matrix_previous[row];
-
-        if (!row_changes || has_ghost_in_row(row, current_row)) {
+        matrix_row_t row_changes = matrix_changes[row];
+        if (!row_changes) {
             continue;
         }
 
-        matrix_row_t col_mask = 1;
-        for (uint8_t col = 0; col < MATRIX_COLS; col++, col_mask <<= 1) {
-            if (row_changes & col_mask) {
-                const bool key_pressed = current_row & col_mask;
+        const matrix_row_t current_row = matrix_previous[row] ^ row_changes;
+        if (has_ghost_in_row(row, current_row)) {
+            continue;
+        }
 
-                if (process_keypress) {
-                    action_exec(MAKE_KEYEVENT(row, col, key_pressed));
-                }
+        // changed columns only, lowest first
+        for (; row_changes; row_changes &= row_changes - 1) {
+            const uint8_t col         = matrix_row_ctz(row_changes);
+            const bool    key_pressed = current_row & (((matrix_row_t)1) << col);
 
-                switch_events(row, col, key_pressed);
+            if (process_keypress) {
+#ifdef KEY_LATENCY_ENABLE
+                key_latency_event(MAKE_KEYPOS(row, col), key_pressed);
+#endif
+                action_exec(MAKE_KEYEVENT(row, col, key_pressed));
             }
+
+            switch_events(row, col, key_pressed);
         }
 
         matrix_previous[row] = current_row;
@@ -634,7 +677,11 @@ void quantum_task(void) {
 /** \brief Main task that is repeatedly called as fast as possible. */
 void keyboard_task(void) {
     __attribute__((unused)) bool activity_has_occurred = false;
-    if (matrix_task()) {
+    TRACE_BEGIN(TRACE_ID_KEYBOARD_TASK);
+    TRACE_BEGIN(TRACE_ID_MATRIX_TASK);
+    bool matrix_changed = matrix_task();
+    TRACE_END(TRACE_ID_MATRIX_TASK);
+    if (matrix_changed) {
         last_matrix_activity_trigger();
         activity_has_occurred = true;
     }
@@ -718,4 +765,5 @@ void keyboard_task(void) {
 #endif
 
     led_task();
+    TRACE_END(TRACE_ID_KEYBOARD_TASK);
 }
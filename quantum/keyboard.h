@@ -98,6 +98,10 @@ void keyboard_setup(void);
 void keyboard_init(void);
 /* it runs repeatedly in main loop */
 void keyboard_task(void);
+#ifdef MATRIX_HAS_GHOST
+/* keymap changed, reload the real keys of the ghost detection on next use */
+void matrix_real_keys_invalidate(void);
+#endif
 /* it runs whenever code has to behave differently on a slave */
 bool is_keyboard_master(void);
 /* it runs whenever code has to behave differently on left vs right split */
@@ -22,6 +22,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "debounce.h"
 #include "atomic_util.h"
 
+#ifdef KEY_LATENCY_ENABLE
+#    include "key_latency.h"
+#endif
+
 #ifdef SPLIT_KEYBOARD
 #    include "split_common/split_util.h"
 #    include "split_common/transactions.h"
@@ -337,6 +341,13 @@ uint8_t matrix_scan(void) {
 #endif
 
     bool changed = memcmp(raw_matrix, curr_matrix, sizeof(curr_matrix)) != 0;
+#ifdef KEY_LATENCY_ENABLE
+#    ifdef SPLIT_KEYBOARD
+    if (changed) key_latency_matrix_scan(thisHand, raw_matrix, curr_matrix, ROWS_PER_HAND);
+#    else
+    if (changed) key_latency_matrix_scan(0, raw_matrix, curr_matrix, ROWS_PER_HAND);
+#    endif
+#endif
     if (changed) memcpy(raw_matrix, curr_matrix, sizeof(curr_matrix));
 
 #ifdef SPLIT_KEYBOARD
@@ -4,6 +4,11 @@
 #include "print.h"
 #include "debug.h"
 
+#ifdef KEY_LATENCY_ENABLE
+#    include "key_latency.h"
+#    include <string.h>
+#endif
+
 #ifdef SPLIT_KEYBOARD
 #    include "split_common/split_util.h"
 #    include "split_common/transactions.h"
@@ -166,8 +171,21 @@ __attribute__((weak)) void matrix_init(void) {
 }
 
 __attribute__((weak)) uint8_t matrix_scan(void) {
+#ifdef KEY_LATENCY_ENABLE
+    matrix_row_t raw_previous[ROWS_PER_HAND];
+    memcpy(raw_previous, raw_matrix, sizeof(raw_previous));
+#endif
+
     bool changed = matrix_scan_custom(raw_matrix);
 
+#ifdef KEY_LATENCY_ENABLE
+#    ifdef SPLIT_KEYBOARD
+    if (changed) key_latency_matrix_scan(thisHand, raw_previous, raw_matrix, ROWS_PER_HAND);
+#    else
+    if (changed) key_latency_matrix_scan(0, raw_previous, raw_matrix, ROWS_PER_HAND);
+#    endif
+#endif
+
 #ifdef SPLIT_KEYBOARD
     changed = debounce(raw_matrix, matrix + thisHand, ROWS_PER_HAND, changed) | matrix_post_scan();
 #else
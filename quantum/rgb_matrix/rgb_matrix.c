@@ -23,6 +23,7 @@
 #include "keyboard.h"
 #include "sync_timer.h"
 #include "debug.h"
+#include "trace_point.h"
 #include <string.h>
 #include <math.h>
 #include <stdlib.h>
@@ -411,7 +412,9 @@ void rgb_matrix_task(void) {
             rgb_task_start();
             break;
         case RENDERING:
+            TRACE_BEGIN(TRACE_ID_RGB_RENDER);
             rgb_task_render(effect);
+            TRACE_END(TRACE_ID_RGB_RENDER);
             if (effect) {
                 if (rgb_task_state == FLUSHING) { // ensure we only draw basic indicators once rendering is finished
                     rgb_matrix_indicators();
@@ -420,7 +423,9 @@ void rgb_matrix_task(void) {
             }
             break;
         case FLUSHING:
+            TRACE_BEGIN(TRACE_ID_RGB_FLUSH);
             rgb_task_flush(effect);
+            TRACE_END(TRACE_ID_RGB_FLUSH);
             break;
         case SYNCING:
             rgb_task_sync();
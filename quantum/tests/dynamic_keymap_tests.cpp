@@ -0,0 +1,154 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+extern "C" {
+#include "eeprom.h"
+#include "dynamic_keymap.h"
+}
+
+// dynamic_keymap with the keymap size of the q3 max on the test harness eeprom,
+// built with and without DYNAMIC_KEYMAP_RAM_CACHE. the benchmark prints the cost of
+// a layer_switch_get_layer style lookup (all layers of a key) for both builds.
+
+#define LAYERS DYNAMIC_KEYMAP_LAYER_COUNT
+
+extern "C" {
+uint16_t keycode_at_keymap_location_raw(uint8_t layer_num, uint8_t row, uint8_t column) {
+    return (layer_num << 8) | (row * MATRIX_COLS + column + 1);
+}
+
+void send_string_with_delay(const char *string, uint8_t interval) {}
+}
+
+class DynamicKeymap : public ::testing::Test {
+   protected:
+    void SetUp() override {
+#ifdef DYNAMIC_KEYMAP_RAM_CACHE
+        dynamic_keymap_cache_invalidate();
+#endif
+        dynamic_keymap_reset();
+    }
+
+    // keycode as stored in eeprom, big endian
+    uint16_t eeprom_keycode(uint8_t layer, uint8_t row, uint8_t column) {
+        uint8_t *address = (uint8_t *)dynamic_keymap_key_to_eeprom_address(layer, row, column);
+        return (eeprom_read_byte(address) << 8) | eeprom_read_byte(address + 1);
+    }
+};
+
+TEST_F(DynamicKeymap, ResetLoadsFlashKeymap) {
+    for (uint8_t layer = 0; layer < LAYERS; layer++) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t column = 0; column < MATRIX_COLS; column++) {
+                EXPECT_EQ(dynamic_keymap_get_keycode(layer, row, column), keycode_at_keymap_location_raw(layer, row, column));
+                EXPECT_EQ(eeprom_keycode(layer, row, column), keycode_at_keymap_location_raw(layer, row, column));
+            }
+        }
+    }
+    EXPECT_EQ(dynamic_keymap_get_keycode(LAYERS, 0, 0), 0);
+    EXPECT_EQ(dynamic_keymap_get_keycode(0, MATRIX_ROWS, 0), 0);
+}
+
+TEST_F(DynamicKeymap, SetKeycodeWritesThrough) {
+    dynamic_keymap_set_keycode(3, 2, 5, 0x1234);
+    EXPECT_EQ(dynamic_keymap_get_keycode(3, 2, 5), 0x1234);
+    EXPECT_EQ(eeprom_keycode(3, 2, 5), 0x1234);
+    EXPECT_EQ(dynamic_keymap_get_keycode(3, 2, 6), keycode_at_keymap_location_raw(3, 2, 6));
+
+    // keymap survives a reboot, cache reloaded from the eeprom
+#ifdef DYNAMIC_KEYMAP_RAM_CACHE
+    dynamic_keymap_cache_invalidate();
+#endif
+    EXPECT_EQ(dynamic_keymap_get_keycode(3, 2, 5), 0x1234);
+}
+
+TEST_F(DynamicKeymap, BufferMatchesKeycodes) {
+    // odd offset and length, splits the first and last keycode
+    uint8_t data[29];
+    for (uint8_t i = 0; i < sizeof(data); i++) data[i] = 0xA0 + i;
+    uint16_t offset = MATRIX_ROWS * MATRIX_COLS * 2 + 7;
+    dynamic_keymap_set_buffer(offset, sizeof(data), data);
+
+    uint8_t readback[sizeof(data)];
+    dynamic_keymap_get_buffer(offset, sizeof(readback), readback);
+    EXPECT_EQ(memcmp(data, readback, sizeof(data)), 0);
+
+    for (uint16_t byte = offset - 1; byte < offset + sizeof(data) + 1; byte += 2) {
+        uint8_t  layer = byte / (MATRIX_ROWS * MATRIX_COLS * 2);
+        uint8_t  row   = byte / (MATRIX_COLS * 2) % MATRIX_ROWS;
+        uint8_t  col   = byte / 2 % MATRIX_COLS;
+        uint16_t kc    = dynamic_keymap_get_keycode(layer, row, col);
+        EXPECT_EQ(kc, eeprom_keycode(layer, row, col));
+        uint8_t hi, lo;
+        dynamic_keymap_get_buffer(byte & ~1, 1, &hi);
+        dynamic_keymap_get_buffer(byte | 1, 1, &lo);
+        EXPECT_EQ(kc, (hi << 8) | lo);
+    }
+    // first byte is the low byte of layer 1 key (0, 3)
+    EXPECT_EQ(dynamic_keymap_get_keycode(1, 0, 3), (keycode_at_keymap_location_raw(1, 0, 3) & 0xFF00) | 0xA0);
+    EXPECT_EQ(dynamic_keymap_get_keycode(1, 0, 4), 0xA1A2);
+
+    // past the keymaps reads as 0 and is not written
+    uint16_t end = LAYERS * MATRIX_ROWS * MATRIX_COLS * 2;
+    uint8_t  tail[4] = {1, 2, 3, 4};
+    dynamic_keymap_set_buffer(end - 2, sizeof(tail), tail);
+    dynamic_keymap_get_buffer(end - 2, sizeof(tail), tail);
+    EXPECT_EQ(tail[0], 1);
+    EXPECT_EQ(tail[1], 2);
+    EXPECT_EQ(tail[2], 0);
+    EXPECT_EQ(tail[3], 0);
+    EXPECT_EQ(dynamic_keymap_get_keycode(LAYERS - 1, MATRIX_ROWS - 1, MATRIX_COLS - 1), 0x0102);
+}
+
+#ifdef DYNAMIC_KEYMAP_RAM_CACHE
+TEST_F(DynamicKeymap, InvalidateReloadsFromEeprom) {
+    // eeprom written behind dynamic_keymap, e.g. raw eeprom access from the host
+    uint8_t *address = (uint8_t *)dynamic_keymap_key_to_eeprom_address(2, 1, 1);
+    eeprom_update_byte(address, 0x56);
+    eeprom_update_byte(address + 1, 0x78);
+    EXPECT_EQ(dynamic_keymap_get_keycode(2, 1, 1), keycode_at_keymap_location_raw(2, 1, 1));
+    dynamic_keymap_cache_invalidate();
+    EXPECT_EQ(dynamic_keymap_get_keycode(2, 1, 1), 0x5678);
+    EXPECT_EQ(dynamic_keymap_cache[2][1][1], 0x5678);
+}
+#endif
+
+// lookup cost, printed, not asserted
+TEST_F(DynamicKeymap, Benchmark) {
+    const int rounds = 200;
+    uint32_t  sum    = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int n = 0; n < rounds; n++) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t column = 0; column < MATRIX_COLS; column++) {
+                for (int layer = LAYERS - 1; layer >= 0; layer--) sum += eeprom_keycode(layer, row, column);
+            }
+        }
+    }
+    auto eeprom_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int n = 0; n < rounds; n++) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t column = 0; column < MATRIX_COLS; column++) {
+                for (int layer = LAYERS - 1; layer >= 0; layer--) sum -= dynamic_keymap_get_keycode(layer, row, column);
+            }
+        }
+    }
+    auto keymap_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(sum, 0u);
+
+    const double lookups = (double)rounds * MATRIX_ROWS * MATRIX_COLS * LAYERS;
+#ifdef DYNAMIC_KEYMAP_RAM_CACHE
+    const char *build = "get_keycode, ram cache";
+#else
+    const char *build = "get_keycode, eeprom";
+#endif
+    printf("%-24s %10s %10s\n", "lookup", "ns", "ns/key");
+    printf("%-24s %10.1f %10.1f\n", "eeprom_read_byte x2", eeprom_ns / lookups, eeprom_ns / lookups * LAYERS);
+    printf("%-24s %10.1f %10.1f\n", build, keymap_ns / lookups, keymap_ns / lookups * LAYERS);
+}
@@ -0,0 +1,17 @@
+DYNAMIC_KEYMAP_TESTS_PATH := $(QUANTUM_PATH)/tests
+
+# q3 max keymap size on the test harness eeprom
+dynamic_keymap_DEFS := \
+	-DEEPROM_TEST_HARNESS \
+	-DEEPROM_SIZE=2048 \
+	-DMATRIX_ROWS=6 \
+	-DMATRIX_COLS=17 \
+	-DDYNAMIC_KEYMAP_LAYER_COUNT=8
+
+dynamic_keymap_SRC := \
+	$(DYNAMIC_KEYMAP_TESTS_PATH)/dynamic_keymap_tests.cpp \
+	$(QUANTUM_PATH)/dynamic_keymap.c \
+	$(PLATFORM_PATH)/$(PLATFORM_KEY)/eeprom.c
+
+dynamic_keymap_ram_cache_DEFS := $(dynamic_keymap_DEFS) -DDYNAMIC_KEYMAP_RAM_CACHE
+dynamic_keymap_ram_cache_SRC := $(dynamic_keymap_SRC)
@@ -0,0 +1,50 @@
+// Copyright 2024 bugbuster
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include <stdint.h>
+
+/*
+    Trace points for scan loop timing, finer grained than basic_profiling.h and without console output.
+
+    With TRACE_POINT_ENABLE defined the keyboard provides trace_point(), which records the event with
+    a high resolution timestamp, without it the macros compile to nothing.
+
+    Usage example:
+
+        TRACE_BEGIN(TRACE_ID_MATRIX_TASK);
+        matrix_task();
+        TRACE_END(TRACE_ID_MATRIX_TASK);
+
+        TRACE_INSTANT(TRACE_ID_USER + 1, keycode);
+*/
+
+enum trace_point_id {
+    TRACE_ID_KEYBOARD_TASK = 1,
+    TRACE_ID_MATRIX_TASK,
+    TRACE_ID_PROCESS_RECORD,
+    TRACE_ID_RGB_RENDER,
+    TRACE_ID_RGB_FLUSH,
+    TRACE_ID_QMKATA_TASK,
+    TRACE_ID_WIRELESS_TASKS,
+    TRACE_ID_MATRIX_SCAN,
+    TRACE_ID_USB_SEND,
+    TRACE_ID_USER = 64, // first id free for keyboard and user code
+};
+
+enum trace_point_type {
+    TRACE_TYPE_BEGIN = 0,
+    TRACE_TYPE_END,
+    TRACE_TYPE_INSTANT,
+};
+
+#ifdef TRACE_POINT_ENABLE
+void trace_point(uint8_t id, uint8_t type, uint16_t arg);
+#    define TRACE_BEGIN(id) trace_point((id), TRACE_TYPE_BEGIN, 0)
+#    define TRACE_END(id) trace_point((id), TRACE_TYPE_END, 0)
+#    define TRACE_INSTANT(id, arg) trace_point((id), TRACE_TYPE_INSTANT, (arg))
+#else
+#    define TRACE_BEGIN(id)
+#    define TRACE_END(id)
+#    define TRACE_INSTANT(id, arg)
+#endif
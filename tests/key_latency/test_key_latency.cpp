@@ -0,0 +1,127 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+#include "keyboard_report_util.hpp"
+#include "test_common.hpp"
+
+using testing::_;
+using testing::InSequence;
+
+static std::vector<key_latency_sample_t> samples;
+
+extern "C" void key_latency_sample_user(const key_latency_sample_t *sample) {
+    samples.push_back(*sample);
+}
+
+class KeyLatency : public TestFixture {
+   public:
+    void SetUp() override {
+        key_latency_reset_stats();
+        samples.clear();
+    }
+};
+
+TEST_F(KeyLatency, PlainKeySampledOnReport) {
+    TestDriver driver;
+    InSequence s;
+    auto       key = KeymapKey(0, 1, 0, KC_A);
+
+    set_keymap({key});
+
+    key.press();
+    EXPECT_REPORT(driver, (KC_A));
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+
+    ASSERT_EQ(samples.size(), 1);
+    EXPECT_EQ(samples[0].key.col, 1);
+    EXPECT_EQ(samples[0].key.row, 0);
+    EXPECT_TRUE(samples[0].pressed);
+    EXPECT_EQ(samples[0].hold, 0);
+    EXPECT_EQ(samples[0].report, 0);
+
+    key.release();
+    EXPECT_EMPTY_REPORT(driver);
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+
+    ASSERT_EQ(samples.size(), 2);
+    EXPECT_FALSE(samples[1].pressed);
+    EXPECT_EQ(key_latency_get_stats()->count, 2);
+}
+
+TEST_F(KeyLatency, TapHoldDelayIsHoldStage) {
+    TestDriver driver;
+    InSequence s;
+    auto       mod_tap_key = KeymapKey(0, 7, 0, SFT_T(KC_P));
+
+    set_keymap({mod_tap_key});
+
+    // the press is held in the tapping buffer until the release resolves it as tap
+    mod_tap_key.press();
+    EXPECT_NO_REPORT(driver);
+    idle_for(50);
+    VERIFY_AND_CLEAR(driver);
+    EXPECT_TRUE(samples.empty());
+
+    mod_tap_key.release();
+    EXPECT_REPORT(driver, (KC_P));
+    EXPECT_EMPTY_REPORT(driver);
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+
+    ASSERT_EQ(samples.size(), 2);
+    EXPECT_TRUE(samples[0].pressed);
+    EXPECT_EQ(samples[0].hold, 50);
+    EXPECT_EQ(samples[0].total, samples[0].debounce + samples[0].hold + samples[0].report);
+    EXPECT_FALSE(samples[1].pressed);
+    EXPECT_EQ(samples[1].hold, 0);
+    EXPECT_GE(key_latency_get_stats()->max_total, 50);
+}
+
+TEST_F(KeyLatency, TransitionWithoutReportIsDropped) {
+    TestDriver driver;
+    InSequence s;
+    auto       layer_key = KeymapKey(0, 0, 0, MO(1));
+    auto       regular_key = KeymapKey(0, 1, 0, KC_A);
+
+    set_keymap({layer_key, regular_key, KeymapKey(1, 1, 0, KC_B)});
+
+    // layer change sends nothing, the press waits for a report
+    layer_key.press();
+    EXPECT_NO_REPORT(driver);
+    run_one_scan_loop();
+    layer_key.release();
+    run_one_scan_loop();
+    idle_for(200);
+    VERIFY_AND_CLEAR(driver);
+
+    // the next report only belongs to the regular key
+    regular_key.press();
+    EXPECT_REPORT(driver, (KC_A));
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+
+    ASSERT_EQ(samples.size(), 1);
+    EXPECT_EQ(samples[0].key.col, 1);
+    EXPECT_EQ(key_latency_get_stats()->dropped, 2);
+
+    regular_key.release();
+    EXPECT_EMPTY_REPORT(driver);
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+}
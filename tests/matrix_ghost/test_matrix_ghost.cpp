@@ -0,0 +1,207 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "keyboard_report_util.hpp"
+#include "test_common.hpp"
+#include "test_matrix.h"
+
+using testing::_;
+using testing::AnyNumber;
+using testing::InSequence;
+
+class MatrixGhost : public TestFixture {
+   public:
+    // every position of layer 0 is mapped, letters in matrix order except the given blanks
+    void fill_keymap(std::initializer_list<keypos_t> blanks) {
+        set_keymap({});
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                uint16_t keycode = KC_A + (row * MATRIX_COLS + col) % 26;
+                for (auto &blank : blanks) {
+                    if (blank.row == row && blank.col == col) keycode = KC_NO;
+                }
+                add_key(KeymapKey(0, col, row, keycode));
+            }
+        }
+    }
+
+    KeymapKey key(uint8_t row, uint8_t col) {
+        return *find_key(0, {.col = col, .row = row});
+    }
+};
+
+TEST_F(MatrixGhost, GhostRowIgnored) {
+    TestDriver driver;
+    InSequence s;
+
+    fill_keymap({});
+
+    EXPECT_REPORT(driver, (KC_A));
+    EXPECT_REPORT(driver, (KC_A, KC_B));
+    EXPECT_REPORT(driver, (KC_A, KC_B, KC_K));
+    key(0, 0).press();
+    run_one_scan_loop();
+    key(0, 1).press();
+    run_one_scan_loop();
+    key(1, 0).press();
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+
+    // (1, 1) can't be told apart from a ghost of the three other keys
+    EXPECT_NO_REPORT(driver);
+    key(1, 1).press();
+    run_one_scan_loop();
+    key(1, 1).release();
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+
+    EXPECT_REPORT(driver, (KC_B, KC_K));
+    EXPECT_REPORT(driver, (KC_K));
+    EXPECT_EMPTY_REPORT(driver);
+    key(0, 0).release();
+    run_one_scan_loop();
+    key(0, 1).release();
+    run_one_scan_loop();
+    key(1, 0).release();
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+}
+
+TEST_F(MatrixGhost, BlankIsNotGhost) {
+    TestDriver driver;
+    InSequence s;
+
+    fill_keymap({{.col = 1, .row = 1}});
+
+    EXPECT_REPORT(driver, (KC_A));
+    EXPECT_REPORT(driver, (KC_A, KC_B));
+    EXPECT_REPORT(driver, (KC_A, KC_B, KC_K));
+    key(0, 0).press();
+    run_one_scan_loop();
+    key(0, 1).press();
+    run_one_scan_loop();
+    key(1, 0).press();
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+
+    // pressed blank, row 1 has a single real key down
+    EXPECT_NO_REPORT(driver);
+    key(1, 1).press();
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+
+    EXPECT_REPORT(driver, (KC_B, KC_K));
+    EXPECT_REPORT(driver, (KC_B));
+    EXPECT_EMPTY_REPORT(driver);
+    key(0, 0).release();
+    run_one_scan_loop();
+    key(1, 1).release();
+    key(1, 0).release();
+    run_one_scan_loop();
+    key(0, 1).release();
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+}
+
+TEST_F(MatrixGhost, ChangesOfOneScanInMatrixOrder) {
+    TestDriver driver;
+    InSequence s;
+
+    fill_keymap({});
+
+    EXPECT_REPORT(driver, (KC_D));
+    EXPECT_REPORT(driver, (KC_D, KC_V));
+    EXPECT_REPORT(driver, (KC_D, KC_V, KC_Z));
+    EXPECT_REPORT(driver, (KC_D, KC_V, KC_Z, KC_N));
+    key(2, 5).press();
+    key(3, 9).press();
+    key(0, 3).press();
+    key(2, 1).press();
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+
+    EXPECT_REPORT(driver, (KC_V, KC_Z, KC_N));
+    EXPECT_REPORT(driver, (KC_Z, KC_N));
+    EXPECT_REPORT(driver, (KC_N));
+    EXPECT_EMPTY_REPORT(driver);
+    clear_all_keys();
+    run_one_scan_loop();
+    VERIFY_AND_CLEAR(driver);
+}
+
+// matrix_task cost over random matrices, printed, not asserted
+TEST_F(MatrixGhost, Benchmark) {
+    TestDriver driver;
+    const int  scans = 20000;
+
+    fill_keymap({{.col = 9, .row = 0}, {.col = 9, .row = 1}, {.col = 0, .row = 3}});
+    EXPECT_CALL(driver, send_keyboard_mock(_)).Times(AnyNumber());
+
+    // one key pressed or released per scan: typing, and two to five keys per row: mostly ghosts
+    std::vector<keypos_t>                  toggles;
+    std::vector<std::vector<matrix_row_t>> matrices;
+    srand(23);
+    for (int n = 0; n < scans; n++) {
+        toggles.push_back({.col = (uint8_t)(rand() % MATRIX_COLS), .row = (uint8_t)(rand() % MATRIX_ROWS)});
+        std::vector<matrix_row_t> rows;
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            matrix_row_t bits = 0;
+            for (int k = 2 + rand() % 4; k; k--) bits |= (matrix_row_t)1 << (rand() % MATRIX_COLS);
+            rows.push_back(bits);
+        }
+        matrices.push_back(rows);
+    }
+
+    auto time_scans = [&](auto apply) {
+        auto start = std::chrono::steady_clock::now();
+        for (int n = 0; n < scans; n++) {
+            apply(n);
+            keyboard_task();
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        clear_all_keys();
+        keyboard_task();
+        return (double)ns / scans;
+    };
+
+    double idle_ns  = time_scans([](int n) {});
+    double typed_ns = time_scans([&](int n) {
+        if (n % 2) {
+            release_key(toggles[n - 1].col, toggles[n - 1].row);
+        } else {
+            press_key(toggles[n].col, toggles[n].row);
+        }
+    });
+    double ghost_ns = time_scans([&](int n) {
+        clear_all_keys();
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                if (matrices[n][row] & ((matrix_row_t)1 << col)) press_key(col, row);
+            }
+        }
+    });
+
+    printf("%-28s %10s\n", "keyboard_task", "ns/scan");
+    printf("%-28s %10.1f\n", "no change", idle_ns);
+    printf("%-28s %10.1f\n", "one key pressed/released", typed_ns);
+    printf("%-28s %10.1f\n", "random rows, 2 to 5 keys", ghost_ns);
+
+    VERIFY_AND_CLEAR(driver);
+}
@@ -0,0 +1,195 @@
+/* Copyright 2024 bugbuster
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include "keyboard_report_util.hpp"
+#include "test_common.hpp"
+
+using testing::_;
+using testing::InSequence;
+
+#define LAYERS 4
+
+class ResolvedLayerCache : public TestFixture {
+   public:
+    // the table is built for the whole matrix, every position of the used layers must be mapped
+    void fill_keymap(std::initializer_list<KeymapKey> keys) {
+        set_keymap(keys);
+        for (uint8_t layer = 0; layer < LAYERS; layer++) {
+            for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+                for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                    if (!find_key(layer, {.col = col, .row = row})) {
+                        add_key(KeymapKey(layer, col, row, layer == 0 ? KC_NO : KC_TRANSPARENT));
+                    }
+                }
+            }
+        }
+    }
+
+    // layer_switch_get_layer without the table
+    uint8_t scan_layer(keypos_t key) {
+        layer_state_t layers = layer_state | default_layer_state;
+        for (int8_t i = MAX_LAYER - 1; i >= 0; i--) {
+            if ((layers & ((layer_state_t)1 << i)) && action_for_key(i, key).code != ACTION_TRANSPARENT) {
+                return i;
+            }
+        }
+        return 0;
+    }
+};
+
+TEST_F(ResolvedLayerCache, TransparentKeysFallThrough) {
+    TestDriver driver;
+    keypos_t   a = {.col = 0, .row = 0};
+    keypos_t   b = {.col = 1, .row = 0};
+
+    fill_keymap({KeymapKey(0, 0, 0, KC_A), KeymapKey(0, 1, 0, KC_B), KeymapKey(1, 1, 0, KC_1), KeymapKey(2, 0, 0, KC_2)});
+
+    EXPECT_EQ(layer_switch_get_layer(a), 0);
+    EXPECT_EQ(layer_switch_get_layer(b), 0);
+    layer_on(1);
+    EXPECT_EQ(layer_switch_get_layer(a), 0);
+    EXPECT_EQ(layer_switch_get_layer(b), 1);
+    layer_on(2);
+    EXPECT_EQ(layer_switch_get_layer(a), 2);
+    EXPECT_EQ(layer_switch_get_layer(b), 1);
+    layer_off(1);
+    EXPECT_EQ(layer_switch_get_layer(a), 2);
+    EXPECT_EQ(layer_switch_get_layer(b), 0);
+    layer_off(2);
+    EXPECT_EQ(layer_switch_get_layer(a), 0);
+
+    VERIFY_AND_CLEAR(driver);
+}
+
+TEST_F(ResolvedLayerCache, DefaultLayerChange) {
+    TestDriver driver;
+    keypos_t   a = {.col = 0, .row = 0};
+
+    fill_keymap({KeymapKey(0, 0, 0, KC_A), KeymapKey(1, 0, 0, KC_1), KeymapKey(3, 0, 0, KC_3)});
+
+    EXPECT_EQ(layer_switch_get_layer(a), 0);
+    default_layer_set((layer_state_t)1 << 1);
+    EXPECT_EQ(layer_switch_get_layer(a), 1);
+    layer_on(3);
+    EXPECT_EQ(layer_switch_get_layer(a), 3);
+    layer_off(3);
+    default_layer_set((layer_state_t)1 << 2);
+    // transparent default layer, fall back to layer 0
+    EXPECT_EQ(layer_switch_get_layer(a), 0);
+    default_layer_set((layer_state_t)1 << 0);
+    EXPECT_EQ(layer_switch_get_layer(a), 0);
+
+    VERIFY_AND_CLEAR(driver);
+}
+
+TEST_F(ResolvedLayerCache, KeymapChangeInvalidates) {
+    TestDriver driver;
+    keypos_t   a = {.col = 0, .row = 0};
+
+    fill_keymap({KeymapKey(0, 0, 0, KC_A)});
+    layer_on(1);
+    EXPECT_EQ(layer_switch_get_layer(a), 0);
+
+    fill_keymap({KeymapKey(0, 0, 0, KC_A), KeymapKey(1, 0, 0, KC_1)});
+    EXPECT_EQ(layer_switch_get_layer(a), 1);
+
+    VERIFY_AND_CLEAR(driver);
+}
+
+TEST_F(ResolvedLayerCache, LayerStateAssignedDirectly) {
+    TestDriver driver;
+    keypos_t   a = {.col = 0, .row = 0};
+
+    fill_keymap({KeymapKey(0, 0, 0, KC_A), KeymapKey(2, 0, 0, KC_2)});
+    EXPECT_EQ(layer_switch_get_layer(a), 0);
+
+    // like the split transport does with the default layer state
+    layer_state = (layer_state_t)1 << 2;
+    EXPECT_EQ(layer_switch_get_layer(a), 2);
+    layer_state_set(0);
+    EXPECT_EQ(layer_switch_get_layer(a), 0);
+
+    VERIFY_AND_CLEAR(driver);
+}
+
+TEST_F(ResolvedLayerCache, HeldKeyReleasedOnPressLayer) {
+    TestDriver driver;
+    InSequence s;
+    auto       key_a   = KeymapKey(0, 0, 0, KC_A);
+    auto       key_1   = KeymapKey(1, 0, 0, KC_1);
+    auto       mo_key  = KeymapKey(0, 1, 0, MO(1));
+    auto       mo_trns = KeymapKey(1, 1, 0, KC_TRANSPARENT);
+
+    fill_keymap({key_a, key_1, mo_key, mo_trns});
+
+    EXPECT_REPORT(driver, (KC_A));
+    key_a.press();
+    run_one_scan_loop();
+
+    EXPECT_NO_REPORT(driver);
+    mo_key.press();
+    run_one_scan_loop();
+    EXPECT_TRUE(layer_state_is(1));
+
+    // released from layer 0 where it was pressed
+    EXPECT_EMPTY_REPORT(driver);
+    key_a.release();
+    run_one_scan_loop();
+
+    EXPECT_REPORT(driver, (KC_1));
+    EXPECT_EMPTY_REPORT(driver);
+    tap_key(key_1);
+
+    EXPECT_NO_REPORT(driver);
+    mo_key.release();
+    run_one_scan_loop();
+    EXPECT_FALSE(layer_state_is(1));
+
+    VERIFY_AND_CLEAR(driver);
+}
+
+TEST_F(ResolvedLayerCache, MatchesLayerScan) {
+    TestDriver driver;
+
+    // pseudo random keymap, about half of the keys transparent on layers 1 and up
+    set_keymap({});
+    srand(22);
+    for (uint8_t layer = 0; layer < LAYERS; layer++) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                add_key(KeymapKey(layer, col, row, (layer && rand() % 2) ? KC_TRANSPARENT : KC_A + layer));
+            }
+        }
+    }
+
+    for (int n = 0; n < 200; n++) {
+        if (rand() % 4) {
+            layer_state_set(rand() % (1 << LAYERS));
+        } else {
+            default_layer_set((layer_state_t)1 << (rand() % LAYERS));
+        }
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                keypos_t key = {.col = col, .row = row};
+                ASSERT_EQ(layer_switch_get_layer(key), scan_layer(key)) << "layers " << +layer_state << " default " << +default_layer_state << " key " << +row << "," << +col;
+            }
+        }
+    }
+    default_layer_set((layer_state_t)1 << 0);
+
+    VERIFY_AND_CLEAR(driver);
+}
@@ -16,6 +16,12 @@
 
 #include "test_driver.hpp"
 
+#ifdef KEY_LATENCY_ENABLE
+extern "C" {
+#    include "key_latency.h"
+}
+#endif
+
 TestDriver* TestDriver::m_this = nullptr;
 
 namespace {
@@ -47,10 +53,16 @@ uint8_t TestDriver::keyboard_leds(void) {
 void TestDriver::send_keyboard(report_keyboard_t* report) {
     test_logger.trace() << *report;
     m_this->send_keyboard_mock(*report);
+#ifdef KEY_LATENCY_ENABLE
+    key_latency_report_sent();
+#endif
 }
 
 void TestDriver::send_nkro(report_nkro_t* report) {
     m_this->send_nkro_mock(*report);
+#ifdef KEY_LATENCY_ENABLE
+    key_latency_report_sent();
+#endif
 }
 
 void TestDriver::send_mouse(report_mouse_t* report) {
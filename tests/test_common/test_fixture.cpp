@@ -99,6 +99,12 @@ void TestFixture::add_key(KeymapKey key) {
     }
 
     this->keymap.push_back(key);
+#ifdef RESOLVED_LAYER_CACHE
+    resolved_layer_cache_invalidate();
+#endif
+#ifdef MATRIX_HAS_GHOST
+    matrix_real_keys_invalidate();
+#endif
 }
 
 void TestFixture::tap_key(KeymapKey key, unsigned delay_ms) {
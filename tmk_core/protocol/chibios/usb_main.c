@@ -44,6 +44,9 @@
 #include "usb_descriptor.h"
 #include "usb_driver.h"
 #include "usb_types.h"
+#ifdef KEY_LATENCY_ENABLE
+#    include "key_latency.h"
+#endif
 
 #ifdef NKRO_ENABLE
 #    include "keycode_config.h"
@@ -845,11 +848,17 @@ void send_keyboard(report_keyboard_t *report) {
     }
 
     keyboard_report_sent = *report;
+#ifdef KEY_LATENCY_ENABLE
+    key_latency_report_sent();
+#endif
 }
 
 void send_nkro(report_nkro_t *report) {
 #ifdef NKRO_ENABLE
     send_report(SHARED_IN_EPNUM, report, sizeof(report_nkro_t));
+#    ifdef KEY_LATENCY_ENABLE
+    key_latency_report_sent();
+#    endif
 #endif
 }
 
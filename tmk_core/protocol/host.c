@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "host.h"
 #include "util.h"
 #include "debug.h"
+#include "trace_point.h"
 
 #ifdef DIGITIZER_ENABLE
 #    include "digitizer.h"
@@ -84,7 +85,9 @@ void host_keyboard_send(report_keyboard_t *report) {
 #ifdef KEYBOARD_SHARED_EP
     report->report_id = REPORT_ID_KEYBOARD;
 #endif
+    TRACE_BEGIN(TRACE_ID_USB_SEND);
     (*driver->send_keyboard)(report);
+    TRACE_END(TRACE_ID_USB_SEND);
 
     if (debug_keyboard) {
         dprintf("keyboard_report: %02X | ", report->mods);
@@ -98,7 +101,9 @@ void host_keyboard_send(report_keyboard_t *report) {
 void host_nkro_send(report_nkro_t *report) {
     if (!driver) return;
     report->report_id = REPORT_ID_NKRO;
+    TRACE_BEGIN(TRACE_ID_USB_SEND);
     (*driver->send_nkro)(report);
+    TRACE_END(TRACE_ID_USB_SEND);
 
     if (debug_keyboard) {
         dprintf("nkro_report: %02X | ", report->mods);
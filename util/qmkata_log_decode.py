@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+#
+# Copyright 2024 bugbuster
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Decoder for QMKata deferred format log records (keyboards/keychron/qmkata/qmkata_log.h).
+# The format strings come from the .qmkata_log section of the elf of the same build.
+#
+# usage: qmkata_log_decode.py firmware.elf log.bin
+#   log.bin: QMKATA_ID_LOG pub message payloads (without the id byte), concatenated
+
+import argparse
+import re
+import struct
+import sys
+
+SHF_ALLOC = 0x2
+FMT_SPEC = re.compile(r'%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z|j|t)?([diuxXcspo%])')
+
+
+class Elf32:
+    def __init__(self, data):
+        if data[:4] != b'\x7fELF' or data[4] != 1 or data[5] != 1:
+            raise ValueError('not a 32 bits little endian elf')
+        self.data = data
+        shoff, = struct.unpack_from('<I', data, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from('<HHH', data, 0x2e)
+        headers = [struct.unpack_from('<IIIIIIIIII', data, shoff + i * shentsize) for i in range(shnum)]
+        strtab = headers[shstrndx]
+        self.sections = {}
+        for h in headers:
+            name_off = strtab[4] + h[0]
+            name = data[name_off:data.index(b'\0', name_off)].decode()
+            # name: (flags, addr, offset, size, type)
+            self.sections[name] = (h[2], h[3], h[4], h[5], h[1])
+
+    def section(self, name):
+        flags, addr, offset, size, type = self.sections[name]
+        return addr, self.data[offset:offset + size]
+
+    def cstring(self, addr):
+        # constant string in a loaded section (NOBITS sections have no data in the file)
+        for flags, start, offset, size, type in self.sections.values():
+            if flags & SHF_ALLOC and type != 8 and start <= addr < start + size:
+                end = self.data.index(b'\0', offset + addr - start)
+                return self.data[offset + addr - start:end].decode(errors='replace')
+        return '<0x%08x>' % addr
+
+
+def varint(data, off):
+    value = shift = 0
+    while True:
+        b = data[off]
+        off += 1
+        value |= (b & 0x7f) << shift
+        shift += 7
+        if not b & 0x80:
+            return value, off
+
+
+def c_format(elf, fmt, args):
+    args = list(args)
+
+    def arg():
+        return args.pop(0) if args else 0
+
+    def conv(m):
+        flags, width, prec, _, spec = m.groups()
+        if spec == '%':
+            return '%'
+        width = str(arg()) if width == '*' else (width or '')
+        prec = str(arg()) if prec == '*' else prec
+        prec = '' if prec is None else '.' + prec
+        value = arg()
+        if spec in 'di':
+            value = value - (1 << 32) if value & 0x80000000 else value
+            spec = 'd'
+        elif spec == 'u':
+            spec = 'd'
+        elif spec == 'c':
+            value = chr(value & 0xff)
+        elif spec == 's':
+            value = elf.cstring(value)
+        elif spec == 'p':
+            value, spec = '0x%08x' % value, 's'
+        return ('%' + flags + width + prec + spec) % value
+
+    return FMT_SPEC.sub(conv, fmt)
+
+
+def decode(elf, payload, state):
+    # yields (timestamp seconds or None, text) for each record of one pub message payload
+    base, strings = elf.section('.qmkata_log')
+    off = 0
+    while off < len(payload):
+        end = off + payload[off]
+        if payload[off] < 4 or end > len(payload):
+            raise ValueError('bad record length at offset %d' % off)
+        string_id, = struct.unpack_from('<H', payload, off + 1)
+        delta, pos = varint(payload, off + 3)
+        args = []
+        while pos < end:
+            value, pos = varint(payload, pos)
+            args.append(value)
+        off = end
+
+        if string_id == 0:
+            state['freq'], state['ts'], dropped = args
+            if dropped:
+                yield None, '<%d records dropped>' % dropped
+            continue
+        state['ts'] = (state.get('ts', 0) + delta) & 0xffffffff
+        idx = string_id - base
+        if not 0 <= idx < len(strings):
+            yield None, '<unknown string id %d>' % string_id
+            continue
+        fmt = strings[idx:strings.index(b'\0', idx)].decode(errors='replace')
+        freq = state.get('freq')
+        yield (state['ts'] / freq if freq else None), c_format(elf, fmt, args)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='decode QMKata deferred format log records')
+    parser.add_argument('elf', help='firmware elf of the running build')
+    parser.add_argument('log', help='QMKATA_ID_LOG payloads without the id byte, concatenated')
+    args = parser.parse_args()
+
+    with open(args.elf, 'rb') as f:
+        elf = Elf32(f.read())
+    with open(args.log, 'rb') as f:
+        payload = f.read()
+
+    # timestamps wrap with the 32 bits counter, only deltas within a wrap period are meaningful
+    for ts, text in decode(elf, payload, {}):
+        prefix = '%12.6f ' % ts if ts is not None else ' ' * 13
+        sys.stdout.write(prefix + text + ('' if text.endswith('\n') else '\n'))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+#
+# Copyright 2024 bugbuster
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Converts QMKata trace point messages (keyboards/keychron/qmkata/qmkata_trace.h) into chrome trace json,
+# which opens in ui.perfetto.dev or chrome://tracing.
+#
+# usage: qmkata_trace_to_perfetto.py trace.bin trace.json
+#   trace.bin: QMKATA_ID_TRACE pub messages (with the id byte), concatenated
+
+import argparse
+import json
+import struct
+
+QMKATA_ID_TRACE = 17
+EVENT = struct.Struct('<IBBH')
+
+# quantum/trace_point.h trace_point_id
+NAMES = {
+    1: 'keyboard_task',
+    2: 'matrix_task',
+    3: 'process_record',
+    4: 'rgb_task_render',
+    5: 'rgb_task_flush',
+    6: 'qmkata_task',
+    7: 'wireless_tasks',
+    8: 'matrix_scan',
+    9: 'usb_send',
+}
+TRACE_ID_USER = 64
+PHASES = {0: 'B', 1: 'E', 2: 'i'}
+
+
+def name(trace_id):
+    if trace_id >= TRACE_ID_USER:
+        return 'user %d' % (trace_id - TRACE_ID_USER)
+    return NAMES.get(trace_id, 'id %d' % trace_id)
+
+
+def messages(data):
+    off = 0
+    while off < len(data):
+        if data[off] != QMKATA_ID_TRACE:
+            raise ValueError('not a trace message at offset %d' % off)
+        count, dropped, freq = struct.unpack_from('<BHI', data, off + 1)
+        off += 8
+        events = [EVENT.unpack_from(data, off + i * EVENT.size) for i in range(count)]
+        off += count * EVENT.size
+        yield dropped, freq, events
+
+
+def convert(data):
+    trace = []
+    base = last = None
+    wraps = 0
+    open_slices = []
+    for dropped, freq, events in messages(data):
+        if dropped:
+            # window boundary, slices still open have lost their end events
+            ts = (last - base) * 1e6 / freq if last is not None else 0
+            while open_slices:
+                trace.append({'name': name(open_slices.pop()), 'ph': 'E', 'ts': ts, 'pid': 0, 'tid': 0})
+            trace.append({'name': '%d events dropped' % dropped, 'ph': 'i', 's': 'g', 'ts': ts, 'pid': 0, 'tid': 0})
+        for timestamp, trace_id, type, arg in events:
+            # 32 bits cycle counter, unwrap assuming less than one wrap between events
+            if last is not None and timestamp + wraps < last:
+                wraps += 1 << 32
+            timestamp += wraps
+            if base is None:
+                base = timestamp
+            last = timestamp
+            phase = PHASES.get(type, 'i')
+            ts = (timestamp - base) * 1e6 / freq
+            if phase == 'B':
+                open_slices.append(trace_id)
+            elif phase == 'E':
+                if trace_id not in open_slices:
+                    continue  # begin recorded in a previous window
+                # close nested slices left open by a missing end event
+                while open_slices[-1] != trace_id:
+                    trace.append({'name': name(open_slices.pop()), 'ph': 'E', 'ts': ts, 'pid': 0, 'tid': 0})
+                open_slices.pop()
+            event = {'name': name(trace_id), 'ph': phase, 'ts': ts, 'pid': 0, 'tid': 0}
+            if phase == 'i':
+                event['s'] = 't'
+                event['args'] = {'arg': arg}
+            trace.append(event)
+    return {'traceEvents': trace, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description='convert QMKata trace point messages into chrome trace json')
+    parser.add_argument('trace', help='QMKATA_ID_TRACE pub messages, concatenated')
+    parser.add_argument('output', help='chrome trace json file')
+    args = parser.parse_args()
+
+    with open(args.trace, 'rb') as f:
+        data = f.read()
+    with open(args.output, 'w') as f:
+        json.dump(convert(data), f, indent=0)
+
+
+if __name__ == '__main__':
+    main()